@@ -0,0 +1,133 @@
+#include "ConnectionPool.h"
+#include "sqlite.h"
+
+ConnectionPool::Handle::Data::~Data()
+{
+    if(state && db)
+        ConnectionPool::release(*state, db, generation);
+}
+
+ConnectionPool::ConnectionPool(int maxConnections)
+    : m_state(std::make_shared<State>()),
+      m_maxConnections(maxConnections)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    close();
+}
+
+void ConnectionPool::open(const QString& filename, SetupFunction setup)
+{
+    QMutexLocker lock(&m_state->mutex);
+
+    closeIdle(*m_state);
+    m_state->generation++;
+    m_state->filename = filename;
+    m_state->setup = setup;
+}
+
+void ConnectionPool::close()
+{
+    QMutexLocker lock(&m_state->mutex);
+
+    closeIdle(*m_state);
+    m_state->generation++;
+    m_state->filename.clear();
+    m_state->setup = SetupFunction();
+}
+
+void ConnectionPool::reset()
+{
+    QMutexLocker lock(&m_state->mutex);
+
+    closeIdle(*m_state);
+    m_state->generation++;
+}
+
+bool ConnectionPool::isOpen() const
+{
+    QMutexLocker lock(&m_state->mutex);
+    return !m_state->filename.isEmpty();
+}
+
+ConnectionPool::Handle ConnectionPool::acquire()
+{
+    QMutexLocker lock(&m_state->mutex);
+
+    if(m_state->filename.isEmpty())
+        return Handle();
+
+    sqlite3* db = nullptr;
+    if(!m_state->idle.isEmpty())
+    {
+        db = m_state->idle.takeLast();
+    } else if(m_state->inUse < m_maxConnections) {
+        // The handles can be passed to other threads, so use the serialized threading mode just like for the main connection
+        if(sqlite3_open_v2(m_state->filename.toUtf8(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK ||
+                (m_state->setup && !m_state->setup(db)))
+        {
+            sqlite3_close(db);
+            return Handle();
+        }
+
+        // While the main connection is committing, readers might have to wait for a moment in rollback journal mode
+        sqlite3_busy_timeout(db, 5000);
+    } else {
+        return Handle();
+    }
+
+    m_state->inUse++;
+
+    Handle handle;
+    handle.m_data = std::make_shared<Handle::Data>();
+    handle.m_data->state = m_state;
+    handle.m_data->db = db;
+    handle.m_data->generation = m_state->generation;
+    return handle;
+}
+
+bool ConnectionPool::isCurrent(const Handle& handle) const
+{
+    if(!handle.m_data || handle.m_data->state != m_state)
+        return false;
+
+    QMutexLocker lock(&m_state->mutex);
+    return !m_state->filename.isEmpty() && handle.m_data->generation == m_state->generation;
+}
+
+ConnectionPool::Handle ConnectionPool::wrap(sqlite3* db)
+{
+    Handle handle;
+    handle.m_data = std::make_shared<Handle::Data>();
+    handle.m_data->db = db;
+    handle.m_data->generation = 0;
+    return handle;
+}
+
+int ConnectionPool::size() const
+{
+    QMutexLocker lock(&m_state->mutex);
+    return m_state->idle.size() + m_state->inUse;
+}
+
+void ConnectionPool::release(State& state, sqlite3* db, int generation)
+{
+    QMutexLocker lock(&state.mutex);
+
+    state.inUse--;
+
+    // Connections to a file which has been closed in the meantime or which have been reset aren't used again
+    if(generation != state.generation || state.filename.isEmpty())
+        sqlite3_close(db);
+    else
+        state.idle.push_back(db);
+}
+
+void ConnectionPool::closeIdle(State& state)
+{
+    for(sqlite3* db : state.idle)
+        sqlite3_close(db);
+    state.idle.clear();
+}
@@ -0,0 +1,113 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+struct sqlite3;
+
+/*!
+ * \brief The ConnectionPool class
+ *
+ * This keeps a couple of read-only connections to a database file around so queries which only read data can run without waiting for
+ * each other or for the main connection. Connections are opened when they are needed first and are reused afterwards. When all of
+ * them are in use, acquire() returns an invalid handle and the caller should fall back to the main connection.
+ *
+ * Each connection only sees data which has been committed to the file. In a database in WAL mode each statement reads from a
+ * consistent snapshot and neither blocks the writer nor is blocked by it. Handles can be passed between threads and acquired and
+ * released from any thread, but a connection must only be used by one thread at a time.
+ */
+class ConnectionPool
+{
+private:
+    struct State;
+
+public:
+    //! Is called for each new connection, e.g. for registering collations and functions. Return false to throw the connection away.
+    typedef std::function<bool(sqlite3*)> SetupFunction;
+
+    /*!
+     * \brief The Handle class gives access to a connection. The connection is handed back to the pool when the last copy of the handle
+     * is destroyed. All statements prepared on it must have been finalised by then.
+     */
+    class Handle
+    {
+    public:
+        Handle() {}
+
+        sqlite3* get() const { return m_data ? m_data->db : nullptr; }
+        operator sqlite3*() const { return get(); }
+        bool isValid() const { return get() != nullptr; }
+
+        //! Returns true if this is a connection of the pool and not a connection which has been wrapped using wrap()
+        bool isPooled() const { return m_data && m_data->state; }
+
+    private:
+        friend class ConnectionPool;
+
+        struct Data
+        {
+            ~Data();
+
+            std::shared_ptr<State> state;   // Null for wrapped connections
+            sqlite3* db;
+            int generation;
+        };
+
+        std::shared_ptr<Data> m_data;
+    };
+
+    explicit ConnectionPool(int maxConnections = 4);
+    ~ConnectionPool();
+
+    /*!
+     * \brief open makes the pool hand out connections to a database file. Connections to a previously opened file are closed.
+     * \param filename The database file
+     * \param setup Is called for each new connection
+     */
+    void open(const QString& filename, SetupFunction setup);
+
+    //! Closes all idle connections. Connections which are in use are closed as soon as their handles are destroyed.
+    void close();
+
+    //! Closes all idle connections and makes sure the ones which are in use right now aren't reused. New connections are opened instead.
+    void reset();
+
+    bool isOpen() const;
+
+    //! Returns a connection of the pool or an invalid handle if the pool isn't open, all connections are in use, or opening one failed
+    Handle acquire();
+
+    //! Returns true if the handle refers to a connection of this pool which would be reused after handing it back
+    bool isCurrent(const Handle& handle) const;
+
+    //! Wraps a connection which doesn't belong to the pool in a handle, so callers don't need to care where their connection comes from
+    static Handle wrap(sqlite3* db);
+
+    //! Number of connections which are open right now, in use or not
+    int size() const;
+
+private:
+    struct State
+    {
+        State() : inUse(0), generation(0) {}
+
+        QMutex mutex;
+        QString filename;
+        SetupFunction setup;
+        QVector<sqlite3*> idle;
+        int inUse;
+        int generation;     // Incremented whenever the connections which are in use must not be reused anymore
+    };
+
+    static void release(State& state, sqlite3* db, int generation);
+    static void closeIdle(State& state);
+
+    std::shared_ptr<State> m_state;     // Shared with the handles, so they can still be released after the pool has been destroyed
+    int m_maxConnections;
+};
+
+#endif
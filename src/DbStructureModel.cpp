@@ -3,19 +3,56 @@
 #include "sqlitetablemodel.h"
 #include "Settings.h"
 
-#include <QTreeWidgetItem>
 #include <QMimeData>
 #include <QMessageBox>
 #include <QApplication>
 
+struct DbStructureModel::Node
+{
+    enum Types
+    {
+        Folder,         // The root node, the browsables and schema nodes and the nodes grouping the objects of a schema by their type
+        Object,
+        Field
+    };
+
+    Node(Types type, Node* parent)
+        : type(type),
+          parent(parent),
+          row(parent ? parent->children.size() : 0),
+          fetched(true)
+    {
+        if(parent)
+            parent->children.push_back(this);
+    }
+
+    ~Node()
+    {
+        qDeleteAll(children);
+    }
+
+    Types type;
+    Node* parent;
+    int row;                            // Position of this node in the children of the parent node
+    QVector<Node*> children;
+    bool fetched;                       // False if the children of this node haven't been created yet
+
+    QString text;                       // Folders only
+    QString iconName;                   // Folders and fields only, objects use the icon of their type
+    QString schema;
+    sqlb::ObjectPtr object;             // Objects only
+    QVector<sqlb::ObjectPtr> pending;   // Folders only: the objects which are added as children when the folder is expanded first
+    sqlb::FieldInfo field;              // Fields only
+};
+
 DbStructureModel::DbStructureModel(DBBrowserDB& db, QObject* parent)
     : QAbstractItemModel(parent),
-      m_db(db)
+      m_db(db),
+      browsablesRootItem(nullptr)
 {
-    // Create root item and use its columns to store the header strings
-    QStringList header;
-    header << tr("Name") << tr("Object") << tr("Type") << tr("Schema") << tr("Database");
-    rootItem = new QTreeWidgetItem(header);
+    // Create root item and store the header strings
+    headerLabels << tr("Name") << tr("Object") << tr("Type") << tr("Schema") << tr("Database");
+    rootItem = new Node(Node::Folder, nullptr);
 }
 
 DbStructureModel::~DbStructureModel()
@@ -25,7 +62,7 @@ DbStructureModel::~DbStructureModel()
 
 int DbStructureModel::columnCount(const QModelIndex&) const
 {
-    return rootItem->columnCount();
+    return headerLabels.size();
 }
 
 QVariant DbStructureModel::data(const QModelIndex& index, int role) const
@@ -34,7 +71,7 @@ QVariant DbStructureModel::data(const QModelIndex& index, int role) const
         return QVariant();
 
     // Get the item the index points at
-    QTreeWidgetItem* item = static_cast<QTreeWidgetItem*>(index.internalPointer());
+    Node* item = nodeFromIndex(index);
 
     // Depending on the role either return the text or the icon
     switch(role)
@@ -43,15 +80,15 @@ QVariant DbStructureModel::data(const QModelIndex& index, int role) const
         // For the display role and the browsabled branch of the tree we want to show the column name including the schema name if necessary (i.e.
         // for schemata != "main"). For the normal structure branch of the tree we don't want to add the schema name because it's already obvious from
         // the position of the item in the tree.
-        if(index.column() == ColumnName && item->parent() == browsablesRootItem)
-            return sqlb::ObjectIdentifier(item->text(ColumnSchema), item->text(ColumnName)).toDisplayString();
+        if(index.column() == ColumnName && item->parent == browsablesRootItem)
+            return sqlb::ObjectIdentifier(item->schema, item->object->name()).toDisplayString();
         else
-            return Settings::getValue("db", "hideschemalinebreaks").toBool() ? item->text(index.column()).replace("\n", " ").simplified() : item->text(index.column());
+            return Settings::getValue("db", "hideschemalinebreaks").toBool() ? text(item, index.column()).replace("\n", " ").simplified() : text(item, index.column());
     case Qt::EditRole:
     case Qt::ToolTipRole:   // Don't modify the text when it's supposed to be shown in a tooltip
-        return item->text(index.column());
+        return text(item, index.column());
     case Qt::DecorationRole:
-        return item->icon(index.column());
+        return index.column() == ColumnName ? icon(item) : QIcon();
     default:
         return QVariant();
     }
@@ -66,8 +103,7 @@ Qt::ItemFlags DbStructureModel::flags(const QModelIndex &index) const
     Qt::ItemFlags flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDropEnabled;
 
     // Only enable dragging for entire table objects
-    QString type = data(index.sibling(index.row(), ColumnObjectType), Qt::DisplayRole).toString();
-    if(type == "table" || type == "view" || type == "index" || type == "trigger")
+    if(nodeFromIndex(index)->type == Node::Object)
         flags |= Qt::ItemIsDragEnabled;
 
     return flags;
@@ -75,9 +111,9 @@ Qt::ItemFlags DbStructureModel::flags(const QModelIndex &index) const
 
 QVariant DbStructureModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
-    // Get the header string from the root item
+    // Get the header string
     if(orientation == Qt::Horizontal && role == Qt::DisplayRole)
-        return rootItem->data(section, role);
+        return headerLabels.value(section);
 
     return QVariant();
 }
@@ -87,13 +123,7 @@ QModelIndex DbStructureModel::index(int row, int column, const QModelIndex& pare
     if(!hasIndex(row, column, parent))
         return QModelIndex();
 
-    QTreeWidgetItem *parentItem;
-    if(!parent.isValid())
-        parentItem = rootItem;
-    else
-        parentItem = static_cast<QTreeWidgetItem*>(parent.internalPointer());
-
-    QTreeWidgetItem* childItem = parentItem->child(row);
+    Node* childItem = nodeFromIndex(parent)->children.value(row);
     if(childItem)
         return createIndex(row, column, childItem);
     else
@@ -105,13 +135,12 @@ QModelIndex DbStructureModel::parent(const QModelIndex& index) const
     if(!index.isValid())
         return QModelIndex();
 
-    QTreeWidgetItem* childItem = static_cast<QTreeWidgetItem*>(index.internalPointer());
-    QTreeWidgetItem* parentItem = childItem->parent();
+    Node* parentItem = nodeFromIndex(index)->parent;
 
     if(parentItem == rootItem)
         return QModelIndex();
     else
-        return createIndex(0, 0, parentItem);
+        return createIndex(parentItem->row, 0, parentItem);
 }
 
 int DbStructureModel::rowCount(const QModelIndex& parent) const
@@ -119,10 +148,79 @@ int DbStructureModel::rowCount(const QModelIndex& parent) const
     if(parent.column() > 0)
         return 0;
 
-    if(!parent.isValid())
-        return rootItem->childCount();
+    return nodeFromIndex(parent)->children.size();
+}
+
+bool DbStructureModel::hasChildren(const QModelIndex& parent) const
+{
+    if(parent.column() > 0)
+        return false;
+
+    // Don't create the children just to find out whether there are any. Triggers are the only objects without any fields.
+    Node* node = nodeFromIndex(parent);
+    if(node->fetched)
+        return !node->children.isEmpty();
+    else if(node->type == Node::Folder)
+        return !node->pending.isEmpty();
     else
-        return static_cast<QTreeWidgetItem*>(parent.internalPointer())->childCount();
+        return node->object->type() != sqlb::Object::Types::Trigger;
+}
+
+bool DbStructureModel::canFetchMore(const QModelIndex& parent) const
+{
+    if(parent.column() > 0)
+        return false;
+
+    return !nodeFromIndex(parent)->fetched;
+}
+
+void DbStructureModel::fetchMore(const QModelIndex& parent)
+{
+    if(!canFetchMore(parent))
+        return;
+
+    Node* node = nodeFromIndex(parent);
+    node->fetched = true;
+
+    // Build the new nodes separately first because the model must announce them before they are added to the tree
+    Node children(Node::Folder, nullptr);
+    if(node->type == Node::Folder)
+    {
+        // Add the objects of this group
+        foreach(const sqlb::ObjectPtr& object, node->pending)
+        {
+            Node* item = addNode(&children, object, node->schema);
+            item->fetched = false;
+        }
+        node->pending.clear();
+    } else if(node->type == Node::Object) {
+        // Add the field nodes of this object
+        QStringList pk_columns;
+        if(node->object->type() == sqlb::Object::Types::Table)
+        {
+            sqlb::FieldVector pk = node->object.dynamicCast<sqlb::Table>()->primaryKey();
+            foreach(sqlb::FieldPtr pk_col, pk)
+                pk_columns.push_back(pk_col->name());
+        }
+
+        sqlb::FieldInfoList fieldList = node->object->fieldInformation();
+        foreach(const sqlb::FieldInfo& field, fieldList)
+        {
+            Node* fldItem = new Node(Node::Field, &children);
+            fldItem->field = field;
+            fldItem->schema = node->schema;
+            fldItem->iconName = pk_columns.contains(field.name) ? "field_key" : "field";
+        }
+    }
+
+    if(children.children.isEmpty())
+        return;
+
+    beginInsertRows(parent, 0, children.children.size() - 1);
+    foreach(Node* child, children.children)
+        child->parent = node;
+    node->children.swap(children.children);
+    endInsertRows();
 }
 
 void DbStructureModel::reloadData()
@@ -130,8 +228,9 @@ void DbStructureModel::reloadData()
     beginResetModel();
 
     // Remove all data except for the root item
-    while(rootItem->childCount())
-        delete rootItem->child(0);
+    qDeleteAll(rootItem->children);
+    rootItem->children.clear();
+    browsablesRootItem = nullptr;
 
     // Return here if no DB is opened
     if(!m_db.isOpen())
@@ -144,22 +243,18 @@ void DbStructureModel::reloadData()
     // In the root node there are two nodes: 'browsables' and 'all'. The first node contains a list of a all browsable objects, i.e. views and tables.
     // The seconds node contains four sub-nodes (tables, indices, views and triggers), each containing a list of objects of that type.
     // This way we only have to have and only have to update one model and can use it in all sorts of places, just by setting a different root node.
-    browsablesRootItem = new QTreeWidgetItem(rootItem);
-    browsablesRootItem->setIcon(ColumnName, QIcon(QString(":/icons/view")));
-    browsablesRootItem->setText(ColumnName, tr("Browsables"));
+    // The browsables are added right away because they are used for the list of tables in the Browse Data tab. The objects of the other
+    // sub-nodes are only added when they are expanded.
+    browsablesRootItem = addFolder(rootItem, tr("Browsables"), "view");
 
     // Make sure to always load the main schema first
-    QTreeWidgetItem* itemAll = new QTreeWidgetItem(rootItem);
-    itemAll->setIcon(ColumnName, QIcon(QString(":/icons/database")));
-    itemAll->setText(ColumnName, tr("All"));
+    Node* itemAll = addFolder(rootItem, tr("All"), "database");
     buildTree(itemAll, "main");
 
     // Add the temporary database as a node if it isn't empty. Make sure it's always second if it exists.
     if(!m_db.schemata["temp"].isEmpty())
     {
-        QTreeWidgetItem* itemTemp = new QTreeWidgetItem(itemAll);
-        itemTemp->setIcon(ColumnName, QIcon(QString(":/icons/database")));
-        itemTemp->setText(ColumnName, tr("Temporary"));
+        Node* itemTemp = addFolder(itemAll, tr("Temporary"), "database");
         buildTree(itemTemp, "temp");
     }
 
@@ -169,9 +264,7 @@ void DbStructureModel::reloadData()
         // Don't load the main and temp schema again
         if(it.key() != "main" && it.key() != "temp")
         {
-            QTreeWidgetItem* itemSchema = new QTreeWidgetItem(itemAll);
-            itemSchema->setIcon(ColumnName, QIcon(QString(":/icons/database")));
-            itemSchema->setText(ColumnName, it.key());
+            Node* itemSchema = addFolder(itemAll, it.key(), "database");
             buildTree(itemSchema, it.key());
         }
     }
@@ -252,89 +345,103 @@ bool DbStructureModel::dropMimeData(const QMimeData* data, Qt::DropAction action
     }
 }
 
-void DbStructureModel::buildTree(QTreeWidgetItem* parent, const QString& schema)
+void DbStructureModel::buildTree(Node* parent, const QString& schema)
 {
     // Build a map from object type to tree node to simplify finding the correct tree node later
-    QMap<QString, QTreeWidgetItem*> typeToParentItem;
+    QMap<QString, Node*> typeToParentItem;
 
     // Get object map for the given schema
     objectMap objmap = m_db.schemata[schema];
 
     // Prepare tree
-    QTreeWidgetItem* itemTables = new QTreeWidgetItem(parent);
-    itemTables->setIcon(ColumnName, QIcon(QString(":/icons/table")));
-    itemTables->setText(ColumnName, tr("Tables (%1)").arg(objmap.values("table").count()));
-    typeToParentItem.insert("table", itemTables);
-
-    QTreeWidgetItem* itemIndices = new QTreeWidgetItem(parent);
-    itemIndices->setIcon(ColumnName, QIcon(QString(":/icons/index")));
-    itemIndices->setText(ColumnName, tr("Indices (%1)").arg(objmap.values("index").count()));
-    typeToParentItem.insert("index", itemIndices);
-
-    QTreeWidgetItem* itemViews = new QTreeWidgetItem(parent);
-    itemViews->setIcon(ColumnName, QIcon(QString(":/icons/view")));
-    itemViews->setText(ColumnName, tr("Views (%1)").arg(objmap.values("view").count()));
-    typeToParentItem.insert("view", itemViews);
-
-    QTreeWidgetItem* itemTriggers = new QTreeWidgetItem(parent);
-    itemTriggers->setIcon(ColumnName, QIcon(QString(":/icons/trigger")));
-    itemTriggers->setText(ColumnName, tr("Triggers (%1)").arg(objmap.values("trigger").count()));
-    typeToParentItem.insert("trigger", itemTriggers);
+    typeToParentItem.insert("table", addFolder(parent, tr("Tables (%1)").arg(objmap.values("table").count()), "table"));
+    typeToParentItem.insert("index", addFolder(parent, tr("Indices (%1)").arg(objmap.values("index").count()), "index"));
+    typeToParentItem.insert("view", addFolder(parent, tr("Views (%1)").arg(objmap.values("view").count()), "view"));
+    typeToParentItem.insert("trigger", addFolder(parent, tr("Triggers (%1)").arg(objmap.values("trigger").count()), "trigger"));
 
     // Get all database objects and sort them by their name
     QMultiMap<QString, sqlb::ObjectPtr> dbobjs;
     for(auto it=objmap.constBegin(); it != objmap.constEnd(); ++it)
         dbobjs.insert((*it)->name(), (*it));
 
-    // Add the database objects to the tree nodes
+    // Remember the database objects in their group nodes. The object nodes are only created when a group is expanded.
     for(auto it=dbobjs.constBegin();it!=dbobjs.constEnd();++it)
     {
-        // Object node
-        QTreeWidgetItem* item = addNode(typeToParentItem.value(sqlb::Object::typeToString((*it)->type())), *it, schema);
-
-        // If it is a table or view add the field nodes, add an extra node for the browsable section
+        Node* group = typeToParentItem.value(sqlb::Object::typeToString((*it)->type()));
+        if(!group)
+            continue;
+        group->schema = schema;
+        group->pending.push_back(*it);
+        group->fetched = false;
+
+        // If it is a table or view add an extra node for the browsable section
         if((*it)->type() == sqlb::Object::Types::Table || (*it)->type() == sqlb::Object::Types::View)
             addNode(browsablesRootItem, *it, schema);
+    }
+}
 
-        // Add field nodes if there are any
-        sqlb::FieldInfoList fieldList = (*it)->fieldInformation();
-        if(!fieldList.empty())
-        {
-            QStringList pk_columns;
-            if((*it)->type() == sqlb::Object::Types::Table)
-            {
-                sqlb::FieldVector pk = (*it).dynamicCast<sqlb::Table>()->primaryKey();
-                foreach(sqlb::FieldPtr pk_col, pk)
-                    pk_columns.push_back(pk_col->name());
+DbStructureModel::Node* DbStructureModel::addFolder(Node* parent, const QString& text, const QString& icon)
+{
+    Node* item = new Node(Node::Folder, parent);
+    item->text = text;
+    item->iconName = icon;
+    return item;
+}
 
-            }
-            foreach(const sqlb::FieldInfo& field, fieldList)
-            {
-                QTreeWidgetItem *fldItem = new QTreeWidgetItem(item);
-                fldItem->setText(ColumnName, field.name);
-                fldItem->setText(ColumnObjectType, "field");
-                fldItem->setText(ColumnDataType, field.type);
-                fldItem->setText(ColumnSQL, field.sql);
-                fldItem->setText(ColumnSchema, schema);
-                if(pk_columns.contains(field.name))
-                    fldItem->setIcon(ColumnName, QIcon(":/icons/field_key"));
-                else
-                    fldItem->setIcon(ColumnName, QIcon(":/icons/field"));
-            }
-        }
-    }
+DbStructureModel::Node* DbStructureModel::addNode(Node* parent, const sqlb::ObjectPtr& object, const QString& schema)
+{
+    Node* item = new Node(Node::Object, parent);
+    item->object = object;
+    item->schema = schema;
+    return item;
 }
 
-QTreeWidgetItem* DbStructureModel::addNode(QTreeWidgetItem* parent, const sqlb::ObjectPtr& object, const QString& schema)
+DbStructureModel::Node* DbStructureModel::nodeFromIndex(const QModelIndex& index) const
 {
-    QString type = sqlb::Object::typeToString(object->type());
+    if(index.isValid())
+        return static_cast<Node*>(index.internalPointer());
+    else
+        return rootItem;
+}
 
-    QTreeWidgetItem *item = new QTreeWidgetItem(parent);
-    item->setIcon(ColumnName, QIcon(QString(":/icons/%1").arg(type)));
-    item->setText(ColumnName, object->name());
-    item->setText(ColumnObjectType, type);
-    item->setText(ColumnSQL, object->originalSql());
-    item->setText(ColumnSchema, schema);
+QString DbStructureModel::text(const Node* node, int column) const
+{
+    switch(node->type)
+    {
+    case Node::Folder:
+        if(column == ColumnName)
+            return node->text;
+        break;
+    case Node::Object:
+        switch(column)
+        {
+        case ColumnName: return node->object->name();
+        case ColumnObjectType: return sqlb::Object::typeToString(node->object->type());
+        case ColumnSQL: return node->object->originalSql();
+        case ColumnSchema: return node->schema;
+        }
+        break;
+    case Node::Field:
+        switch(column)
+        {
+        case ColumnName: return node->field.name;
+        case ColumnObjectType: return "field";
+        case ColumnDataType: return node->field.type;
+        case ColumnSQL: return node->field.sql;
+        case ColumnSchema: return node->schema;
+        }
+        break;
+    }
 
-    return item;
+    return QString();
+}
+
+QIcon DbStructureModel::icon(const Node* node) const
+{
+    // Only load each icon once instead of once per item
+    QString name = node->type == Node::Object ? sqlb::Object::typeToString(node->object->type()) : node->iconName;
+    auto it = iconCache.find(name);
+    if(it == iconCache.end())
+        it = iconCache.insert(name, QIcon(QString(":/icons/%1").arg(name)));
+    return it.value();
 }
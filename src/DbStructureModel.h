@@ -2,9 +2,11 @@
 #define DBSTRUCTUREMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QIcon>
+#include <QStringList>
 
 class DBBrowserDB;
-class QTreeWidgetItem;
 namespace sqlb { class Object; typedef QSharedPointer<Object> ObjectPtr; }
 
 class DbStructureModel : public QAbstractItemModel
@@ -24,6 +26,10 @@ public:
     QModelIndex parent(const QModelIndex& index) const;
     int rowCount(const QModelIndex& parent = QModelIndex()) const;
     int columnCount(const QModelIndex& = QModelIndex()) const;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const;
+
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
 
     QStringList mimeTypes() const;
     QMimeData* mimeData(const QModelIndexList& indices) const;
@@ -39,12 +45,22 @@ public:
     };
 
 private:
+    // The nodes of the tree only refer to the database objects of the schema instead of copying their data. The objects of a group node and
+    // the fields of an object node are only added when the node is expanded for the first time, see fetchMore().
+    struct Node;
+
     DBBrowserDB& m_db;
-    QTreeWidgetItem* rootItem;
-    QTreeWidgetItem* browsablesRootItem;
+    QStringList headerLabels;
+    Node* rootItem;
+    Node* browsablesRootItem;
+    mutable QHash<QString, QIcon> iconCache;
 
-    void buildTree(QTreeWidgetItem* parent, const QString& schema);
-    QTreeWidgetItem* addNode(QTreeWidgetItem* parent, const sqlb::ObjectPtr& object, const QString& schema);
+    void buildTree(Node* parent, const QString& schema);
+    Node* addFolder(Node* parent, const QString& text, const QString& icon);
+    Node* addNode(Node* parent, const sqlb::ObjectPtr& object, const QString& schema);
+    Node* nodeFromIndex(const QModelIndex& index) const;
+    QString text(const Node* node, int column) const;
+    QIcon icon(const Node* node) const;
 };
 
 #endif
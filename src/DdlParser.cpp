@@ -0,0 +1,832 @@
+#include "DdlParser.h"
+
+#include <QVarLengthArray>
+#include <cstring>
+
+namespace sqlb {
+
+namespace {
+
+struct Token
+{
+    enum Types
+    {
+        End,
+        Word,           // Keywords and unquoted identifiers
+        QuotedId,       // Identifiers in `backticks`, [brackets] or "double quotes"
+        String,         // 'String literals'
+        Number,         // Numbers and blob literals
+        Symbol          // Parentheses, commas, operators etc.
+    };
+
+    Types type;
+    int start;          // Position in the statement
+    int length;
+};
+
+bool isIdentifierStart(ushort c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80;
+}
+
+bool isDigit(ushort c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool isHexDigit(ushort c)
+{
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+bool isIdentifierChar(ushort c)
+{
+    return isIdentifierStart(c) || isDigit(c) || c == '$';
+}
+
+class Parser
+{
+public:
+    explicit Parser(const QString& sql);
+
+    TablePtr table();
+    IndexPtr index();
+
+private:
+    enum ExpressionEnd
+    {
+        UntilParenthesis,       // The closing parenthesis of the expression, e.g. in CHECK(...)
+        UntilIndexedColumnEnd,  // The end of a column in an index: a comma, the closing parenthesis, COLLATE, ASC or DESC
+        UntilStatementEnd       // A semicolon or the end of the statement
+    };
+
+    bool tokenize();
+
+    const Token& token(int pos) const { return pos < m_tokens.size() ? m_tokens.at(pos) : m_end; }
+    const Token& peek(int ahead = 0) const { return token(m_pos + ahead); }
+
+    bool isKeyword(const Token& t, const char* keyword) const;
+    bool isSymbol(const Token& t, const char* symbol) const;
+    static bool isName(const Token& t) { return t.type == Token::Word || t.type == Token::QuotedId || t.type == Token::String; }
+
+    bool acceptKeyword(const char* keyword);
+    bool acceptSymbol(const char* symbol);
+    bool acceptName(QString& name);
+    bool acceptIfNotExists();
+    bool acceptSignedNumber();
+    bool acceptStatementEnd();
+
+    QString text(const Token& t) const { return m_sql.mid(t.start, t.length); }
+    QString identifier(const Token& t) const;
+    QString join(int begin, int end, bool withSpace) const;
+    int expressionEnd(ExpressionEnd until) const;
+
+    bool column(Table* table);
+    bool tableConstraint(Table* table);
+    bool indexedColumns(Table* table, FieldVector& fields, bool allowAutoIncrement);
+    bool foreignKeyClause(ForeignKeyClause* fk);
+    bool indexedColumn(Index* index);
+
+    const QString& m_sql;
+    QVarLengthArray<Token, 256> m_tokens;
+    Token m_end;
+    int m_pos;
+    bool m_valid;
+};
+
+Parser::Parser(const QString& sql)
+    : m_sql(sql),
+      m_pos(0)
+{
+    m_end.type = Token::End;
+    m_end.start = sql.size();
+    m_end.length = 0;
+
+    m_valid = tokenize();
+}
+
+bool Parser::tokenize()
+{
+    const QChar* data = m_sql.constData();
+    const int size = m_sql.size();
+
+    int i = 0;
+    while(i < size)
+    {
+        const ushort c = data[i].unicode();
+        const ushort next = i + 1 < size ? data[i+1].unicode() : 0;
+
+        // Skip white space and comments
+        if(data[i].isSpace())
+        {
+            i++;
+            continue;
+        } else if(c == '-' && next == '-') {
+            while(i < size && data[i] != '\n')
+                i++;
+            continue;
+        } else if(c == '/' && next == '*') {
+            int end = m_sql.indexOf("*/", i + 2);
+            i = (end == -1) ? size : end + 2;
+            continue;
+        }
+
+        Token t;
+        t.start = i;
+
+        if(c == '`' || c == '"' || c == '[' || c == '\'' || ((c == 'x' || c == 'X') && next == '\''))
+        {
+            if(c == '\'')
+                t.type = Token::String;
+            else if(c == 'x' || c == 'X')
+                t.type = Token::Number;
+            else
+                t.type = Token::QuotedId;
+
+            if(t.type == Token::Number)
+                i++;
+
+            // Two quote characters in a row are an escaped quote character. This doesn't apply to brackets.
+            const ushort quote = (c == '[') ? ']' : data[i].unicode();
+            i++;
+            for(;;)
+            {
+                if(i >= size)
+                    return false;
+                if(data[i] == quote)
+                {
+                    if(quote != ']' && i + 1 < size && data[i+1] == quote)
+                    {
+                        i += 2;
+                        continue;
+                    }
+                    i++;
+                    break;
+                }
+                i++;
+            }
+        } else if(isIdentifierStart(c)) {
+            t.type = Token::Word;
+            while(i < size && isIdentifierChar(data[i].unicode()))
+                i++;
+        } else if(isDigit(c) || (c == '.' && isDigit(next))) {
+            t.type = Token::Number;
+            if(c == '0' && (next == 'x' || next == 'X'))
+            {
+                i += 2;
+                while(i < size && isHexDigit(data[i].unicode()))
+                    i++;
+            } else {
+                while(i < size && isDigit(data[i].unicode()))
+                    i++;
+                if(i < size && data[i] == '.')
+                {
+                    i++;
+                    while(i < size && isDigit(data[i].unicode()))
+                        i++;
+                }
+                if(i < size && (data[i] == 'e' || data[i] == 'E'))
+                {
+                    i++;
+                    if(i < size && (data[i] == '+' || data[i] == '-'))
+                        i++;
+                    if(i >= size || !isDigit(data[i].unicode()))
+                        return false;
+                    while(i < size && isDigit(data[i].unicode()))
+                        i++;
+                }
+            }
+
+            // Something like 123abc isn't valid
+            if(i < size && isIdentifierChar(data[i].unicode()))
+                return false;
+        } else {
+            t.type = Token::Symbol;
+
+            static const char* const twoCharSymbols[] = {"||", "==", "!=", "<>", "<=", ">=", "<<", ">>"};
+            bool found = false;
+            for(const char* symbol : twoCharSymbols)
+            {
+                if(c == symbol[0] && next == symbol[1])
+                {
+                    i += 2;
+                    found = true;
+                    break;
+                }
+            }
+
+            if(!found)
+            {
+                // Bind parameters and anything else which doesn't belong into a schema aren't supported
+                if(c == 0 || c >= 0x80 || !strchr("(),;.+-*/%&|~=<>", c))
+                    return false;
+                i++;
+            }
+        }
+
+        t.length = i - t.start;
+        m_tokens.append(t);
+    }
+
+    return true;
+}
+
+bool Parser::isKeyword(const Token& t, const char* keyword) const
+{
+    return t.type == Token::Word && QStringRef(&m_sql, t.start, t.length).compare(QLatin1String(keyword), Qt::CaseInsensitive) == 0;
+}
+
+bool Parser::isSymbol(const Token& t, const char* symbol) const
+{
+    return t.type == Token::Symbol && QStringRef(&m_sql, t.start, t.length) == QLatin1String(symbol);
+}
+
+bool Parser::acceptKeyword(const char* keyword)
+{
+    if(isKeyword(peek(), keyword))
+    {
+        m_pos++;
+        return true;
+    }
+    return false;
+}
+
+bool Parser::acceptSymbol(const char* symbol)
+{
+    if(isSymbol(peek(), symbol))
+    {
+        m_pos++;
+        return true;
+    }
+    return false;
+}
+
+bool Parser::acceptName(QString& name)
+{
+    if(!isName(peek()))
+        return false;
+
+    name = identifier(peek());
+    m_pos++;
+    return true;
+}
+
+bool Parser::acceptIfNotExists()
+{
+    // Tables and indices can be called 'if', so only treat this as IF NOT EXISTS if it looks like it
+    if(isKeyword(peek(), "IF") && isKeyword(peek(1), "NOT"))
+    {
+        m_pos += 2;
+        return acceptKeyword("EXISTS");
+    }
+    return true;
+}
+
+bool Parser::acceptSignedNumber()
+{
+    if(!acceptSymbol("+"))
+        acceptSymbol("-");
+
+    if(peek().type != Token::Number)
+        return false;
+    m_pos++;
+    return true;
+}
+
+bool Parser::acceptStatementEnd()
+{
+    acceptSymbol(";");
+    return peek().type == Token::End;
+}
+
+QString Parser::identifier(const Token& t) const
+{
+    if(t.type != Token::QuotedId && t.type != Token::String)
+        return text(t);
+
+    // Remove the quotes and replace two succeeding quote characters by a single one because that's how they are escaped
+    QString name = m_sql.mid(t.start + 1, t.length - 2);
+    const QChar quote = m_sql.at(t.start);
+    if(quote != '[')
+        name.replace(QString(2, quote), quote);
+    return name;
+}
+
+QString Parser::join(int begin, int end, bool withSpace) const
+{
+    QString result;
+    for(int i=begin;i<end;i++)
+    {
+        if(withSpace && i != begin)
+            result.append(' ');
+        result.append(QStringRef(&m_sql, token(i).start, token(i).length));
+    }
+    return result;
+}
+
+int Parser::expressionEnd(ExpressionEnd until) const
+{
+    int depth = 0;
+    int pos = m_pos;
+    for(;;pos++)
+    {
+        const Token& t = token(pos);
+
+        if(t.type == Token::End || isSymbol(t, ";"))
+        {
+            if(until == UntilStatementEnd && depth == 0)
+                break;
+            return -1;
+        }
+
+        if(depth == 0)
+        {
+            if(isSymbol(t, ")"))
+            {
+                if(until == UntilStatementEnd)
+                    return -1;
+                break;
+            }
+
+            if(until == UntilIndexedColumnEnd &&
+                    (isSymbol(t, ",") || isKeyword(t, "COLLATE") || isKeyword(t, "ASC") || isKeyword(t, "DESC")))
+                break;
+        }
+
+        if(isSymbol(t, "("))
+            depth++;
+        else if(isSymbol(t, ")"))
+            depth--;
+    }
+
+    // Empty expressions aren't valid
+    return pos == m_pos ? -1 : pos;
+}
+
+TablePtr Parser::table()
+{
+    if(!m_valid)
+        return TablePtr();
+
+    TablePtr table(new Table(""));
+    table->setFullyParsed(true);
+
+    // Virtual tables and CREATE TABLE ... AS SELECT statements are left to the antlr based parser
+    if(!acceptKeyword("CREATE"))
+        return TablePtr();
+    if(!acceptKeyword("TEMP"))
+        acceptKeyword("TEMPORARY");
+    if(!acceptKeyword("TABLE") || !acceptIfNotExists())
+        return TablePtr();
+
+    QString name;
+    if(!acceptName(name) || !acceptSymbol("("))
+        return TablePtr();
+    table->setName(name);
+
+    // Column definitions. They are followed by the table constraints which may or may not be separated by a comma.
+    do
+    {
+        const Token& t = peek();
+        if(isKeyword(t, "CONSTRAINT") || isKeyword(t, "PRIMARY") || isKeyword(t, "UNIQUE") || isKeyword(t, "CHECK") || isKeyword(t, "FOREIGN"))
+            break;
+
+        if(!column(table.data()))
+            return TablePtr();
+    } while(acceptSymbol(","));
+
+    while(!acceptSymbol(")"))
+    {
+        acceptSymbol(",");
+        if(!tableConstraint(table.data()))
+            return TablePtr();
+    }
+
+    if(acceptKeyword("WITHOUT"))
+    {
+        if(!acceptKeyword("ROWID") || table->findPk() == -1)
+            return TablePtr();
+
+        table->setRowidColumn(table->fields().at(table->findPk())->name());
+    }
+
+    if(!acceptStatementEnd())
+        return TablePtr();
+
+    return table;
+}
+
+bool Parser::column(Table* table)
+{
+    QString colname;
+    if(!acceptName(colname))
+        return false;
+
+    // The type consists of any number of names which may be followed by one or two numbers in parentheses
+    int typeBegin = m_pos;
+    while(isName(peek()) &&
+          !isKeyword(peek(), "CONSTRAINT") &&
+          !isKeyword(peek(), "PRIMARY") &&
+          !isKeyword(peek(), "NOT") &&
+          !isKeyword(peek(), "NULL") &&
+          !isKeyword(peek(), "UNIQUE") &&
+          !isKeyword(peek(), "CHECK") &&
+          !isKeyword(peek(), "DEFAULT") &&
+          !isKeyword(peek(), "COLLATE") &&
+          !isKeyword(peek(), "REFERENCES"))
+        m_pos++;
+    if(m_pos != typeBegin && acceptSymbol("("))
+    {
+        if(!acceptSignedNumber())
+            return false;
+        if(acceptSymbol(",") && !acceptSignedNumber())
+            return false;
+        if(!acceptSymbol(")"))
+            return false;
+    }
+    QString type = (m_pos == typeBegin) ? QString("TEXT") : join(typeBegin, m_pos, true);
+
+    bool autoincrement = false;
+    bool notnull = false;
+    bool unique = false;
+    QString defaultvalue;
+    QString check;
+    QString collation;
+    ConstraintPtr primaryKey;
+    ConstraintPtr foreignKey;
+
+    // Column constraints. Conflict clauses are left to the antlr based parser. Only primary and foreign keys can keep their constraint
+    // names, so a name on any other constraint would get lost and the table isn't marked as fully parsed then.
+    while(!isSymbol(peek(), ",") && !isSymbol(peek(), ")"))
+    {
+        QString constraint_name;
+        if(acceptKeyword("CONSTRAINT") && !acceptName(constraint_name))
+            return false;
+
+        if(acceptKeyword("PRIMARY"))
+        {
+            if(!acceptKeyword("KEY"))
+                return false;
+            if(acceptKeyword("ASC") || acceptKeyword("DESC"))
+                table->setFullyParsed(false);
+            if(isKeyword(peek(), "ON"))
+                return false;
+            if(acceptKeyword("AUTOINCREMENT"))
+                autoincrement = true;
+
+            primaryKey = ConstraintPtr(new PrimaryKeyConstraint);
+            primaryKey->setName(constraint_name);
+        } else if(acceptKeyword("NOT")) {
+            if(!acceptKeyword("NULL") || isKeyword(peek(), "ON"))
+                return false;
+
+            if(!constraint_name.isEmpty())
+                table->setFullyParsed(false);
+
+            notnull = true;
+        } else if(acceptKeyword("NULL")) {
+            if(isKeyword(peek(), "ON"))
+                return false;
+
+            notnull = false;
+        } else if(acceptKeyword("UNIQUE")) {
+            if(isKeyword(peek(), "ON"))
+                return false;
+
+            if(!constraint_name.isEmpty())
+                table->setFullyParsed(false);
+
+            unique = true;
+        } else if(acceptKeyword("CHECK")) {
+            if(!acceptSymbol("("))
+                return false;
+            int end = expressionEnd(UntilParenthesis);
+            if(end == -1)
+                return false;
+
+            if(!constraint_name.isEmpty())
+                table->setFullyParsed(false);
+
+            check = join(m_pos, end, true);
+            m_pos = end + 1;
+        } else if(acceptKeyword("DEFAULT")) {
+            // The default value is either an expression in parentheses, a signed number or a single literal or name
+            int begin = m_pos;
+            if(acceptSymbol("("))
+            {
+                int end = expressionEnd(UntilParenthesis);
+                if(end == -1)
+                    return false;
+                m_pos = end + 1;
+            } else if(isSymbol(peek(), "+") || isSymbol(peek(), "-")) {
+                if(!acceptSignedNumber())
+                    return false;
+            } else if(isName(peek()) || peek().type == Token::Number) {
+                m_pos++;
+            } else {
+                return false;
+            }
+
+            if(!constraint_name.isEmpty())
+                table->setFullyParsed(false);
+
+            defaultvalue = join(begin, m_pos, false);
+        } else if(acceptKeyword("COLLATE")) {
+            if(peek().type != Token::Word)
+                return false;
+            if(!constraint_name.isEmpty())
+                table->setFullyParsed(false);
+
+            collation = text(peek());
+            m_pos++;
+        } else if(acceptKeyword("REFERENCES")) {
+            ForeignKeyClause* fk = new ForeignKeyClause;
+            foreignKey = ConstraintPtr(fk);
+            fk->setName(constraint_name);
+            if(!foreignKeyClause(fk))
+                return false;
+        } else {
+            return false;
+        }
+    }
+
+    FieldPtr f = FieldPtr(new Field(colname, type, notnull, defaultvalue, check, unique, collation));
+    f->setAutoIncrement(autoincrement);
+    table->addField(f);
+
+    if(foreignKey)
+        table->addConstraint({f}, foreignKey);
+    if(primaryKey)
+    {
+        // If there already is a primary key object for this table, add the field to it instead of creating a second one
+        if(table->constraint(FieldVector(), Constraint::PrimaryKeyConstraintType))
+            table->primaryKeyRef().push_back(f);
+        else
+            table->addConstraint({f}, primaryKey);
+    }
+
+    return true;
+}
+
+bool Parser::tableConstraint(Table* table)
+{
+    QString constraint_name;
+    if(acceptKeyword("CONSTRAINT") && !acceptName(constraint_name))
+        return false;
+
+    if(acceptKeyword("PRIMARY"))
+    {
+        FieldVector fields;
+        if(!acceptKeyword("KEY") || !indexedColumns(table, fields, true))
+            return false;
+
+        ConstraintPtr pk(new PrimaryKeyConstraint);
+        pk->setName(constraint_name);
+        table->addConstraint(fields, pk);
+    } else if(acceptKeyword("UNIQUE")) {
+        FieldVector fields;
+        if(!indexedColumns(table, fields, false))
+            return false;
+
+        if(fields.size() == 1 && constraint_name.isEmpty())
+        {
+            fields[0]->setUnique(true);
+        } else {
+            ConstraintPtr unique(new UniqueConstraint);
+            unique->setName(constraint_name);
+            table->addConstraint(fields, unique);
+        }
+    } else if(acceptKeyword("CHECK")) {
+        if(!acceptSymbol("("))
+            return false;
+        int end = expressionEnd(UntilParenthesis);
+        if(end == -1)
+            return false;
+
+        CheckConstraint* check = new CheckConstraint(join(m_pos, end, true));
+        check->setName(constraint_name);
+        table->addConstraint(FieldVector(), ConstraintPtr(check));
+        m_pos = end + 1;
+    } else if(acceptKeyword("FOREIGN")) {
+        if(!acceptKeyword("KEY") || !acceptSymbol("("))
+            return false;
+
+        FieldVector fields;
+        do
+        {
+            QString col;
+            if(!acceptName(col) || table->findField(col) == -1)
+                return false;
+            fields.push_back(table->field(table->findField(col)));
+        } while(acceptSymbol(","));
+
+        if(!acceptSymbol(")") || !acceptKeyword("REFERENCES"))
+            return false;
+
+        ForeignKeyClause* fk = new ForeignKeyClause;
+        ConstraintPtr constraint(fk);
+        fk->setName(constraint_name);
+        if(!foreignKeyClause(fk))
+            return false;
+        table->addConstraint(fields, constraint);
+    } else {
+        return false;
+    }
+
+    // Conflict clauses are left to the antlr based parser
+    return !isKeyword(peek(), "ON");
+}
+
+bool Parser::indexedColumns(Table* table, FieldVector& fields, bool allowAutoIncrement)
+{
+    if(!acceptSymbol("("))
+        return false;
+
+    do
+    {
+        QString col;
+        if(!acceptName(col) || table->findField(col) == -1)
+            return false;
+        FieldPtr field = table->field(table->findField(col));
+        fields.push_back(field);
+
+        // Collations and sort orders of the columns of table constraints can't be stored, so the table isn't fully parsed when they're used
+        if(acceptKeyword("COLLATE"))
+        {
+            if(peek().type != Token::Word)
+                return false;
+            m_pos++;
+            table->setFullyParsed(false);
+        }
+        if(acceptKeyword("ASC") || acceptKeyword("DESC"))
+            table->setFullyParsed(false);
+
+        if(allowAutoIncrement && acceptKeyword("AUTOINCREMENT"))
+            field->setAutoIncrement(true);
+    } while(acceptSymbol(","));
+
+    return acceptSymbol(")");
+}
+
+bool Parser::foreignKeyClause(ForeignKeyClause* fk)
+{
+    QString table;
+    if(!acceptName(table))
+        return false;
+    fk->setTable(table);
+
+    if(acceptSymbol("("))
+    {
+        QStringList columns;
+        do
+        {
+            QString col;
+            if(!acceptName(col))
+                return false;
+            columns.push_back(col);
+        } while(acceptSymbol(","));
+
+        if(!acceptSymbol(")"))
+            return false;
+        fk->setColumns(columns);
+    }
+
+    // Everything else is stored as it is
+    int begin = m_pos;
+    for(;;)
+    {
+        if(acceptKeyword("ON"))
+        {
+            if(!acceptKeyword("DELETE") && !acceptKeyword("UPDATE") && !acceptKeyword("INSERT"))
+                return false;
+
+            if(acceptKeyword("SET"))
+            {
+                if(!acceptKeyword("NULL") && !acceptKeyword("DEFAULT"))
+                    return false;
+            } else if(acceptKeyword("NO")) {
+                if(!acceptKeyword("ACTION"))
+                    return false;
+            } else if(!acceptKeyword("CASCADE") && !acceptKeyword("RESTRICT")) {
+                return false;
+            }
+        } else if(acceptKeyword("MATCH")) {
+            QString name;
+            if(!acceptName(name))
+                return false;
+        } else {
+            break;
+        }
+    }
+
+    // NOT NULL might follow a foreign key clause in a column definition
+    bool deferrable = false;
+    if(isKeyword(peek(), "NOT") && isKeyword(peek(1), "DEFERRABLE"))
+    {
+        m_pos += 2;
+        deferrable = true;
+    } else if(acceptKeyword("DEFERRABLE")) {
+        deferrable = true;
+    }
+    if(deferrable && acceptKeyword("INITIALLY") && !acceptKeyword("DEFERRED") && !acceptKeyword("IMMEDIATE"))
+        return false;
+
+    fk->setConstraint(join(begin, m_pos, true));
+    return true;
+}
+
+IndexPtr Parser::index()
+{
+    if(!m_valid)
+        return IndexPtr();
+
+    IndexPtr index(new Index(""));
+    index->setFullyParsed(true);
+
+    if(!acceptKeyword("CREATE"))
+        return IndexPtr();
+    if(acceptKeyword("UNIQUE"))
+        index->setUnique(true);
+    if(!acceptKeyword("INDEX") || !acceptIfNotExists())
+        return IndexPtr();
+
+    QString name, table;
+    if(!acceptName(name) || !acceptKeyword("ON") || !acceptName(table) || !acceptSymbol("("))
+        return IndexPtr();
+    index->setName(name);
+    index->setTable(table);
+
+    do
+    {
+        if(!indexedColumn(index.data()))
+            return IndexPtr();
+    } while(acceptSymbol(","));
+
+    if(!acceptSymbol(")"))
+        return IndexPtr();
+
+    // Partial index
+    if(acceptKeyword("WHERE"))
+    {
+        int end = expressionEnd(UntilStatementEnd);
+        if(end == -1)
+            return IndexPtr();
+
+        index->setWhereExpr(join(m_pos, end, true));
+        m_pos = end;
+    }
+
+    if(!acceptStatementEnd())
+        return IndexPtr();
+
+    return index;
+}
+
+bool Parser::indexedColumn(Index* index)
+{
+    // A single token is a column name, everything else is an expression
+    int end = expressionEnd(UntilIndexedColumnEnd);
+    if(end == -1)
+        return false;
+
+    QString name;
+    bool isExpression = end - m_pos > 1;
+    if(isExpression)
+        name = join(m_pos, end, true);
+    else
+        name = identifier(peek());
+    m_pos = end;
+
+    // Index columns don't store their collation, so the index isn't fully parsed when there is one
+    if(acceptKeyword("COLLATE"))
+    {
+        if(peek().type != Token::Word)
+            return false;
+        m_pos++;
+        index->setFullyParsed(false);
+    }
+
+    QString order;
+    if(isKeyword(peek(), "ASC") || isKeyword(peek(), "DESC"))
+    {
+        order = text(peek());
+        m_pos++;
+    }
+
+    index->addColumn(IndexedColumnPtr(new IndexedColumn(name, isExpression, order)));
+    return true;
+}
+
+}
+
+TablePtr DdlParser::parseTable(const QString& sql)
+{
+    return Parser(sql).table();
+}
+
+IndexPtr DdlParser::parseIndex(const QString& sql)
+{
+    return Parser(sql).index();
+}
+
+}
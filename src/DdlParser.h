@@ -0,0 +1,31 @@
+#ifndef DDLPARSER_H
+#define DDLPARSER_H
+
+#include "sqlitetypes.h"
+
+namespace sqlb {
+
+/*!
+ * \brief The DdlParser class
+ *
+ * This is a hand-written parser for the CREATE TABLE and CREATE INDEX statements stored in the schema. It builds the objects directly
+ * while walking through the tokens of the statement, without building a syntax tree first, and only allocates the strings which end up in
+ * the objects. This makes it a lot faster than the antlr based parser, which matters when opening databases with large schemata.
+ *
+ * It returns the same objects as the antlr based parser but only understands the syntax which is commonly used. When it encounters
+ * anything else, e.g. virtual tables, conflict clauses or a syntax error, it gives up and returns a null pointer. The caller should use
+ * the antlr based parser then.
+ */
+class DdlParser
+{
+public:
+    //! Parses a CREATE TABLE statement. Returns a null pointer if the statement isn't supported by this parser.
+    static TablePtr parseTable(const QString& sql);
+
+    //! Parses a CREATE INDEX statement. Returns a null pointer if the statement isn't supported by this parser.
+    static IndexPtr parseIndex(const QString& sql);
+};
+
+}
+
+#endif
@@ -89,6 +89,27 @@ EditIndexDialog::~EditIndexDialog()
     delete ui;
 }
 
+void EditIndexDialog::setIndex(const sqlb::ObjectIdentifier& table, const sqlb::Index& suggestion)
+{
+    index = suggestion;
+    index.setTable(table.name());
+
+    ui->comboTableName->blockSignals(true);
+    ui->comboTableName->setCurrentText(table.toDisplayString());
+    ui->comboTableName->blockSignals(false);
+    ui->editIndexName->blockSignals(true);
+    ui->editIndexName->setText(index.name());
+    ui->editIndexName->blockSignals(false);
+    ui->checkIndexUnique->blockSignals(true);
+    ui->checkIndexUnique->setChecked(index.unique());
+    ui->checkIndexUnique->blockSignals(false);
+    ui->editPartialClause->blockSignals(true);
+    ui->editPartialClause->setText(index.whereExpr());
+    ui->editPartialClause->blockSignals(false);
+
+    tableChanged(index.table(), true);
+}
+
 void EditIndexDialog::tableChanged(const QString& new_table, bool initialLoad)
 {
     // Set the table name and clear all index columns
@@ -20,6 +20,9 @@ public:
     explicit EditIndexDialog(DBBrowserDB& db, const sqlb::ObjectIdentifier& indexName, bool createIndex, QWidget* parent = 0);
     ~EditIndexDialog();
 
+    //! Fills in a new index, e.g. one which has been suggested to the user. The table must exist.
+    void setIndex(const sqlb::ObjectIdentifier& table, const sqlb::Index& suggestion);
+
 private slots:
     void accept();
     void reject();
@@ -6,11 +6,187 @@
 #include "FileDialog.h"
 
 #include <QFile>
+#include <QLocale>
 #include <QTextStream>
 #include <QMessageBox>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonObject>
+#include <cmath>
+
+namespace {
+// Writes the rows of a query as JSON objects without building the entire document in memory first
+class JsonWriter
+{
+public:
+    enum Format
+    {
+        Pretty,             // Array of objects with one key/value pair per line, indented like QJsonDocument::Indented
+        Compact,            // Array of objects without any whitespace
+        NewLineDelimited    // One compact object per line without a surrounding array
+    };
+
+    JsonWriter(QIODevice& device, Format format)
+        : m_device(device),
+          m_format(format),
+          m_rows(0),
+          m_failed(false)
+    {
+        m_buffer.reserve(BufferSize + 64 * 1024);
+    }
+
+    void setColumns(const QStringList& names)
+    {
+        // The keys are the same for all rows, so they are only escaped once
+        m_keys.clear();
+        foreach(const QString& name, names)
+        {
+            QByteArray key;
+            if(m_format == Pretty)
+                key.append("        ");
+            appendString(key, name.toUtf8());
+            key.append(m_format == Pretty ? ": " : ":");
+            m_keys.push_back(key);
+        }
+    }
+
+    void writeRow(sqlite3_stmt* stmt)
+    {
+        if(m_format == NewLineDelimited)
+            m_buffer.append('{');
+        else if(m_format == Pretty)
+            m_buffer.append(m_rows ? ",\n    {\n" : "[\n    {\n");
+        else
+            m_buffer.append(m_rows ? ",{" : "[{");
+
+        for(int i=0;i<m_keys.size();i++)
+        {
+            if(i)
+                m_buffer.append(m_format == Pretty ? ",\n" : ",");
+            m_buffer.append(m_keys.at(i));
+            appendValue(stmt, i);
+        }
+
+        if(m_format == Pretty)
+            m_buffer.append("\n    }");
+        else
+            m_buffer.append(m_format == NewLineDelimited ? "}\n" : "}");
+
+        m_rows++;
+        if(m_buffer.size() >= BufferSize)
+            flush();
+    }
+
+    void finish()
+    {
+        if(m_format == Pretty)
+            m_buffer.append(m_rows ? "\n]\n" : "[\n]\n");
+        else if(m_format == Compact)
+            m_buffer.append(m_rows ? "]" : "[]");
+        flush();
+    }
+
+    bool failed() const { return m_failed; }
+
+private:
+    static const int BufferSize = 1024 * 1024;
+
+    void flush()
+    {
+        if(!m_failed && m_device.write(m_buffer) != m_buffer.size())
+            m_failed = true;
+        m_buffer.resize(0);
+    }
+
+    void appendValue(sqlite3_stmt* stmt, int column)
+    {
+        switch(sqlite3_column_type(stmt, column))
+        {
+        case SQLITE_NULL:
+            m_buffer.append("null");
+            break;
+        case SQLITE_INTEGER:
+            m_buffer.append(QByteArray::number(sqlite3_column_int64(stmt, column)));
+            break;
+        case SQLITE_FLOAT:
+        {
+            // JSON has no representation for infinity and NaN
+            double value = sqlite3_column_double(stmt, column);
+            // Write the shortest representation which reads back as the same value, i.e. 0.1 and not 0.10000000000000001. Before
+            // Qt 5.7 there is no way of getting it, so use 17 digits which read back as the same value, too.
+            if(std::isfinite(value))
+#if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
+                m_buffer.append(QByteArray::number(value, 'g', QLocale::FloatingPointShortest));
+#else
+                m_buffer.append(QByteArray::number(value, 'g', 17));
+#endif
+            else
+                m_buffer.append("null");
+            break;
+        }
+        default:
+        {
+            // Text and binary data are written as strings. Invalid UTF-8 sequences are replaced as before when the values were converted
+            // to QStrings for the QJsonDocument.
+            const char* data = reinterpret_cast<const char*>(sqlite3_column_blob(stmt, column));
+            int size = sqlite3_column_bytes(stmt, column);
+            QByteArray value = QByteArray::fromRawData(data, size);
+            for(int i=0;i<size;i++)
+            {
+                if(static_cast<unsigned char>(data[i]) >= 0x80)
+                {
+                    value = QString::fromUtf8(data, size).toUtf8();
+                    break;
+                }
+            }
+            appendString(m_buffer, value);
+            break;
+        }
+        }
+    }
+
+    static void appendString(QByteArray& out, const QByteArray& value)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        out.append('"');
+        const char* p = value.constData();
+        const char* end = p + value.size();
+        const char* run = p;
+        for(;p<end;p++)
+        {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if(c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            // Copy everything which doesn't need to be escaped at once
+            out.append(run, p - run);
+            run = p + 1;
+            switch(c)
+            {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                out.append("\\u00");
+                out.append(hex[c >> 4]);
+                out.append(hex[c & 0xF]);
+                break;
+            }
+        }
+        out.append(run, p - run);
+        out.append('"');
+    }
+
+    QIODevice& m_device;
+    Format m_format;
+    QVector<QByteArray> m_keys;
+    QByteArray m_buffer;
+    quint64 m_rows;
+    bool m_failed;
+};
+}
 
 ExportDataDialog::ExportDataDialog(DBBrowserDB& db, ExportFormats format, QWidget* parent, const QString& query, const sqlb::ObjectIdentifier& selection)
     : QDialog(parent),
@@ -34,6 +210,7 @@ ExportDataDialog::ExportDataDialog(DBBrowserDB& db, ExportFormats format, QWidge
     setQuoteChar(Settings::getValue("exportcsv", "quotecharacter").toInt());
     setNewLineString(Settings::getValue("exportcsv", "newlinecharacters").toString());
     ui->checkPrettyPrint->setChecked(Settings::getValue("exportjson", "prettyprint").toBool());
+    ui->checkNewLineDelimited->setChecked(Settings::getValue("exportjson", "newlinedelimited").toBool());
 
     // Update the visible/hidden status of the "Other" line edit fields
     showCustomCharEdits();
@@ -113,10 +290,12 @@ bool ExportDataDialog::exportQueryCsv(const QString& sQuery, const QString& sFil
         // Open text stream to the file
         QTextStream stream(&file);
 
+        // Read on a separate connection if possible, so browsing the database isn't blocked while exporting
+        ConnectionPool::Handle connection = pdb.readConnection();
         QByteArray utf8Query = sQuery.toUtf8();
         sqlite3_stmt *stmt;
 
-        int status = sqlite3_prepare_v2(pdb._db, utf8Query.data(), utf8Query.size(), &stmt, NULL);
+        int status = sqlite3_prepare_v2(connection, utf8Query.data(), utf8Query.size(), &stmt, NULL);
         if(SQLITE_OK == status)
         {
             if(ui->checkHeader->isChecked())
@@ -196,36 +375,33 @@ bool ExportDataDialog::exportQueryJson(const QString& sQuery, const QString& sFi
     QFile file(sFilename);
     if(file.open(QIODevice::WriteOnly))
     {
+        ConnectionPool::Handle connection = pdb.readConnection();
         QByteArray utf8Query = sQuery.toUtf8();
         sqlite3_stmt *stmt;
-        int status = sqlite3_prepare_v2(pdb._db, utf8Query.data(), utf8Query.size(), &stmt, NULL);
-
-        QJsonArray json_table;
-
+        int status = sqlite3_prepare_v2(connection, utf8Query.data(), utf8Query.size(), &stmt, NULL);
+
+        // The rows are written to the file one after the other while they are being read, so the size of the export isn't limited by
+        // the available memory
+        JsonWriter::Format format = JsonWriter::Compact;
+        if(ui->checkNewLineDelimited->isChecked())
+            format = JsonWriter::NewLineDelimited;
+        else if(ui->checkPrettyPrint->isChecked())
+            format = JsonWriter::Pretty;
+        JsonWriter writer(file, format);
+
+        QApplication::setOverrideCursor(Qt::WaitCursor);
         if(SQLITE_OK == status)
         {
-            QApplication::setOverrideCursor(Qt::WaitCursor);
             int columns = sqlite3_column_count(stmt);
+            QStringList column_names;
+            for(int i=0;i<columns;++i)
+                column_names.push_back(QString::fromUtf8(sqlite3_column_name(stmt, i)));
+            writer.setColumns(column_names);
+
             size_t counter = 0;
-            QList<QString> column_names;
-            while(sqlite3_step(stmt) == SQLITE_ROW)
+            while(!writer.failed() && sqlite3_step(stmt) == SQLITE_ROW)
             {
-                // Get column names if we didn't do so before
-                if(!column_names.size())
-                {
-                    for(int i=0;i<columns;++i)
-                        column_names.push_back(QString::fromUtf8(sqlite3_column_name(stmt, i)));
-                }
-
-                QJsonObject json_row;
-                for(int i=0;i<columns;++i)
-                {
-                    QString content = QString::fromUtf8(
-                                (const char*)sqlite3_column_blob(stmt, i),
-                                sqlite3_column_bytes(stmt, i));
-                    json_row.insert(column_names[i], content);
-                }
-                json_table.push_back(json_row);
+                writer.writeRow(stmt);
 
                 if(counter % 1000 == 0)
                     qApp->processEvents();
@@ -234,17 +410,20 @@ bool ExportDataDialog::exportQueryJson(const QString& sQuery, const QString& sFi
         }
 
         sqlite3_finalize(stmt);
-
-        // Create JSON document
-        QJsonDocument json_doc;
-        json_doc.setArray(json_table);
-        file.write(json_doc.toJson(ui->checkPrettyPrint->isChecked() ? QJsonDocument::Indented : QJsonDocument::Compact));
+        writer.finish();
 
         QApplication::restoreOverrideCursor();
         qApp->processEvents();
 
         // Done writing the file
         file.close();
+
+        if(writer.failed())
+        {
+            QMessageBox::warning(this, QApplication::applicationName(),
+                                 tr("Could not write output file: %1").arg(file.errorString()));
+            return false;
+        }
     } else {
         QMessageBox::warning(this, QApplication::applicationName(),
                              tr("Could not open output file: %1").arg(sFilename));
@@ -265,7 +444,7 @@ void ExportDataDialog::accept()
         default_file_extension = ".csv";
         break;
     case ExportFormatJson:
-        file_dialog_filter = tr("Text files(*.json *.js *.txt)");
+        file_dialog_filter = tr("Text files(*.json *.js *.ndjson *.txt)");
         default_file_extension = ".json";
         break;
     }
@@ -341,6 +520,7 @@ void ExportDataDialog::accept()
     // Save the dialog preferences for future use
     Settings::setValue("exportcsv", "firstrowheader", ui->checkHeader->isChecked());
     Settings::setValue("exportjson", "prettyprint", ui->checkPrettyPrint->isChecked());
+    Settings::setValue("exportjson", "newlinedelimited", ui->checkNewLineDelimited->isChecked());
     Settings::setValue("exportcsv", "separator", currentSeparatorChar());
     Settings::setValue("exportcsv", "quotecharacter", currentQuoteChar());
     Settings::setValue("exportcsv", "newlinecharacters", currentNewLineString());
@@ -63,7 +63,8 @@ QList<QStringList> parseClipboard(const QString& clipboard)
 }
 
 ExtendedTableWidget::ExtendedTableWidget(QWidget* parent) :
-    QTableView(parent)
+    QTableView(parent),
+    m_lastScrollPosition(0)
 {
     setHorizontalScrollMode(ExtendedTableWidget::ScrollPerPixel);
     // Force ScrollPerItem, so scrolling shows all table rows
@@ -251,22 +252,21 @@ void ExtendedTableWidget::paste()
         int lastRow = qMin(firstRow + rows - 1, m->rowCount() - 1);
         int lastColumn = qMin(firstColumn + columns - 1, m->columnCount() - 1);
 
-        int row = firstRow;
-
+        // Change all cells in one go
+        QList<QVariantList> values;
         foreach(const QByteArrayList& lst, m_buffer) {
-            int column = firstColumn;
+            QVariantList rowValues;
             foreach(const QByteArray& ba, lst) {
-                m->setData(m->index(row, column), ba);
-
-                column++;
-                if (column > lastColumn)
+                rowValues.push_back(ba);
+                if (firstColumn + rowValues.size() > lastColumn)
                     break;
             }
 
-            row++;
-            if (row > lastRow)
+            values.push_back(rowValues);
+            if (firstRow + values.size() > lastRow)
                 break;
         }
+        m->setDataBlock(m->index(firstRow, firstColumn), values);
 
         return;
     }
@@ -308,37 +308,38 @@ void ExtendedTableWidget::paste()
     int lastRow = qMin(firstRow + clipboardRows - 1, m->rowCount() - 1);
     int lastColumn = qMin(firstColumn + clipboardColumns - 1, m->columnCount() - 1);
 
-    int row = firstRow;
+    // Collect the values and change all cells in one go
+    QList<QVariantList> values;
     foreach(const QStringList& clipboardRow, clipboardTable)
     {
-        int column = firstColumn;
+        QVariantList rowValues;
         foreach(const QString& cell, clipboardRow)
         {
             if (cell.isEmpty())
-                m->setData(m->index(row, column), QVariant());
+                rowValues.push_back(QVariant());
             else
             {
                 QString text = cell;
                 if (QRegExp("\".*\"").exactMatch(text))
                     text = text.mid(1, cell.length() - 2);
                 text.replace("\"\"", "\"");
-                m->setData(m->index(row, column), text);
+                rowValues.push_back(text);
             }
 
-            column++;
-            if(column> lastColumn)
+            if(firstColumn + rowValues.size() > lastColumn)
             {
                 break;
             }
         }
 
-        row++;
-        if(row > lastRow)
+        values.push_back(rowValues);
+        if(firstRow + values.size() > lastRow)
         {
             break;
         }
     }
 
+    m->setDataBlock(m->index(firstRow, firstColumn), values);
 }
 
 void ExtendedTableWidget::keyPressEvent(QKeyEvent* event)
@@ -401,6 +402,15 @@ void ExtendedTableWidget::vscrollbarChanged(int value)
     if(!model())
         return;
 
+    // When the rows are fetched in the background, request the visible chunks and the chunk after them in the scroll direction
+    SqliteTableModel* m = qobject_cast<SqliteTableModel*>(model());
+    if(m && m->asyncFetching())
+    {
+        m->triggerCacheLoad(value, value + numVisibleRows(), value >= m_lastScrollPosition);
+        m_lastScrollPosition = value;
+        return;
+    }
+
     // Fetch more data from the DB if necessary
     if((value + numVisibleRows()) >= model()->rowCount() && model()->canFetchMore(QModelIndex()))
         model()->fetchMore(QModelIndex());
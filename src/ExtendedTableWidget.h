@@ -50,6 +50,7 @@ protected:
 
     FilterTableHeader* m_tableHeader;
     QMenu* m_contextMenu;
+    int m_lastScrollPosition;
 };
 
 #endif
@@ -30,7 +30,20 @@ void FilterLineEdit::delayedSignalTimerTriggered()
     // Stop the timer first to avoid triggering in intervals
     delaySignalTimer->stop();
 
+    // Don't emit the signal again if the value hasn't changed since the last time. This happens e.g. when the timer has already
+    // triggered and then the line edit loses focus, and it would run the same filter query again.
+    if(text() == lastValue)
+        return;
+
     // Emit the delayed signal using the current value
+    lastValue = text();
+    emit delayedTextChanged(text());
+}
+
+void FilterLineEdit::emitImmediately()
+{
+    delaySignalTimer->stop();
+    lastValue = text();
     emit delayedTextChanged(text());
 }
 
@@ -57,7 +70,7 @@ void FilterLineEdit::clear()
     // When programatically clearing the line edit's value make sure the effects are applied immediately, i.e.
     // bypass the delayed signal timer
     QLineEdit::clear();
-    delayedSignalTimerTriggered();
+    emitImmediately();
 }
 
 void FilterLineEdit::setText(const QString& text)
@@ -65,5 +78,5 @@ void FilterLineEdit::setText(const QString& text)
     // When programatically setting the line edit's value make sure the effects are applied immediately, i.e.
     // bypass the delayed signal timer
     QLineEdit::setText(text);
-    delayedSignalTimerTriggered();
+    emitImmediately();
 }
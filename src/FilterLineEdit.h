@@ -21,6 +21,9 @@ public:
 private slots:
     void delayedSignalTimerTriggered();
 
+private:
+    void emitImmediately();
+
 signals:
     void delayedTextChanged(QString text);
 
@@ -31,6 +34,7 @@ private:
     QList<FilterLineEdit*>* filterList;
     int columnNumber;
     QTimer* delaySignalTimer;
+    QString lastValue;          // The value which has been emitted the last time
 };
 
 #endif
@@ -15,16 +15,14 @@
 #include <QTextStream>
 #include <QSettings>
 #include <QFileInfo>
+#include <QElapsedTimer>
+#include <algorithm>
 #include <memory>
 
 // Enable this line to show basic performance stats after each imported CSV file. Please keep in mind that while these
 // numbers might help to estimate the performance of the algorithm, this is not a proper benchmark.
 //#define CSV_BENCHMARK
 
-#ifdef CSV_BENCHMARK
-#include <QElapsedTimer>
-#endif
-
 ImportCsvDialog::ImportCsvDialog(const QStringList &filenames, DBBrowserDB* db, QWidget* parent)
     : QDialog(parent),
       ui(new Ui::ImportCsvDialog),
@@ -54,6 +52,8 @@ ImportCsvDialog::ImportCsvDialog(const QStringList &filenames, DBBrowserDB* db,
     setSeparatorChar(QChar(settings.value("importcsv/separator", ',').toInt()));
     setQuoteChar(QChar(settings.value("importcsv/quotecharacter", '"').toInt()));
     setEncoding(settings.value("importcsv/encoding", "UTF-8").toString());
+    ui->checkBoxBulkLoad->setChecked(settings.value("importcsv/bulkload", false).toBool());
+    ui->spinBatchSize->setValue(settings.value("importcsv/batchsize", 100000).toInt());
 
     // Prepare and show interface depending on how many files are selected
     if (csvFilenames.length() > 1)
@@ -99,6 +99,47 @@ void rollback(
     }
     pdb->revertToSavepoint(savepointName);
 }
+
+// Returns how to bind the values for a column of an existing table. This follows the rules SQLite uses for determining the affinity of a
+// column. Values for columns with NUMERIC or no affinity are bound as text, so SQLite handles them exactly as before.
+CSVParser::FieldType columnBindType(const sqlb::FieldPtr& field)
+{
+    QString type = field->type().toUpper();
+    if(type.contains("INT"))
+        return CSVParser::FieldTypeInteger;
+    else if(type.contains("CHAR") || type.contains("CLOB") || type.contains("TEXT") || type.contains("BLOB") || type.isEmpty())
+        return CSVParser::FieldTypeText;
+    else if(type.contains("REAL") || type.contains("FLOA") || type.contains("DOUB"))
+        return CSVParser::FieldTypeReal;
+    else
+        return CSVParser::FieldTypeText;
+}
+
+// Relaxes the settings of the database for importing large amounts of data as fast as possible while this object exists
+class BulkLoadSettings
+{
+public:
+    explicit BulkLoadSettings(DBBrowserDB* db)
+        : m_db(db),
+          m_synchronous(db->getPragma("synchronous")),
+          m_cacheSize(db->getPragma("cache_size"))
+    {
+        // Don't wait for the data to be written to disk after each batch and use a 256 MB page cache
+        m_db->setPragma("synchronous", "0");
+        m_db->setPragma("cache_size", "-262144");
+    }
+
+    ~BulkLoadSettings()
+    {
+        m_db->setPragma("synchronous", m_synchronous);
+        m_db->setPragma("cache_size", m_cacheSize);
+    }
+
+private:
+    DBBrowserDB* m_db;
+    QString m_synchronous;
+    QString m_cacheSize;
+};
 }
 
 class CSVImportProgress : public CSVProgress
@@ -152,8 +193,20 @@ void ImportCsvDialog::accept()
     settings.setValue("trimfields", ui->checkBoxTrimFields->isChecked());
     settings.setValue("separatetables", ui->checkBoxSeparateTables->isChecked());
     settings.setValue("encoding", currentEncoding());
+    settings.setValue("bulkload", ui->checkBoxBulkLoad->isChecked());
+    settings.setValue("batchsize", ui->spinBatchSize->value());
     settings.endGroup();
 
+    // Bulk loading commits the data in batches, so there must not be any uncommitted changes which would get committed along with it
+    if(ui->checkBoxBulkLoad->isChecked() && pdb->getDirty())
+    {
+        if(QMessageBox::question(this, QApplication::applicationName(),
+                                 tr("Bulk loading commits all pending changes to the database. Are you sure you want to continue?"),
+                                 QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)
+            return;
+        pdb->releaseAllSavepoints();
+    }
+
     // Get all the selected files and start the import
     if (ui->filePickerBlock->isVisible())
     {
@@ -332,10 +385,21 @@ CSVParser::ParserResult ImportCsvDialog::parseCSV(const QString &fileName, std::
     if(count == -1)
         csv.setCSVProgress(new CSVImportProgress(file.size()));
 
-    QTextStream tstream(&file);
-    tstream.setCodec(currentEncoding().toUtf8());
+    return csv.parse(rowFunction, file, QTextCodec::codecForName(currentEncoding().toUtf8()), count);
+}
+
+CSVParser::ParserResult ImportCsvDialog::parseCSVFields(const QString& fileName, CSVParser::csvFieldRowFunction rowFunction, qint64 count)
+{
+    // Same as parseCSV() but using the field views of the parser
+    QFile file(fileName);
+    file.open(QIODevice::ReadOnly);
+
+    CSVParser csv(ui->checkBoxTrimFields->isChecked(), currentSeparatorChar(), currentQuoteChar());
+
+    if(count == -1)
+        csv.setCSVProgress(new CSVImportProgress(file.size()));
 
-    return csv.parse(rowFunction, tstream, count);
+    return csv.parseFields(rowFunction, file, QTextCodec::codecForName(currentEncoding().toUtf8()), count);
 }
 
 sqlb::FieldVector ImportCsvDialog::generateFieldList(const QString& filename)
@@ -370,7 +434,8 @@ sqlb::FieldVector ImportCsvDialog::generateFieldList(const QString& filename)
             fieldList.push_back(sqlb::FieldPtr(new sqlb::Field(fieldname, "")));
         }
 
-        // TODO Here's also the place to do some sort of data type analysation of the CSV data
+        // The data types are only determined by inferFieldTypes() when actually importing the file because that needs to look at a lot
+        // more records than just the first couple of them
 
         // All good
         return true;
@@ -379,6 +444,53 @@ sqlb::FieldVector ImportCsvDialog::generateFieldList(const QString& filename)
     return fieldList;
 }
 
+bool ImportCsvDialog::inferFieldTypes(const QString& filename, sqlb::FieldVector& fields, QVector<CSVParser::FieldType>& types)
+{
+    QFile file(filename);
+    file.open(QIODevice::ReadOnly);
+
+    CSVParser csv(ui->checkBoxTrimFields->isChecked(), currentSeparatorChar(), currentQuoteChar());
+    types = csv.inferTypes(file, QTextCodec::codecForName(currentEncoding().toUtf8()), ui->checkboxHeader->isChecked());
+    types.resize(fields.size());
+
+    // The types have only been inferred from some of the records. A single value which doesn't fit, e.g. a number with leading zeros
+    // in an otherwise numeric column, would be changed by the affinity of its column. So if there are numeric columns, check all values
+    // in one more pass and widen the types of all columns with such values at once. Text columns don't change any values.
+    if(std::find_if(types.constBegin(), types.constEnd(), [](CSVParser::FieldType type) {
+                    return type == CSVParser::FieldTypeInteger || type == CSVParser::FieldTypeReal; }) != types.constEnd())
+    {
+        bool header = ui->checkboxHeader->isChecked();
+        CSVParser::ParserResult result = parseCSVFields(filename, [&types, header](size_t rowNum, const CSVParser::Field* data, size_t count) -> bool {
+            if(rowNum == 0 && header)
+                return true;
+
+            for(int i=0;i<static_cast<int>(count) && i<types.size();i++)
+            {
+                if(types.at(i) == CSVParser::FieldTypeInteger || types.at(i) == CSVParser::FieldTypeReal)
+                    types[i] = std::max(types.at(i), CSVParser::fieldType(data[i].data, data[i].size));
+            }
+            return true;
+        });
+        if(result != CSVParser::ParserResult::ParserResultSuccess)
+            return false;
+    }
+
+    // Columns without any values keep having no data type at all
+    for(int i=0;i<fields.size();i++)
+    {
+        switch(types.at(i))
+        {
+        case CSVParser::FieldTypeInteger: fields[i]->setType("INTEGER"); break;
+        case CSVParser::FieldTypeReal: fields[i]->setType("REAL"); break;
+        case CSVParser::FieldTypeText: fields[i]->setType("TEXT"); break;
+        case CSVParser::FieldTypeBlob: fields[i]->setType("BLOB"); break;
+        case CSVParser::FieldTypeEmpty: break;
+        }
+    }
+
+    return true;
+}
+
 void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
 {
 #ifdef CSV_BENCHMARK
@@ -429,6 +541,41 @@ void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
         }
     }
 
+    // In bulk load mode the data is committed in batches, so SQLite can trade durability for speed here. Also building the indices of
+    // the table once after all the data is in is a lot faster than updating them for each row. Unique indices are kept though because
+    // they are needed for rejecting duplicate rows.
+    bool bulkLoad = ui->checkBoxBulkLoad->isChecked();
+    size_t batchSize = ui->spinBatchSize->value();
+    std::unique_ptr<BulkLoadSettings> bulkLoadSettings;
+    QList<QPair<QString, QString>> deferredIndices;
+    QElapsedTimer bulkLoadTimer;
+    if(bulkLoad)
+    {
+        bulkLoadTimer.start();
+        bulkLoadSettings.reset(new BulkLoadSettings(pdb));
+
+        if(importToExistingTable)
+        {
+            foreach(const sqlb::ObjectPtr& indexObj, pdb->schemata["main"].values("index"))
+            {
+                sqlb::IndexPtr idx = indexObj.dynamicCast<sqlb::Index>();
+                if(idx && !idx->originalSql().isEmpty() && !idx->unique() && idx->table().compare(tableName, Qt::CaseInsensitive) == 0)
+                    deferredIndices.push_back(qMakePair(idx->name(), idx->originalSql()));
+            }
+        }
+    }
+
+    // Recreates the deferred indices. If the import failed before their removal has been committed, they still exist.
+    auto restoreIndices = [&]() -> bool {
+        bool ok = true;
+        foreach(const auto& index, deferredIndices)
+        {
+            if(!pdb->getObjectByName(sqlb::ObjectIdentifier("main", index.first)))
+                ok = pdb->executeSQL(index.second) && ok;
+        }
+        return ok;
+    };
+
     // Create a savepoint, so we can rollback in case of any errors during importing
     // db needs to be saved or an error will occur
     QString restorepointName = pdb->generateSavepointName("csvimport");
@@ -436,9 +583,13 @@ void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
         return rollback(this, pdb, restorepointName, 0, tr("Creating restore point failed: %1").arg(pdb->lastError()));
 
     // Create table
-    QStringList nullValues;
+    QList<QByteArray> nullValues;
+    QVector<CSVParser::FieldType> bindTypes;        // Determines for each column whether its values are bound as numbers or as text
     if(!importToExistingTable)
     {
+        if(!inferFieldTypes(fileName, fieldList, bindTypes))
+            return rollback(this, pdb, restorepointName, 0, QString());
+
         if(!pdb->createTable(sqlb::ObjectIdentifier("main", tableName), fieldList))
             return rollback(this, pdb, restorepointName, 0, tr("Creating the table failed: %1").arg(pdb->lastError()));
     } else {
@@ -452,13 +603,22 @@ void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
             foreach(const sqlb::FieldPtr& f, tbl->fields())
             {
                 if(f->isInteger() && f->notnull())              // If this is an integer column but NULL isn't allowed, insert 0
-                    nullValues << "0";
+                    nullValues << QByteArray("0");
                 else if(f->isInteger() && !f->notnull())        // If this is an integer column and NULL is allowed, insert NULL
-                    nullValues << QString();
+                    nullValues << QByteArray();
                 else                                            // Otherwise (i.e. if this isn't an integer column), insert an empty string
-                    nullValues << "";
+                    nullValues << QByteArray("");
+
+                bindTypes << columnBindType(f);
             }
         }
+
+        // Remove the indices which are built after the import
+        foreach(const auto& index, deferredIndices)
+        {
+            if(!pdb->executeSQL(QString("DROP INDEX %1.%2;").arg(sqlb::escapeIdentifier("main")).arg(sqlb::escapeIdentifier(index.first))))
+                return rollback(this, pdb, restorepointName, 0, tr("Removing the index %1 failed: %2").arg(index.first).arg(pdb->lastError()));
+        }
     }
 
     // Prepare the INSERT statement. The prepared statement can then be reused for each row to insert
@@ -472,7 +632,8 @@ void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
 
     // Parse entire file
     size_t lastRowNum = 0;
-    CSVParser::ParserResult result = parseCSV(fileName, [&](size_t rowNum, const QStringList& data) -> bool {
+    size_t insertedRows = 0;
+    CSVParser::ParserResult result = parseCSVFields(fileName, [&](size_t rowNum, const CSVParser::Field* data, size_t fields) -> bool {
         // Process the parser results row by row
 
 #ifdef CSV_BENCHMARK
@@ -486,21 +647,36 @@ void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
         if(rowNum == 0 && ui->checkboxHeader->isChecked())
             return true;
 
-        // Bind all values
+        // Bind all values. The values stay valid until this function returns and the statement is reset before that, so there is no need
+        // for SQLite to copy them.
         unsigned int bound_fields = 0;
-        for(int i=0;i<data.size();i++,bound_fields++)
+        for(int i=0;i<static_cast<int>(fields);i++,bound_fields++)
         {
             // Empty values need special treatment, but only when importing into an existing table where we could find out something about
             // its table definition
-            if(importToExistingTable && data.at(i).isEmpty() && nullValues.size() > i)
+            if(importToExistingTable && data[i].size == 0 && nullValues.size() > i)
             {
                 // This is an empty value. We'll need to look up how to handle it depending on the field to be inserted into.
-                QString val = nullValues.at(i);
+                const QByteArray& val = nullValues.at(i);
                 if(!val.isNull())       // No need to bind NULL values here as that is the default bound value in SQLite
-                    sqlite3_bind_text(stmt, i+1, val.toUtf8(), val.toUtf8().size(), SQLITE_TRANSIENT);
+                    sqlite3_bind_text(stmt, i+1, val.constData(), val.size(), SQLITE_STATIC);
             } else {
-                // This is a non-empty value. Just add it to the statement
-                sqlite3_bind_text(stmt, i+1, static_cast<const char*>(data.at(i).toUtf8()), data.at(i).toUtf8().size(), SQLITE_TRANSIENT);
+                // This is a non-empty value or a value in a new table. Bind numbers in numeric columns as numbers, so SQLite doesn't need to
+                // convert them, and empty values in new numeric columns as NULL.
+                const CSVParser::Field& value = data[i];
+                CSVParser::FieldType columnType = (i < bindTypes.size()) ? bindTypes.at(i) : CSVParser::FieldTypeText;
+                CSVParser::FieldType valueType = CSVParser::fieldType(value.data, value.size);
+                qint64 integer;
+                if(valueType == CSVParser::FieldTypeEmpty && (columnType == CSVParser::FieldTypeInteger || columnType == CSVParser::FieldTypeReal))
+                    continue;
+                else if(columnType == CSVParser::FieldTypeInteger && valueType == CSVParser::FieldTypeInteger && CSVParser::toInteger(value.data, value.size, integer))
+                    sqlite3_bind_int64(stmt, i+1, integer);
+                else if(columnType == CSVParser::FieldTypeReal && (valueType == CSVParser::FieldTypeInteger || valueType == CSVParser::FieldTypeReal))
+                    sqlite3_bind_double(stmt, i+1, QByteArray::fromRawData(value.data, value.size).toDouble());
+                else if(columnType == CSVParser::FieldTypeBlob && valueType == CSVParser::FieldTypeBlob)
+                    sqlite3_bind_blob(stmt, i+1, value.data, value.size, SQLITE_STATIC);
+                else
+                    sqlite3_bind_text(stmt, i+1, value.data, value.size, SQLITE_STATIC);
             }
         }
 
@@ -513,6 +689,14 @@ void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
         sqlite3_reset(stmt);
         sqlite3_clear_bindings(stmt);
 
+        // In bulk load mode commit the rows in batches
+        insertedRows++;
+        if(bulkLoad && insertedRows % batchSize == 0)
+        {
+            if(!pdb->releaseSavepoint(restorepointName) || !pdb->setSavepoint(restorepointName))
+                return false;
+        }
+
 #ifdef CSV_BENCHMARK
         timesRowFunction += timer.elapsed() - timeAtStartOfRowFunction;
 #endif
@@ -527,15 +711,44 @@ void ImportCsvDialog::importCsv(const QString& fileName, const QString &name)
 
         // Rollback the entire import. If the action was cancelled, don't show an error message. If it errored, show an error message.
         sqlite3_finalize(stmt);
-        if(result == CSVParser::ParserResult::ParserResultCancelled)
+        if(bulkLoad)
+        {
+            // In bulk load mode only the current batch can be rolled back. The indices are restored and the batches which have already
+            // been committed are kept.
+            QString message;
+            if(result != CSVParser::ParserResult::ParserResultCancelled)
+                message = tr("Inserting row failed: %1").arg(pdb->lastError());
+            if(insertedRows >= batchSize)
+                message += (message.isEmpty() ? QString() : QString("\n")) + tr("The first %1 rows have already been committed.").arg(insertedRows - insertedRows % batchSize);
+            rollback(this, pdb, restorepointName, result == CSVParser::ParserResult::ParserResultCancelled ? 0 : lastRowNum, message);
+            restoreIndices();
+            pdb->releaseSavepoint();
+            return;
+        } else if(result == CSVParser::ParserResult::ParserResultCancelled) {
             return rollback(this, pdb, restorepointName, 0, QString());
-        else
+        } else {
             return rollback(this, pdb, restorepointName, lastRowNum, tr("Inserting row failed: %1").arg(pdb->lastError()));
+        }
     }
 
     // Clean up prepared statement
     sqlite3_finalize(stmt);
 
+    if(bulkLoad)
+    {
+        // Build the indices and commit the last batch
+        if(!restoreIndices())
+            QMessageBox::warning(this, QApplication::applicationName(), tr("Creating the indices of the table failed: %1").arg(pdb->lastError()));
+        pdb->releaseSavepoint(restorepointName);
+
+        double seconds = qMax<qint64>(bulkLoadTimer.elapsed(), 1) / 1000.0;
+        QMessageBox::information(this, QApplication::applicationName(),
+                                 tr("Imported %1 rows in %2 seconds (%3 rows per second).")
+                                 .arg(insertedRows)
+                                 .arg(seconds, 0, 'f', 1)
+                                 .arg(static_cast<qint64>(insertedRows / seconds)));
+    }
+
 #ifdef CSV_BENCHMARK
     QMessageBox::information(this, qApp->applicationName(),
                              tr("Importing the file '%1' took %2ms. Of this %3ms were spent in the row function.")
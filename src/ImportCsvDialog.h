@@ -40,7 +40,9 @@ private:
     QCompleter* encodingCompleter;
 
     CSVParser::ParserResult parseCSV(const QString& fileName, std::function<bool(size_t, QStringList)> rowFunction, qint64 count = -1);
+    CSVParser::ParserResult parseCSVFields(const QString& fileName, CSVParser::csvFieldRowFunction rowFunction, qint64 count = -1);
     sqlb::FieldVector generateFieldList(const QString& filename);
+    bool inferFieldTypes(const QString& filename, sqlb::FieldVector& fields, QVector<CSVParser::FieldType>& types);
 
     void importCsv(const QString& f, const QString &n = QString());
 
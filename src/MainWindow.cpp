@@ -22,6 +22,8 @@
 #include "ColumnDisplayFormatDialog.h"
 #include "FilterTableHeader.h"
 #include "RemoteDock.h"
+#include "ProfilerDock.h"
+#include "QueryPlanDialog.h"
 #include "RemoteDatabase.h"
 
 #include <QFile>
@@ -34,7 +36,7 @@
 #include <QDragEnterEvent>
 #include <QScrollBar>
 #include <QSortFilterProxyModel>
-#include <QElapsedTimer>
+#include <QStyle>
 #include <QSettings>
 #include <QMimeData>
 #include <QColorDialog>
@@ -57,9 +59,14 @@ MainWindow::MainWindow(QWidget* parent)
       editDock(new EditDialog(this)),
       plotDock(new PlotDock(this)),
       remoteDock(new RemoteDock(this)),
-      gotoValidator(new QIntValidator(0, 0, this))
+      gotoValidator(new QIntValidator(0, 0, this)),
+      m_mainConnectionBusy(false),
+      m_browseReloadPending(false),
+      m_browseEditable(false),
+      m_browseInsertDelete(false)
 {
     ui->setupUi(this);
+    m_browseTableModel->setAsyncFetching(true);
     init();
 
     activateFields(false);
@@ -79,6 +86,7 @@ void MainWindow::init()
     tabifyDockWidget(ui->dockLog, ui->dockPlot);
     tabifyDockWidget(ui->dockLog, ui->dockSchema);
     tabifyDockWidget(ui->dockLog, ui->dockRemote);
+    tabifyDockWidget(ui->dockLog, ui->dockProfiler);
 
     // Connect SQL logging and database state setting to main window
     connect(&db, SIGNAL(dbChanged(bool)), this, SLOT(dbState(bool)));
@@ -90,7 +98,11 @@ void MainWindow::init()
 
     // Set up filters
     connect(ui->dataTable->filterHeader(), SIGNAL(filterChanged(int,QString)), this, SLOT(updateFilter(int,QString)));
-    connect(m_browseTableModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(dataTableSelectionChanged(QModelIndex)));
+    connect(m_browseTableModel, &SqliteTableModel::dataChanged, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+        // Only follow edited cells, not whole chunks of rows which have just been fetched in the background
+        if(topLeft == bottomRight)
+            dataTableSelectionChanged(topLeft);
+    });
 
     // Set up DB structure tab
     dbStructureModel = new DbStructureModel(db, this);
@@ -112,10 +124,17 @@ void MainWindow::init()
     ui->dockEdit->setWidget(editDock);
     ui->dockPlot->setWidget(plotDock);
     ui->dockRemote->setWidget(remoteDock);
+    profilerDock = new ProfilerDock(db, this);
+    ui->dockProfiler->setWidget(profilerDock);
 
     // Set up edit dock
     editDock->setReadOnly(true);
 
+    // Profiling slows down every statement a bit, so only do it while the profiler dock is open. It's closed unless the saved window
+    // state says otherwise.
+    connect(ui->dockProfiler->toggleViewAction(), &QAction::toggled, profilerDock, &ProfilerDock::setProfiling);
+    ui->dockProfiler->hide();
+
     // Restore window geometry
     restoreGeometry(Settings::getValue("MainWindow", "geometry").toByteArray());
     restoreState(Settings::getValue("MainWindow", "windowState").toByteArray());
@@ -128,6 +147,9 @@ void MainWindow::init()
     shortcuts.push_back(QKeySequence(tr("Ctrl+Return")));
     ui->actionExecuteSql->setShortcuts(shortcuts);
 
+    // There is no icon for stopping in our icon set, so use the one of the platform style
+    ui->actionSqlStop->setIcon(style()->standardIcon(QStyle::SP_BrowserStop));
+
     QShortcut* shortcutBrowseRefreshF5 = new QShortcut(QKeySequence("F5"), this);
     connect(shortcutBrowseRefreshF5, SIGNAL(activated()), this, SLOT(refresh()));
     QShortcut* shortcutBrowseRefreshCtrlR = new QShortcut(QKeySequence("Ctrl+R"), this);
@@ -207,6 +229,10 @@ void MainWindow::init()
     ui->viewMenu->insertAction(ui->viewDBToolbarAction, ui->dockRemote->toggleViewAction());
     ui->viewMenu->actions().at(4)->setIcon(QIcon(":/icons/log_dock"));
 
+    // Add menu item for profiler dock
+    ui->viewMenu->insertAction(ui->viewDBToolbarAction, ui->dockProfiler->toggleViewAction());
+    ui->viewMenu->actions().at(5)->setIcon(QIcon(":/icons/log_dock"));
+
     // If we're not compiling in SQLCipher, hide its FAQ link in the help menu
 #ifndef ENABLE_SQLCIPHER
     ui->actionSqlCipherFaq->setVisible(false);
@@ -236,6 +262,7 @@ void MainWindow::init()
     // Connect some more signals and slots
     connect(ui->dataTable->filterHeader(), SIGNAL(sectionClicked(int)), this, SLOT(browseTableHeaderClicked(int)));
     connect(ui->dataTable->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(setRecordsetLabel()));
+    connect(m_browseTableModel, SIGNAL(rowCountChanged()), this, SLOT(setRecordsetLabel()));
     connect(ui->dataTable->horizontalHeader(), SIGNAL(sectionResized(int,int,int)), this, SLOT(updateBrowseDataColumnWidth(int,int,int)));
     connect(editDock, SIGNAL(recordTextUpdated(QPersistentModelIndex, QByteArray, bool)), this, SLOT(updateRecordText(QPersistentModelIndex, QByteArray, bool)));
     connect(ui->dbTreeWidget->selectionModel(), SIGNAL(currentChanged(QModelIndex,QModelIndex)), this, SLOT(changeTreeSelection()));
@@ -291,9 +318,10 @@ void MainWindow::init()
     ui->dockPlot->setWindowTitle(ui->dockPlot->windowTitle().remove('&'));
     ui->dockSchema->setWindowTitle(ui->dockSchema->windowTitle().remove('&'));
     ui->dockRemote->setWindowTitle(ui->dockRemote->windowTitle().remove('&'));
+    ui->dockProfiler->setWindowTitle(ui->dockProfiler->windowTitle().remove('&'));
 }
 
-bool MainWindow::fileOpen(const QString& fileName, bool dontAddToRecentFiles, bool readOnly)
+bool MainWindow::fileOpen(const QString& fileName, bool dontAddToRecentFiles, bool readOnly, bool inMemory)
 {
     bool retval = false;
 
@@ -321,8 +349,11 @@ bool MainWindow::fileOpen(const QString& fileName, bool dontAddToRecentFiles, bo
             retval = true;
         } else {
             // No project file; so it should be a database file
-            if(db.open(wFile, readOnly))
+            if(db.open(wFile, readOnly, inMemory))
             {
+                if(inMemory && !db.inMemory())
+                    QMessageBox::information(this, qApp->applicationName(), tr("Encrypted databases can't be loaded into memory. The database file has been opened directly instead."));
+
                 // Close all open but empty SQL tabs
                 for(int i=ui->tabSqlAreas->count()-1;i>=0;i--)
                 {
@@ -440,6 +471,13 @@ void MainWindow::populateTable()
     if(ui->mainTab->currentIndex() != BrowseTab)
         return;
 
+    // Reading the table would have to wait for the statements of an SQL tab, so put it off until they are done
+    if(m_mainConnectionBusy)
+    {
+        m_browseReloadPending = true;
+        return;
+    }
+
     // Remove the model-view link if the table name is empty in order to remove any data from the view
     if(ui->comboBrowseTable->model()->rowCount(ui->comboBrowseTable->rootModelIndex()) == 0)
     {
@@ -565,6 +603,10 @@ void MainWindow::populateTable()
 
 bool MainWindow::fileClose()
 {
+    // Stop all statements which are still being executed. Otherwise closing would have to wait for them.
+    for(int i=0;i<ui->tabSqlAreas->count();i++)
+        qobject_cast<SqlExecutionArea*>(ui->tabSqlAreas->widget(i))->abortExecution();
+
     // Close the database but stop the closing process here if the user pressed the cancel button in there
     if(!db.close())
         return false;
@@ -658,12 +700,8 @@ void MainWindow::selectTableLine(int lineToSelect)
     if(lineToSelect >= m_browseTableModel->totalRowCount())
         return;
 
+    // Select it. The model only fetches the chunk this line is in, so there is no need to load all the lines before it.
     QApplication::setOverrideCursor( Qt::WaitCursor );
-    // Make sure this line has already been fetched
-    while(lineToSelect >= m_browseTableModel->rowCount() && m_browseTableModel->canFetchMore())
-          m_browseTableModel->fetchMore();
-
-    // Select it
     ui->dataTable->clearSelection();
     ui->dataTable->selectRow(lineToSelect);
     ui->dataTable->scrollTo(ui->dataTable->currentIndex(), QAbstractItemView::PositionAtTop);
@@ -696,6 +734,8 @@ void MainWindow::navigateBegin()
 
 void MainWindow::navigateEnd()
 {
+    // Jumping to the last row requires the exact number of rows
+    m_browseTableModel->waitForRowCount();
     selectTableLine(m_browseTableModel->totalRowCount()-1);
 }
 
@@ -724,8 +764,11 @@ void MainWindow::setRecordsetLabel()
     // Update the validator of the goto row field
     gotoValidator->setRange(0, total);
 
-    // Update the label showing the current position
-    ui->labelRecordset->setText(tr("%1 - %2 of %3").arg(from).arg(to).arg(total));
+    // Update the label showing the current position. While the rows are still being counted, mark the total as an estimate.
+    if(m_browseTableModel->rowCountAvailable())
+        ui->labelRecordset->setText(tr("%1 - %2 of %3").arg(from).arg(to).arg(total));
+    else
+        ui->labelRecordset->setText(tr("%1 - %2 of about %3").arg(from).arg(to).arg(total));
 }
 
 void MainWindow::refresh()
@@ -870,7 +913,7 @@ void MainWindow::doubleClickTable(const QModelIndex& index)
     }
 
     // * Don't allow editing of other objects than tables (on the browse table) *
-    bool isEditingAllowed = !db.readOnly() && m_currentTabTableModel == m_browseTableModel &&
+    bool isEditingAllowed = !db.readOnly() && !m_mainConnectionBusy && m_currentTabTableModel == m_browseTableModel &&
             (db.getObjectByName(currentlyBrowsedTableName())->type() == sqlb::Object::Types::Table);
 
     // Enable or disable the Apply, Null, & Import buttons in the Edit Cell
@@ -894,7 +937,7 @@ void MainWindow::dataTableSelectionChanged(const QModelIndex& index)
         return;
     }
 
-    bool editingAllowed = !db.readOnly() && (m_currentTabTableModel == m_browseTableModel) &&
+    bool editingAllowed = !db.readOnly() && !m_mainConnectionBusy && (m_currentTabTableModel == m_browseTableModel) &&
             (db.getObjectByName(currentlyBrowsedTableName())->type() == sqlb::Object::Types::Table);
 
     // Don't allow editing of other objects than tables
@@ -923,6 +966,14 @@ void MainWindow::executeQuery()
 
     SqlExecutionArea* sqlWidget = qobject_cast<SqlExecutionArea*>(ui->tabSqlAreas->currentWidget());
 
+    // Each tab can only execute one query at a time
+    if(sqlWidget->isExecuting())
+        return;
+
+    // The statements might change or drop the objects which are being read in the background right now, so stop reading them first.
+    // The Browse Data tab stops loading as soon as the statements need the main connection, see updateMainConnectionState().
+    sqlWidget->getModel()->stopLoading();
+
     // Get SQL code to execute. This depends on the button that's been pressed
     QString query;
     int execution_start_line = 0;
@@ -965,158 +1016,94 @@ void MainWindow::executeQuery()
 
     //log the query
     db.logSQL(query, kLogMsg_User);
-    sqlite3_stmt *vm;
-    QByteArray utf8Query = query.toUtf8();
-    const char *tail = utf8Query.data();
-    int sql3status = SQLITE_OK;
-    int tail_length = utf8Query.length();
-    QString statusMessage;
-    bool modified = false;
-    bool wasdirty = db.getDirty();
-    bool structure_updated = false;
-    bool savepoint_created = false;
-
-    // Remove any error indicators
-    sqlWidget->getEditor()->clearErrorIndicators();
-
-    // Accept multi-line queries, by looping until the tail is empty
-    QElapsedTimer timer;
-    timer.start();
-    while( tail && *tail != 0 && (sql3status == SQLITE_OK || sql3status == SQLITE_DONE))
-    {
-        // Check whether the DB structure is changed by this statement
-        QString qtail = QString(tail).trimmed();
-        if(!structure_updated && (qtail.startsWith("ALTER", Qt::CaseInsensitive) ||
-                qtail.startsWith("CREATE", Qt::CaseInsensitive) ||
-                qtail.startsWith("DROP", Qt::CaseInsensitive) ||
-                qtail.startsWith("ROLLBACK", Qt::CaseInsensitive)))
-            structure_updated = true;
-
-        // Check whether this is trying to set a pragma or to vacuum the database
-        if((qtail.startsWith("PRAGMA", Qt::CaseInsensitive) && qtail.contains('=')) || qtail.startsWith("VACUUM", Qt::CaseInsensitive))
-        {
-            // We're trying to set a pragma. If the database has been modified it needs to be committed first. We'll need to ask the
-            // user about that
-            if(db.getDirty())
-            {
-                if(QMessageBox::question(this,
-                                         QApplication::applicationName(),
-                                         tr("Setting PRAGMA values or vacuuming will commit your current transaction.\nAre you sure?"),
-                                         QMessageBox::Yes | QMessageBox::Default,
-                                         QMessageBox::No | QMessageBox::Escape) == QMessageBox::Yes)
-                {
-                    // Commit all changes
-                    db.releaseAllSavepoints();
-                } else {
-                    // Abort
-                    statusMessage = tr("Execution aborted by user");
-                    break;
-                }
-            }
-        } else {
-            // We're not trying to set a pragma or to vacuum the database. In this case make sure a savepoint has been created in order to avoid committing
-            // all changes to the database immediately. Don't set more than one savepoint.
 
-            if(!savepoint_created)
-            {
-                // there is no choice, we have to start a transaction before we create the prepared statement,
-                // otherwise every executed statement will get committed after the prepared statement gets finalized,
-                // see http://www.sqlite.org/lang_transaction.html
-                db.setSavepoint();
-                savepoint_created = true;
-            }
-        }
+    // The statements are executed in the background. The results are shown when queryExecutionFinished() is called.
+    sqlWidget->execute(query, execution_start_line, execution_start_index);
+}
 
-        // Execute next statement
-        int tail_length_before = tail_length;
-        const char* qbegin = tail;
-        sql3status = sqlite3_prepare_v2(db._db,tail, tail_length, &vm, &tail);
-        QString queryPart = QString::fromUtf8(qbegin, tail - qbegin);
-        tail_length -= (tail - qbegin);
-        int execution_end_index = execution_start_index + tail_length_before - tail_length;
+void MainWindow::stopQuery()
+{
+    SqlExecutionArea* sqlWidget = qobject_cast<SqlExecutionArea*>(ui->tabSqlAreas->currentWidget());
+    if(sqlWidget)
+        sqlWidget->stopExecution();
+}
 
-        if (sql3status == SQLITE_OK)
-        {
-            sql3status = sqlite3_step(vm);
-            sqlite3_finalize(vm);
+void MainWindow::explainQuery()
+{
+    if(!db.isOpen())
+        return;
 
-            // SQLite returns SQLITE_DONE when a valid SELECT statement was executed but returned no results. To run into the branch that updates
-            // the status message and the table view anyway manipulate the status value here. This is also done for PRAGMA statements as they (sometimes)
-            // return rows just like SELECT statements, too.
-            if((queryPart.trimmed().startsWith("SELECT", Qt::CaseInsensitive) ||
-               queryPart.trimmed().startsWith("PRAGMA", Qt::CaseInsensitive)) && sql3status == SQLITE_DONE)
-                sql3status = SQLITE_ROW;
+    SqlExecutionArea* sqlWidget = qobject_cast<SqlExecutionArea*>(ui->tabSqlAreas->currentWidget());
+    if(!sqlWidget)
+        return;
 
-            switch(sql3status)
-            {
-            case SQLITE_ROW:
-            {
-                sqlWidget->getModel()->setQuery(queryPart);
-                if(sqlWidget->getModel()->valid())
-                {
-                    // The query takes the last placeholder as it may itself contain the sequence '%' + number
-                    statusMessage = tr("%1 rows returned in %2ms from: %3").arg(
-                                sqlWidget->getModel()->totalRowCount()).arg(timer.elapsed()).arg(queryPart.trimmed());
-                    ui->actionSqlResultsSave->setEnabled(true);
-                    ui->actionSqlResultsSaveAsView->setEnabled(!db.readOnly());
-                    sql3status = SQLITE_OK;
-                }
-                else
-                {
-                    statusMessage = tr("Error executing query: %1").arg(queryPart);
-                    sql3status = SQLITE_ERROR;
-                }
-            }
-            case SQLITE_DONE:
-            case SQLITE_OK:
-            {
-                if( !queryPart.trimmed().startsWith("SELECT", Qt::CaseInsensitive) )
-                {
-                    modified = true;
+    QString query = sqlWidget->getCurrentStatement();
+    SqliteTableModel::removeCommentsFromQuery(query);
+    if(query.trimmed().isEmpty())
+        return;
 
-                    QString stmtHasChangedDatabase;
-                    if(queryPart.trimmed().startsWith("INSERT", Qt::CaseInsensitive) ||
-                            queryPart.trimmed().startsWith("UPDATE", Qt::CaseInsensitive) ||
-                            queryPart.trimmed().startsWith("DELETE", Qt::CaseInsensitive))
-                    {
-                        stmtHasChangedDatabase = tr(", %1 rows affected").arg(sqlite3_changes(db._db));
-                    }
+    QueryPlanDialog dialog(db, query, this);
+    dialog.exec();
+}
 
-                    statusMessage = tr("Query executed successfully: %1 (took %2ms%3)").arg(queryPart.trimmed()).arg(timer.elapsed()).arg(stmtHasChangedDatabase);
-                }
-                break;
-            }
-            case SQLITE_MISUSE:
-                continue;
-            default:
-                statusMessage = QString::fromUtf8((const char*)sqlite3_errmsg(db._db)) +
-                        ": " + queryPart;
-                break;
-            }
-            timer.restart();
-        } else {
-            statusMessage = QString::fromUtf8((const char*)sqlite3_errmsg(db._db)) +
-                    ": " + queryPart;
-            sqlWidget->getEditor()->setErrorIndicator(execution_start_line, execution_start_index, execution_start_line, execution_end_index);
+void MainWindow::queryExecutionFinished()
+{
+    SqlExecutionArea* sqlWidget = qobject_cast<SqlExecutionArea*>(sender());
+    if(!sqlWidget)
+        return;
+
+    if(sqlWidget == ui->tabSqlAreas->currentWidget())
+    {
+        if(sqlWidget->getModel()->valid())
+        {
+            ui->actionSqlResultsSave->setEnabled(true);
+            ui->actionSqlResultsSaveAsView->setEnabled(!db.readOnly());
         }
+        plotDock->updatePlot(sqlWidget->getModel());
+    }
 
-        execution_start_index = execution_end_index;
+    connect(sqlWidget->getTableResult(), &ExtendedTableWidget::activated, this, &MainWindow::dataTableSelectionChanged, Qt::UniqueConnection);
+    connect(sqlWidget->getTableResult(), SIGNAL(doubleClicked(QModelIndex)), this, SLOT(doubleClickTable(QModelIndex)), Qt::UniqueConnection);
 
-        // Process events to keep the UI responsive
-        qApp->processEvents();
-    }
-    sqlWidget->finishExecution(statusMessage);
-    plotDock->updatePlot(sqlWidget->getModel());
+    updateQueryActions();
+}
+
+void MainWindow::updateQueryActions()
+{
+    // The stop button refers to the current SQL tab only
+    SqlExecutionArea* sqlWidget = qobject_cast<SqlExecutionArea*>(ui->tabSqlAreas->currentWidget());
+    ui->actionSqlStop->setEnabled(sqlWidget && sqlWidget->isExecuting());
+}
+
+void MainWindow::updateMainConnectionState()
+{
+    // While an SQL tab is executing statements on the main connection, everything else using it would block the GUI until they are
+    // done. Writing could also commit or roll back the savepoint of the tab. So only allow reading until then.
+    bool busy = SqlExecutionArea::mainConnectionBusy();
+    if(busy == m_mainConnectionBusy)
+        return;
+    m_mainConnectionBusy = busy;
 
-    connect(sqlWidget->getTableResult(), &ExtendedTableWidget::activated, this, &MainWindow::dataTableSelectionChanged);
-    connect(sqlWidget->getTableResult(), SIGNAL(doubleClicked(QModelIndex)), this, SLOT(doubleClickTable(QModelIndex)));
+    m_browseTableModel->setLoadingPaused(busy);
 
-    if(!modified && !wasdirty && savepoint_created)
-        db.revertToSavepoint(); // better rollback, if the logic is not enough we can tune it.
+    bool write = db.isOpen() && !db.readOnly() && !busy;
+    ui->fileImportCSVAction->setEnabled(write);
+    ui->fileImportSQLAction->setEnabled(!busy);
+    ui->fileCompactAction->setEnabled(write);
+    ui->editCreateTableAction->setEnabled(write);
+    ui->editCreateIndexAction->setEnabled(write);
+    ui->buttonBoxPragmas->setEnabled(write);
+    dbState(db.getDirty());
+    changeTreeSelection();
+    enableEditing(m_browseEditable, m_browseInsertDelete);
+    if(busy)
+        editDock->setReadOnly(true);
 
-    // If the DB structure was changed by some command in this SQL script, update our schema representations
-    if(structure_updated)
-        db.updateSchema();
+    if(!busy && m_browseReloadPending)
+    {
+        m_browseReloadPending = false;
+        populateTable();
+    }
 }
 
 void MainWindow::mainTabSelected(int tabindex)
@@ -1221,8 +1208,8 @@ void MainWindow::exportTableToJson()
 
 void MainWindow::dbState( bool dirty )
 {
-    ui->fileSaveAction->setEnabled(dirty);
-    ui->fileRevertAction->setEnabled(dirty);
+    ui->fileSaveAction->setEnabled(dirty && !m_mainConnectionBusy);
+    ui->fileRevertAction->setEnabled(dirty && !m_mainConnectionBusy);
     ui->fileAttachAction->setEnabled(!dirty);
     //ui->actionEncryption->setEnabled(!dirty);
 }
@@ -1231,7 +1218,7 @@ void MainWindow::fileSave()
 {
     if(db.isOpen())
     {
-        if(!db.releaseAllSavepoints())
+        if(!db.saveChanges())
         {
             QMessageBox::warning(this, QApplication::applicationName(), tr("Error while saving the database file. This means that not all changes to the database were "
                                                                            "saved. You need to resolve the following error first.\n\n%1").arg(db.lastError()));
@@ -1239,6 +1226,35 @@ void MainWindow::fileSave()
     }
 }
 
+void MainWindow::fileSaveCopy()
+{
+    if(!db.isOpen())
+        return;
+
+    // Only committed data can be copied
+    if(db.getDirty())
+    {
+        if(QMessageBox::question(this, QApplication::applicationName(),
+                                 tr("Copying the database requires writing all pending changes first. Do you want to write them now?"),
+                                 QMessageBox::Yes | QMessageBox::Cancel) != QMessageBox::Yes)
+            return;
+        fileSave();
+        if(db.getDirty())
+            return;
+    }
+
+    QString fileName = FileDialog::getSaveFileName(this,
+                                                   tr("Choose a filename to save the copy under"),
+                                                   FileDialog::getSqlDatabaseFileFilter());
+    if(fileName.isEmpty())
+        return;
+
+    if(db.saveCopyAs(fileName))
+        QMessageBox::information(this, QApplication::applicationName(), tr("The database has been copied to %1.").arg(fileName));
+    else if(!db.lastError().isEmpty())
+        QMessageBox::warning(this, QApplication::applicationName(), tr("Copying the database failed: %1").arg(db.lastError()));
+}
+
 void MainWindow::fileRevert()
 {
     if (db.isOpen()){
@@ -1382,12 +1398,13 @@ void MainWindow::changeTreeSelection()
     }
 
     // Activate actions
+    bool write = !db.readOnly() && !m_mainConnectionBusy;
     if(type == "table" || type == "index")
     {
-        ui->editDeleteObjectAction->setEnabled(!db.readOnly());
-        ui->editModifyObjectAction->setEnabled(!db.readOnly());
+        ui->editDeleteObjectAction->setEnabled(write);
+        ui->editModifyObjectAction->setEnabled(write);
     } else if(type == "view" || type == "trigger") {
-        ui->editDeleteObjectAction->setEnabled(!db.readOnly());
+        ui->editDeleteObjectAction->setEnabled(write);
     }
     if(type == "table" || type == "view")
     {
@@ -1493,6 +1510,7 @@ void MainWindow::activateFields(bool enable)
 
     ui->fileCloseAction->setEnabled(enable);
     ui->fileCompactAction->setEnabled(enable && write);
+    ui->fileSaveCopyAction->setEnabled(enable);
     ui->fileExportJsonAction->setEnabled(enable);
     ui->fileExportCSVAction->setEnabled(enable);
     ui->fileExportSQLAction->setEnabled(enable);
@@ -1513,6 +1531,7 @@ void MainWindow::activateFields(bool enable)
     ui->actionExecuteSql->setEnabled(enable);
     ui->actionLoadExtension->setEnabled(enable);
     ui->actionSqlExecuteLine->setEnabled(enable);
+    ui->actionSqlExplain->setEnabled(enable);
     ui->actionSaveProject->setEnabled(enable);
     ui->actionEncryption->setEnabled(enable && write);
     ui->buttonClearFilters->setEnabled(enable);
@@ -1527,9 +1546,12 @@ void MainWindow::activateFields(bool enable)
 
 void MainWindow::enableEditing(bool enable_edit, bool enable_insertdelete)
 {
-    // Don't enable anything if this is a read only database
-    bool edit = enable_edit && !db.readOnly();
-    bool insertdelete = enable_insertdelete && !db.readOnly();
+    m_browseEditable = enable_edit;
+    m_browseInsertDelete = enable_insertdelete;
+
+    // Don't enable anything if this is a read only database or while the main connection is busy
+    bool edit = enable_edit && !db.readOnly() && !m_mainConnectionBusy;
+    bool insertdelete = enable_insertdelete && !db.readOnly() && !m_mainConnectionBusy;
 
     // Apply settings
     ui->buttonNewRecord->setEnabled(insertdelete);
@@ -1685,6 +1707,9 @@ void MainWindow::closeSqlTab(int index, bool force)
     QWidget* w = ui->tabSqlAreas->widget(index);
     ui->tabSqlAreas->removeTab(index);
     delete w;
+
+    // The tab might have been executing statements on the main connection
+    updateMainConnectionState();
 }
 
 unsigned int MainWindow::openSqlTab(bool resetCounter)
@@ -1696,6 +1721,9 @@ unsigned int MainWindow::openSqlTab(bool resetCounter)
 
     // Create new tab, add it to the tab widget and select it
     SqlExecutionArea* w = new SqlExecutionArea(db, this);
+    connect(w, &SqlExecutionArea::executionStarted, this, &MainWindow::updateQueryActions);
+    connect(w, &SqlExecutionArea::executionFinished, this, &MainWindow::queryExecutionFinished);
+    connect(w, &SqlExecutionArea::mainConnectionChanged, this, &MainWindow::updateMainConnectionState);
     int index = ui->tabSqlAreas->addTab(w, QString("SQL %1").arg(++tabNumber));
     ui->tabSqlAreas->setCurrentIndex(index);
     w->getEditor()->setFocus();
@@ -1708,6 +1736,8 @@ void MainWindow::changeSqlTab(int /*index*/)
     // Instead of figuring out if there are some execution results in the new tab and which statement was used to generate them,
     // we just disable the export buttons in the toolbar.
     ui->actionSqlResultsSave->setEnabled(false);
+
+    updateQueryActions();
 }
 
 void MainWindow::openSqlFile()
@@ -1827,6 +1857,7 @@ void MainWindow::reloadSettings()
 
     // Set prefetch sizes for lazy population of table models
     m_browseTableModel->setChunkSize(Settings::getValue("db", "prefetchsize").toInt());
+    m_browseTableModel->setCacheMemoryBudget(Settings::getValue("db", "rowcachesize").toULongLong() * 1024 * 1024);
     for(int i=0;i<ui->tabSqlAreas->count();++i)
         qobject_cast<SqlExecutionArea*>(ui->tabSqlAreas->widget(i))->reloadSettings();
 
@@ -2489,6 +2520,12 @@ void MainWindow::fileOpenReadOnly()
     fileOpen(QString(), false, true);
 }
 
+void MainWindow::fileOpenInMemory()
+{
+    // Redirect to 'standard' fileOpen(), with the in-memory flag set
+    fileOpen(QString(), false, false, true);
+}
+
 void MainWindow::unlockViewEditing(bool unlock, QString pk)
 {
     sqlb::ObjectIdentifier currentTable = currentlyBrowsedTableName();
@@ -16,6 +16,7 @@ class QPersistentModelIndex;
 class SqliteTableModel;
 class DbStructureModel;
 class RemoteDock;
+class ProfilerDock;
 class RemoteDatabase;
 
 namespace Ui {
@@ -152,12 +153,19 @@ private:
     EditDialog* editDock;
     PlotDock* plotDock;
     RemoteDock* remoteDock;
+    ProfilerDock* profilerDock;
 
     QIntValidator* gotoValidator;
 
     DBBrowserDB db;
     QString defaultBrowseTableEncoding;
 
+    // While an SQL tab is executing statements on the main connection, writing is disabled and the Browse Data tab doesn't load anything
+    bool m_mainConnectionBusy;
+    bool m_browseReloadPending;
+    bool m_browseEditable;
+    bool m_browseInsertDelete;
+
     void init();
     void clearCompleterModelsFields();
 
@@ -178,7 +186,7 @@ protected:
     void keyPressEvent(QKeyEvent* event);
 
 public slots:
-    bool fileOpen(const QString& fileName = QString(), bool dontAddToRecentFiles = false, bool readOnly = false);
+    bool fileOpen(const QString& fileName = QString(), bool dontAddToRecentFiles = false, bool readOnly = false, bool inMemory = false);
     void logSql(const QString &sql, int msgtype);
     void dbState(bool dirty);
     void refresh();
@@ -214,10 +222,16 @@ private slots:
     void dataTableSelectionChanged(const QModelIndex& index);
     void doubleClickTable(const QModelIndex& index);
     void executeQuery();
+    void stopQuery();
+    void explainQuery();
+    void queryExecutionFinished();
+    void updateQueryActions();
+    void updateMainConnectionState();
     void importTableFromCSV();
     void exportTableToCSV();
     void exportTableToJson();
     void fileSave();
+    void fileSaveCopy();
     void fileRevert();
     void exportDatabaseToSQL();
     void importDatabaseFromSQL();
@@ -258,6 +272,7 @@ private slots:
     void browseDataSetTableEncoding(bool forAllTables = false);
     void browseDataSetDefaultTableEncoding();
     void fileOpenReadOnly();
+    void fileOpenInMemory();
     void unlockViewEditing(bool unlock, QString pk = QString());
     void on_actionHideColumns_triggered();
     void on_actionShowAllColumns_triggered();
@@ -203,13 +203,14 @@ void PlotDock::updatePlot(SqliteTableModel* model, BrowseDataTableSettings* sett
                 // prepare the data vectors for qcustomplot
                 // possible improvement might be a QVector subclass that directly
                 // access the model data, to save memory, we are copying here
-                QVector<double> xdata(model->rowCount()), ydata(model->rowCount());
-                for(int i = 0; i < model->rowCount(); ++i)
+                // only the rows which have been fetched so far are plotted
+                QVector<double> xdata(model->fetchedRowCount()), ydata(model->fetchedRowCount());
+                for(int i = 0; i < model->fetchedRowCount(); ++i)
                 {
                     // convert x type axis if it's datetime
                     if(xtype == QVariant::DateTime)
                     {
-                        QString s = model->data(model->index(i, x)).toString();
+                        QString s = model->data(model->index(i, x), Qt::EditRole).toString();
                         QDateTime d = QDateTime::fromString(s, Qt::ISODate);
                         xdata[i] = d.toMSecsSinceEpoch() / 1000.0;
                     } else {
@@ -219,7 +220,7 @@ void PlotDock::updatePlot(SqliteTableModel* model, BrowseDataTableSettings* sett
                             xdata[i] = i+1;
 
                         else
-                            xdata[i] = model->data(model->index(i, x)).toDouble();
+                            xdata[i] = model->data(model->index(i, x), Qt::EditRole).toDouble();
                     }
 
                     // Get the y value for this point. If the selected column is -1, i.e. the row number, just use the current row number from the loop
@@ -500,7 +501,7 @@ QVariant::Type PlotDock::guessDataType(SqliteTableModel* model, int column)
         {
             type = QVariant::Double;
         } else {
-            QString s = model->data(model->index(i, column)).toString();
+            QString s = model->data(model->index(i, column), Qt::EditRole).toString();
             QDate d = QDate::fromString(s, Qt::ISODate);
             if(d.isValid())
                 type = QVariant::DateTime;
@@ -518,7 +519,7 @@ void PlotDock::fetchAllData()
     {
         // Show progress dialog because fetching all data might take some time
         QProgressDialog progress(tr("Fetching all data..."),
-                                 tr("Cancel"), m_currentPlotModel->rowCount(), m_currentPlotModel->totalRowCount());
+                                 tr("Cancel"), m_currentPlotModel->fetchedRowCount(), m_currentPlotModel->totalRowCount());
         progress.setWindowModality(Qt::ApplicationModal);
         progress.show();
         qApp->processEvents();
@@ -530,7 +531,7 @@ void PlotDock::fetchAllData()
             m_currentPlotModel->fetchMore();
 
             // Update the progress dialog and stop loading data when the cancel button was pressed
-            progress.setValue(m_currentPlotModel->rowCount());
+            progress.setValue(m_currentPlotModel->fetchedRowCount());
             qApp->processEvents();
             if(progress.wasCanceled())
                 break;
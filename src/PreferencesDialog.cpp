@@ -66,6 +66,7 @@ void PreferencesDialog::loadSettings()
     ui->checkHideSchemaLinebreaks->setChecked(Settings::getValue("db", "hideschemalinebreaks").toBool());
     ui->foreignKeysCheckBox->setChecked(Settings::getValue("db", "foreignkeys").toBool());
     ui->spinPrefetchSize->setValue(Settings::getValue("db", "prefetchsize").toInt());
+    ui->spinRowCacheSize->setValue(Settings::getValue("db", "rowcachesize").toInt());
     ui->editDatabaseDefaultSqlText->setText(Settings::getValue("db", "defaultsqltext").toString());
 
     ui->defaultFieldTypeComboBox->addItems(sqlb::Field::Datatypes);
@@ -178,6 +179,7 @@ void PreferencesDialog::saveSettings()
     Settings::setValue("db", "hideschemalinebreaks", ui->checkHideSchemaLinebreaks->isChecked());
     Settings::setValue("db", "foreignkeys", ui->foreignKeysCheckBox->isChecked());
     Settings::setValue("db", "prefetchsize", ui->spinPrefetchSize->value());
+    Settings::setValue("db", "rowcachesize", ui->spinRowCacheSize->value());
     Settings::setValue("db", "defaultsqltext", ui->editDatabaseDefaultSqlText->text());
 
     Settings::setValue("db", "defaultfieldtype", ui->defaultFieldTypeComboBox->currentIndex());
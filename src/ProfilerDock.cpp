@@ -0,0 +1,111 @@
+#include "ProfilerDock.h"
+#include "ui_ProfilerDock.h"
+#include "QueryProfiler.h"
+#include "sqlitedb.h"
+
+#include <QScrollBar>
+
+ProfilerDock::ProfilerDock(DBBrowserDB& db, QWidget* parent)
+    : QDialog(parent),
+      ui(new Ui::ProfilerDock),
+      db(db),
+      profiler(db.profiler()),
+      nextSequence(0)
+{
+    ui->setupUi(this);
+    ui->tableProfile->setColumnWidth(ColumnStatement, 300);
+
+    // The profiler reports new entries from whichever thread has executed the statement
+    connect(&profiler, &QueryProfiler::statementsProfiled, this, &ProfilerDock::fetchEntries, Qt::QueuedConnection);
+
+    if(!QueryProfiler::isSupported())
+    {
+        ui->labelInfo->setText(tr("Profiling requires SQLite 3.14 or newer."));
+        ui->buttonClear->setEnabled(false);
+    }
+
+    updateStatementCacheInfo();
+}
+
+ProfilerDock::~ProfilerDock()
+{
+    delete ui;
+}
+
+void ProfilerDock::setProfiling(bool enabled)
+{
+    profiler.setEnabled(enabled);
+}
+
+void ProfilerDock::fetchEntries()
+{
+    QList<QueryProfiler::Entry> entries = profiler.entries(nextSequence);
+    if(entries.isEmpty())
+        return;
+    nextSequence = entries.last().sequence + 1;
+
+    // Don't follow the new rows if the user has scrolled up to look at an older statement
+    bool atBottom = ui->tableProfile->verticalScrollBar()->value() == ui->tableProfile->verticalScrollBar()->maximum();
+
+    for(const QueryProfiler::Entry& entry : entries)
+    {
+        auto number = [](qint64 value) {
+            QTableWidgetItem* item = new QTableWidgetItem;
+            item->setData(Qt::DisplayRole, value);
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            return item;
+        };
+
+        int row = ui->tableProfile->rowCount();
+        ui->tableProfile->insertRow(row);
+
+        QTableWidgetItem* time = new QTableWidgetItem(entry.time.toString("HH:mm:ss.zzz"));
+        ui->tableProfile->setItem(row, ColumnTime, time);
+
+        // Show the statement on a single line and the original formatting in the tooltip
+        QTableWidgetItem* statement = new QTableWidgetItem(entry.sql.simplified());
+        statement->setToolTip(entry.sql);
+        ui->tableProfile->setItem(row, ColumnStatement, statement);
+
+        QTableWidgetItem* duration = new QTableWidgetItem;
+        duration->setData(Qt::DisplayRole, QString::number(entry.nanoseconds / 1000000.0, 'f', 3));
+        duration->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        ui->tableProfile->setItem(row, ColumnDuration, duration);
+
+        if(entry.vmSteps >= 0)
+            ui->tableProfile->setItem(row, ColumnVmSteps, number(entry.vmSteps));
+        ui->tableProfile->setItem(row, ColumnFullScanSteps, number(entry.fullScanSteps));
+        ui->tableProfile->setItem(row, ColumnSorts, number(entry.sorts));
+        ui->tableProfile->setItem(row, ColumnAutoIndexes, number(entry.autoIndexes));
+        ui->tableProfile->setItem(row, ColumnCacheHits, number(entry.cacheHits));
+        ui->tableProfile->setItem(row, ColumnCacheMisses, number(entry.cacheMisses));
+    }
+
+    // Keep the history as long as the one of the profiler
+    while(ui->tableProfile->rowCount() > MaxRows)
+        ui->tableProfile->removeRow(0);
+
+    if(atBottom)
+        ui->tableProfile->scrollToBottom();
+
+    updateStatementCacheInfo();
+}
+
+void ProfilerDock::clearEntries()
+{
+    profiler.clear();
+    ui->tableProfile->setRowCount(0);
+    updateStatementCacheInfo();
+}
+
+void ProfilerDock::updateStatementCacheInfo()
+{
+    // The counters of the statement cache are kept since the program was started, so they aren't reset by the Clear button
+    quint64 hits = db.statementCacheHits();
+    quint64 misses = db.statementCacheMisses();
+    quint64 total = hits + misses;
+    ui->labelStatementCache->setText(tr("Statement cache: %1 hits, %2 misses (%3%)")
+                                     .arg(hits)
+                                     .arg(misses)
+                                     .arg(total ? hits * 100 / total : 0));
+}
@@ -0,0 +1,53 @@
+#ifndef PROFILERDOCK_H
+#define PROFILERDOCK_H
+
+#include <QDialog>
+
+class DBBrowserDB;
+class QueryProfiler;
+
+namespace Ui {
+class ProfilerDock;
+}
+
+class ProfilerDock : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ProfilerDock(DBBrowserDB& db, QWidget* parent = nullptr);
+    ~ProfilerDock();
+
+    enum Columns
+    {
+        ColumnTime,
+        ColumnStatement,
+        ColumnDuration,
+        ColumnVmSteps,
+        ColumnFullScanSteps,
+        ColumnSorts,
+        ColumnAutoIndexes,
+        ColumnCacheHits,
+        ColumnCacheMisses
+    };
+
+public slots:
+    void setProfiling(bool enabled);
+
+private slots:
+    void fetchEntries();
+    void clearEntries();
+
+private:
+    void updateStatementCacheInfo();
+
+    enum { MaxRows = 1000 };
+
+    Ui::ProfilerDock* ui;
+
+    DBBrowserDB& db;
+    QueryProfiler& profiler;
+    quint64 nextSequence;       // Sequence number of the first entry which hasn't been shown yet
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "QueryPlanDialog.h"
+#include "ui_QueryPlanDialog.h"
+#include "sqlitedb.h"
+#include "EditIndexDialog.h"
+#include "sqlite.h"
+
+#include <QHash>
+#include <QRegExp>
+#include <QSet>
+#include <cstring>
+
+namespace {
+bool isFullScan(const QString& detail)
+{
+    // Full table scans look like "SCAN TABLE t" or, since SQLite 3.36, like "SCAN t". Scans of subqueries, constant rows, virtual tables
+    // and indices don't count.
+    QRegExp scan("^SCAN (TABLE )?(\\S+)");
+    if(scan.indexIn(detail) == -1)
+        return false;
+
+    QString name = scan.cap(2);
+    return name != "SUBQUERY" && name != "CONSTANT" && !name.startsWith('(') && !detail.contains(" INDEX");
+}
+
+bool isTempBTree(const QString& detail)
+{
+    return detail.startsWith("USE TEMP B-TREE");
+}
+
+QSet<QString> queryIdentifiers(const QString& query)
+{
+    // This doesn't parse the statement but only collects everything which looks like an identifier. So some columns might get a candidate
+    // index which isn't needed, but SQLite decides which of them it would use anyway.
+    QSet<QString> identifiers;
+    QRegExp token("\"((?:[^\"]|\"\")*)\"|`([^`]*)`|\\[([^\\]]*)\\]|'(?:[^']|'')*'|([^\\W\\d][\\w$]*)");
+    int pos = 0;
+    while((pos = token.indexIn(query, pos)) != -1)
+    {
+        if(!token.cap(1).isEmpty())
+            identifiers.insert(token.cap(1).replace("\"\"", "\"").toLower());
+        else if(!token.cap(2).isEmpty())
+            identifiers.insert(token.cap(2).toLower());
+        else if(!token.cap(3).isEmpty())
+            identifiers.insert(token.cap(3).toLower());
+        else if(!token.cap(4).isEmpty())
+            identifiers.insert(token.cap(4).toLower());
+
+        pos += token.matchedLength();
+    }
+    return identifiers;
+}
+
+int binaryCollation(void* /*pArg*/, int length1, const void* string1, int length2, const void* string2)
+{
+    int result = memcmp(string1, string2, qMin(length1, length2));
+    return result ? result : length1 - length2;
+}
+
+void collationNeeded(void* /*pData*/, sqlite3* db, int /*eTextRep*/, const char* name)
+{
+    // Only the query plan matters for the copy of the schema, so replace the collations of the real database by a binary one
+    sqlite3_create_collation(db, name, SQLITE_UTF8, nullptr, binaryCollation);
+}
+
+bool exec(sqlite3* db, const QString& statement)
+{
+    return sqlite3_exec(db, statement.toUtf8(), nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+}
+
+QueryPlanDialog::QueryPlanDialog(DBBrowserDB& db, const QString& sql, QWidget* parent)
+    : QDialog(parent),
+      pdb(db),
+      query(sql.trimmed()),
+      ui(new Ui::QueryPlanDialog)
+{
+    ui->setupUi(this);
+
+    // The statement might already be an EXPLAIN statement
+    query.remove(QRegExp("^EXPLAIN\\s+(QUERY\\s+PLAN\\s+)?", Qt::CaseInsensitive));
+    ui->sqlTextEdit->setText(query);
+
+    updatePlan();
+}
+
+QueryPlanDialog::~QueryPlanDialog()
+{
+    delete ui;
+}
+
+void QueryPlanDialog::updatePlan()
+{
+    ui->treePlan->clear();
+    ui->listSuggestions->clear();
+    suggestions.clear();
+
+    // Explaining a statement doesn't execute it, so this works on a read-only connection even for statements which change data
+    ConnectionPool::Handle db = pdb.readConnection();
+
+    QList<Step> steps;
+    QString error;
+    if(explain(db, query, steps, error))
+    {
+        showPlan(steps);
+        suggestIndexes(db, steps);
+    } else {
+        ui->labelSuggestions->setText(tr("The query plan can't be determined: %1").arg(error));
+    }
+
+    updateButtons();
+}
+
+bool QueryPlanDialog::explain(sqlite3* db, const QString& query, QList<Step>& steps, QString& error)
+{
+    QByteArray statement = QString("EXPLAIN QUERY PLAN %1").arg(query).toUtf8();
+    sqlite3_stmt* stmt;
+    if(sqlite3_prepare_v2(db, statement, statement.size(), &stmt, nullptr) != SQLITE_OK)
+    {
+        error = QString::fromUtf8(sqlite3_errmsg(db));
+        return false;
+    }
+
+    // Since SQLite 3.24 the first two columns are the id of each step and the id of its parent step. Before that they are the number
+    // of the SELECT the step belongs to and the position of the step in it.
+    bool tree = QString::fromUtf8(sqlite3_column_name(stmt, 0)) == "id";
+    QList<int> selects;
+    while(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        Step step;
+        step.detail = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 3));
+        if(tree)
+        {
+            step.id = sqlite3_column_int(stmt, 0);
+            step.parent = sqlite3_column_int(stmt, 1);
+        } else {
+            step.id = steps.size() + 1;
+            step.parent = 0;
+            selects.push_back(sqlite3_column_int(stmt, 0));
+        }
+        steps.push_back(step);
+    }
+    sqlite3_finalize(stmt);
+
+    // In the old format put the steps of each subquery below the step which refers to it, e.g. "EXECUTE SCALAR SUBQUERY 1" or
+    // "COMPOUND SUBQUERIES 1 AND 2"
+    for(int i=0;i<selects.size();++i)
+    {
+        if(selects.at(i) == 0)
+            continue;
+
+        QRegExp reference(QString("SUBQUER(Y|IES) (\\d+ AND )?%1\\b").arg(selects.at(i)));
+        for(int j=0;j<steps.size();++j)
+        {
+            if(selects.at(j) != selects.at(i) && reference.indexIn(steps.at(j).detail) != -1)
+            {
+                steps[i].parent = steps.at(j).id;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+void QueryPlanDialog::showPlan(const QList<Step>& steps)
+{
+    QHash<int, QTreeWidgetItem*> items;
+    for(const Step& step : steps)
+    {
+        QTreeWidgetItem* item = new QTreeWidgetItem(QStringList(step.detail));
+        if(isFullScan(step.detail))
+        {
+            item->setBackground(0, QColor(255, 200, 200));
+            item->setToolTip(0, tr("Full table scan: All rows of the table are read. An index might help."));
+        } else if(isTempBTree(step.detail)) {
+            item->setBackground(0, QColor(255, 230, 170));
+            item->setToolTip(0, tr("Temporary B-tree: The rows are sorted or grouped separately. An index in the right order might help."));
+        }
+        items.insert(step.id, item);
+    }
+
+    for(const Step& step : steps)
+    {
+        QTreeWidgetItem* parent = step.parent != step.id ? items.value(step.parent) : nullptr;
+        if(parent)
+            parent->addChild(items.value(step.id));
+        else
+            ui->treePlan->addTopLevelItem(items.value(step.id));
+    }
+    ui->treePlan->expandAll();
+}
+
+void QueryPlanDialog::suggestIndexes(sqlite3* db, const QList<Step>& steps)
+{
+    bool expensive = false;
+    for(const Step& step : steps)
+    {
+        if(isFullScan(step.detail) || isTempBTree(step.detail))
+            expensive = true;
+    }
+    if(!expensive)
+    {
+        ui->labelSuggestions->setText(tr("There are no full table scans or temporary B-trees in the query plan."));
+        return;
+    }
+
+    // Collect the columns of the main schema which are mentioned in the statement
+    QSet<QString> identifiers = queryIdentifiers(query);
+    QList<QPair<QString, QString>> columns;
+    QList<sqlb::ObjectPtr> tables = pdb.schemata.value("main").values("table");
+    for(const sqlb::ObjectPtr& object : tables)
+    {
+        sqlb::TablePtr table = object.dynamicCast<sqlb::Table>();
+        if(table->isVirtual() || !identifiers.contains(table->name().toLower()))
+            continue;
+
+        for(const sqlb::FieldPtr& field : table->fields())
+        {
+            if(identifiers.contains(field->name().toLower()))
+                columns.push_back(qMakePair(table->name(), field->name()));
+        }
+    }
+
+    // Like the .expert command of the SQLite shell, create an empty copy of the schema with a candidate index for each of these columns
+    // and see which of them SQLite would use for the statement. Only single column indices are tried here.
+    sqlite3* copy;
+    if(columns.isEmpty() || sqlite3_open(":memory:", &copy) != SQLITE_OK)
+    {
+        ui->labelSuggestions->setText(tr("No indices can be suggested for this statement."));
+        return;
+    }
+    sqlite3_collation_needed(copy, nullptr, collationNeeded);
+
+    // Objects which can't be created in the copy, e.g. because they depend on an extension, are skipped
+    sqlite3_stmt* stmt;
+    if(sqlite3_prepare_v2(db, "SELECT sql FROM main.sqlite_master WHERE sql IS NOT NULL AND type IN('table','index','view') "
+                          "AND name NOT LIKE 'sqlite!_%' ESCAPE '!' ORDER BY rowid;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        while(sqlite3_step(stmt) == SQLITE_ROW)
+            sqlite3_exec(copy, (const char*)sqlite3_column_text(stmt, 0), nullptr, nullptr, nullptr);
+        sqlite3_finalize(stmt);
+    }
+
+    // Copy the statistics of the real database, if there are any, so the costs of the existing indices are estimated in the same way
+    if(sqlite3_prepare_v2(db, "SELECT tbl, idx, stat FROM main.sqlite_stat1;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_stmt* insert;
+        if(exec(copy, "CREATE TABLE sqlite_stat1(tbl,idx,stat);") &&
+                sqlite3_prepare_v2(copy, "INSERT INTO sqlite_stat1 VALUES(?,?,?);", -1, &insert, nullptr) == SQLITE_OK)
+        {
+            while(sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                for(int i=0;i<3;i++)
+                    sqlite3_bind_value(insert, i + 1, sqlite3_column_value(stmt, i));
+                sqlite3_step(insert);
+                sqlite3_reset(insert);
+            }
+            sqlite3_finalize(insert);
+            exec(copy, "ANALYZE sqlite_master;");
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    QMap<QString, QPair<QString, QString>> candidates;
+    for(int i=0;i<columns.size();++i)
+    {
+        QString name = QString("dbb_candidate_%1").arg(i);
+        if(exec(copy, QString("CREATE INDEX %1 ON %2(%3);")
+                .arg(name)
+                .arg(sqlb::escapeIdentifier(columns.at(i).first))
+                .arg(sqlb::escapeIdentifier(columns.at(i).second))))
+            candidates.insert(name, columns.at(i));
+    }
+
+    QList<Step> candidateSteps;
+    QString error;
+    if(explain(copy, query, candidateSteps, error))
+    {
+        QRegExp usingIndex("USING (COVERING )?INDEX (\\S+)");
+        for(const Step& step : candidateSteps)
+        {
+            if(usingIndex.indexIn(step.detail) == -1)
+                continue;
+            auto it = candidates.find(usingIndex.cap(2));
+            if(it == candidates.end())
+                continue;
+
+            QString table = it->first;
+            QString column = it->second;
+            candidates.erase(it);
+
+            sqlb::IndexPtr index(new sqlb::Index(QString("%1_%2_index").arg(table).arg(column)));
+            index->setTable(table);
+            index->addColumn(sqlb::IndexedColumnPtr(new sqlb::IndexedColumn(column, false)));
+            suggestions.push_back(index);
+            ui->listSuggestions->addItem(index->sql());
+        }
+    }
+    sqlite3_close(copy);
+
+    if(suggestions.isEmpty())
+        ui->labelSuggestions->setText(tr("SQLite wouldn't use an index on any of the columns in the statement."));
+    else
+        ui->labelSuggestions->setText(tr("SQLite would use these indices. They might make the statement faster but make changing the "
+                                         "table a bit slower."));
+}
+
+void QueryPlanDialog::createIndex()
+{
+    int row = ui->listSuggestions->currentRow();
+    if(row < 0 || row >= suggestions.size() || pdb.readOnly())
+        return;
+
+    EditIndexDialog dialog(pdb, sqlb::ObjectIdentifier(), true, this);
+    dialog.setIndex(sqlb::ObjectIdentifier("main", suggestions.at(row)->table()), *suggestions.at(row));
+    if(dialog.exec())
+        updatePlan();
+}
+
+void QueryPlanDialog::updateButtons()
+{
+    ui->buttonCreateIndex->setEnabled(!pdb.readOnly() && ui->listSuggestions->currentRow() >= 0);
+}
@@ -0,0 +1,55 @@
+#ifndef QUERYPLANDIALOG_H
+#define QUERYPLANDIALOG_H
+
+#include "sqlitetypes.h"
+
+#include <QDialog>
+
+class DBBrowserDB;
+struct sqlite3;
+
+namespace Ui {
+class QueryPlanDialog;
+}
+
+/*!
+ * \brief The QueryPlanDialog class
+ *
+ * This shows the output of EXPLAIN QUERY PLAN for a statement as a tree and highlights the expensive steps, i.e. full table scans and
+ * temporary B-trees for sorting or grouping. For these it suggests indexes which SQLite would use, which can then be created using the
+ * index dialog.
+ */
+class QueryPlanDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit QueryPlanDialog(DBBrowserDB& db, const QString& query, QWidget* parent = nullptr);
+    ~QueryPlanDialog();
+
+private slots:
+    void updatePlan();
+    void createIndex();
+    void updateButtons();
+
+private:
+    struct Step
+    {
+        int id;
+        int parent;         // 0 for top level steps
+        QString detail;
+    };
+
+    //! Runs EXPLAIN QUERY PLAN for a statement. If it can't be prepared, false is returned and the error message is set.
+    static bool explain(sqlite3* db, const QString& query, QList<Step>& steps, QString& error);
+
+    void showPlan(const QList<Step>& steps);
+    void suggestIndexes(sqlite3* db, const QList<Step>& steps);
+
+    DBBrowserDB& pdb;
+    QString query;
+    QVector<sqlb::IndexPtr> suggestions;
+    Ui::QueryPlanDialog* ui;
+};
+
+#endif
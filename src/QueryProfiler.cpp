@@ -0,0 +1,166 @@
+#include "QueryProfiler.h"
+#include "sqlite.h"
+
+#include <QMutexLocker>
+
+namespace {
+int statementStatus(sqlite3_stmt* stmt, int op)
+{
+    // Reset the counter, so statements which are executed again, e.g. because they are cached, start counting from zero
+    return sqlite3_stmt_status(stmt, op, 1);
+}
+
+#ifdef SQLITE_DBSTATUS_CACHE_MISS
+int connectionStatus(sqlite3* db, int op)
+{
+    int current = 0, highwater = 0;
+    sqlite3_db_status(db, op, &current, &highwater, 0);
+    return current;
+}
+#endif
+}
+
+QueryProfiler::QueryProfiler(QObject* parent, int maxEntries)
+    : QObject(parent),
+      m_nextSequence(0),
+      m_notifyPending(false),
+      m_maxEntries(maxEntries),
+      m_enabled(0)
+{
+}
+
+QueryProfiler::~QueryProfiler()
+{
+}
+
+bool QueryProfiler::isSupported()
+{
+#ifdef SQLITE_TRACE_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void QueryProfiler::attach(sqlite3* db)
+{
+    if(!db || !isSupported())
+        return;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_cacheCounters.remove(db);
+    }
+
+#ifdef SQLITE_TRACE_PROFILE
+    sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE, &QueryProfiler::traceCallback, this);
+#endif
+}
+
+void QueryProfiler::detach(sqlite3* db)
+{
+    if(!db || !isSupported())
+        return;
+
+#ifdef SQLITE_TRACE_PROFILE
+    sqlite3_trace_v2(db, 0, NULL, NULL);
+#endif
+
+    QMutexLocker lock(&m_mutex);
+    m_cacheCounters.remove(db);
+}
+
+void QueryProfiler::setEnabled(bool enabled)
+{
+    m_enabled.store(enabled ? 1 : 0);
+}
+
+QList<QueryProfiler::Entry> QueryProfiler::entries(quint64 since)
+{
+    QMutexLocker lock(&m_mutex);
+
+    // The caller is up to date now, so announce the next new entry again
+    m_notifyPending = false;
+
+    QList<Entry> result;
+    for(const Entry& entry : m_entries)
+    {
+        if(entry.sequence >= since)
+            result.push_back(entry);
+    }
+    return result;
+}
+
+void QueryProfiler::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+}
+
+int QueryProfiler::traceCallback(unsigned int type, void* context, void* p, void* x)
+{
+#ifdef SQLITE_TRACE_PROFILE
+    // For profile events P is the statement and X points to its run time in nanoseconds
+    QueryProfiler* profiler = static_cast<QueryProfiler*>(context);
+    if(type == SQLITE_TRACE_PROFILE && profiler->isEnabled())
+        profiler->addEntry(static_cast<sqlite3_stmt*>(p), *static_cast<sqlite3_int64*>(x));
+#else
+    Q_UNUSED(type);
+    Q_UNUSED(context);
+    Q_UNUSED(p);
+    Q_UNUSED(x);
+#endif
+    return 0;
+}
+
+void QueryProfiler::addEntry(sqlite3_stmt* stmt, qint64 nanoseconds)
+{
+    // This is called while SQLite holds the mutex of the connection, so the statement and the connection can be accessed safely
+    Entry entry;
+    entry.time = QDateTime::currentDateTime();
+    entry.sql = QString::fromUtf8(sqlite3_sql(stmt)).trimmed();
+    entry.nanoseconds = nanoseconds;
+#ifdef SQLITE_STMTSTATUS_VM_STEP
+    entry.vmSteps = statementStatus(stmt, SQLITE_STMTSTATUS_VM_STEP);
+#else
+    entry.vmSteps = -1;
+#endif
+    entry.fullScanSteps = statementStatus(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP);
+    entry.sorts = statementStatus(stmt, SQLITE_STMTSTATUS_SORT);
+    entry.autoIndexes = statementStatus(stmt, SQLITE_STMTSTATUS_AUTOINDEX);
+
+    // The cache counters belong to the connection and can't be reset here because other parts of the application use them. So
+    // remember their values and take the difference.
+    sqlite3* db = sqlite3_db_handle(stmt);
+#ifdef SQLITE_DBSTATUS_CACHE_MISS
+    int hits = connectionStatus(db, SQLITE_DBSTATUS_CACHE_HIT);
+    int misses = connectionStatus(db, SQLITE_DBSTATUS_CACHE_MISS);
+#else
+    int hits = 0, misses = 0;
+#endif
+
+    bool notify;
+    {
+        QMutexLocker lock(&m_mutex);
+
+        // Counters going backwards mean that a new connection has got the address of a closed one
+        CacheCounters& counters = m_cacheCounters[db];
+        if(hits < counters.hits || misses < counters.misses)
+            counters = CacheCounters();
+        entry.cacheHits = hits - counters.hits;
+        entry.cacheMisses = misses - counters.misses;
+        counters.hits = hits;
+        counters.misses = misses;
+
+        entry.sequence = m_nextSequence++;
+        m_entries.push_back(entry);
+        while(m_entries.size() > m_maxEntries)
+            m_entries.removeFirst();
+
+        notify = !m_notifyPending;
+        m_notifyPending = true;
+    }
+
+    if(notify)
+        emit statementsProfiled();
+}
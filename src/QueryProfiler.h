@@ -0,0 +1,91 @@
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/*!
+ * \brief The QueryProfiler class
+ *
+ * This collects run time statistics for all statements executed on the connections it has been attached to. SQLite reports each
+ * statement when it has finished running, i.e. when it's reset or finalised. Its wall time is reported by SQLite itself, the other
+ * counters are read from the statement and the connection at this point.
+ *
+ * Statements can finish in any thread. New entries are announced using the statementsProfiled() signal which should be connected using
+ * a queued connection. It's only emitted once until the new entries have been fetched, so a flood of statements doesn't flood the event
+ * loop, too. Only the most recent entries are kept.
+ */
+class QueryProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry
+    {
+        quint64 sequence;       // Increases by one with each statement
+        QDateTime time;         // When the statement has finished
+        QString sql;
+        qint64 nanoseconds;     // Wall time
+        int vmSteps;            // Number of virtual machine operations, -1 if not supported by the SQLite version
+        int fullScanSteps;      // Steps in full table scans. If this is high, an index might help.
+        int sorts;              // Sort operations. An index might make them unnecessary.
+        int autoIndexes;        // Rows inserted into automatic indices. These are created because a permanent index is missing.
+        int cacheHits;          // Page cache hits and misses of the connection while the statement was running. If other statements
+        int cacheMisses;        // were running on the same connection at the same time, their pages are counted here, too.
+    };
+
+    explicit QueryProfiler(QObject* parent = nullptr, int maxEntries = 1000);
+    ~QueryProfiler();
+
+    //! Returns true if the SQLite library supports profiling
+    static bool isSupported();
+
+    //! Starts profiling the statements of a connection
+    void attach(sqlite3* db);
+
+    //! Stops profiling the statements of a connection. Call this before closing it.
+    void detach(sqlite3* db);
+
+    //! Statements are only profiled while the profiler is enabled. It's disabled by default.
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled.load() != 0; }
+
+    //! Returns all entries with a sequence number of at least the given one
+    QList<Entry> entries(quint64 since = 0);
+
+    //! Removes all entries. Sequence numbers aren't reused.
+    void clear();
+
+signals:
+    void statementsProfiled();
+
+private:
+    static int traceCallback(unsigned int type, void* context, void* p, void* x);
+    void addEntry(sqlite3_stmt* stmt, qint64 nanoseconds);
+
+    struct CacheCounters
+    {
+        CacheCounters() : hits(0), misses(0) {}
+
+        int hits;
+        int misses;
+    };
+
+    QMutex m_mutex;
+    QList<Entry> m_entries;
+    quint64 m_nextSequence;
+    QHash<sqlite3*, CacheCounters> m_cacheCounters;     // Counter values of each connection when its last statement has finished
+    bool m_notifyPending;
+    int m_maxEntries;
+    QAtomicInt m_enabled;
+};
+
+#endif
@@ -0,0 +1,432 @@
+#include "RowCache.h"
+#include "sqlite.h"
+
+#include <cstring>
+
+RowBlock::RowBlock(int columns)
+    : m_columns(columns),
+      m_rows(0)
+{
+}
+
+void RowBlock::reserve(int rows)
+{
+    for(int i=0;i<m_columns.size();i++)
+    {
+        Column& c = m_columns[i];
+        c.offsets.reserve(rows);
+        c.lengths.reserve(rows);
+        c.types.reserve(rows);
+        c.nulls.reserve((rows + 31) / 32);
+    }
+}
+
+void RowBlock::appendCell(int column, int type, const char* data, int size)
+{
+    Column& c = m_columns[column];
+    int row = c.offsets.size();
+
+    c.offsets.push_back(c.arena.size());
+    c.lengths.push_back(size);
+    c.types.push_back(type);
+    setBit(c.nulls, row, type == SQLITE_NULL);
+    if(size)
+        c.arena.append(data, size);
+
+    // The row is complete when the last column has got its value
+    if(column == m_columns.size() - 1)
+        m_rows = row + 1;
+}
+
+void RowBlock::appendRow(const RowBlock& source, int row)
+{
+    for(int i=0;i<m_columns.size();i++)
+    {
+        const Column& c = source.m_columns.at(i);
+        appendCell(i, c.types.at(row), c.arena.constData() + c.offsets.at(row), c.lengths.at(row));
+    }
+}
+
+bool RowBlock::isNull(int row, int column) const
+{
+    return testBit(m_columns.at(column).nulls, row);
+}
+
+int RowBlock::type(int row, int column) const
+{
+    return m_columns.at(column).types.at(row);
+}
+
+QByteArray RowBlock::cell(int row, int column) const
+{
+    QByteArray value = cellView(row, column);
+    if(value.isNull())
+        return value;
+    else
+        return QByteArray(value.constData(), value.size());
+}
+
+QByteArray RowBlock::cellView(int row, int column) const
+{
+    const Column& c = m_columns.at(column);
+    if(testBit(c.nulls, row))
+        return QByteArray();
+
+    // Empty strings need to be distinguishable from NULL values, so don't return a null byte array for them
+    quint32 length = c.lengths.at(row);
+    if(length == 0)
+        return QByteArray("");
+    return QByteArray::fromRawData(c.arena.constData() + c.offsets.at(row), length);
+}
+
+void RowBlock::setCell(int row, int column, const QByteArray& value, int type)
+{
+    Column& c = m_columns[column];
+    quint32 oldLength = c.lengths.at(row);
+    quint32 newLength = value.size();
+
+    // Overwrite the old value if the new one fits into its space. Otherwise append the new value to the arena and leave the old one as
+    // unused bytes which are removed by the next compaction.
+    if(newLength <= oldLength)
+    {
+        if(newLength)
+            memcpy(c.arena.data() + c.offsets.at(row), value.constData(), newLength);
+        c.unused += oldLength - newLength;
+    } else {
+        c.offsets[row] = c.arena.size();
+        c.arena.append(value);
+        c.unused += oldLength;
+    }
+
+    c.lengths[row] = newLength;
+    c.types[row] = value.isNull() ? SQLITE_NULL : type;
+    setBit(c.nulls, row, value.isNull());
+    compact(c);
+}
+
+void RowBlock::insertRow(int row, const QList<QByteArray>& data, const QVector<int>& types)
+{
+    for(int i=0;i<m_columns.size();i++)
+    {
+        Column& c = m_columns[i];
+        QByteArray value = i < data.size() ? data.at(i) : QByteArray();
+        int type = i < types.size() ? types.at(i) : SQLITE_TEXT;
+
+        c.offsets.insert(row, c.arena.size());
+        c.lengths.insert(row, value.size());
+        c.types.insert(row, value.isNull() ? SQLITE_NULL : type);
+        insertBit(c.nulls, m_rows, row, value.isNull());
+        c.arena.append(value);
+    }
+    m_rows++;
+}
+
+void RowBlock::removeRow(int row)
+{
+    for(int i=0;i<m_columns.size();i++)
+    {
+        Column& c = m_columns[i];
+        c.unused += c.lengths.at(row);
+        c.offsets.remove(row);
+        c.lengths.remove(row);
+        c.types.remove(row);
+        removeBit(c.nulls, m_rows, row);
+        compact(c);
+    }
+    m_rows--;
+}
+
+void RowBlock::compact(Column& c)
+{
+    if(c.unused <= static_cast<quint32>(c.arena.size()) / 2)
+        return;
+
+    QByteArray arena;
+    arena.reserve(c.arena.size() - c.unused);
+    for(int i=0;i<c.offsets.size();i++)
+    {
+        quint32 offset = arena.size();
+        arena.append(c.arena.constData() + c.offsets.at(i), c.lengths.at(i));
+        c.offsets[i] = offset;
+    }
+    c.arena = arena;
+    c.unused = 0;
+}
+
+void RowBlock::squeeze()
+{
+    for(int i=0;i<m_columns.size();i++)
+    {
+        Column& c = m_columns[i];
+        c.arena.squeeze();
+        c.offsets.squeeze();
+        c.lengths.squeeze();
+        c.types.squeeze();
+        c.nulls.squeeze();
+    }
+}
+
+size_t RowBlock::memoryUsage() const
+{
+    size_t bytes = sizeof(RowBlock);
+    foreach(const Column& c, m_columns)
+    {
+        bytes += sizeof(Column) + c.arena.capacity();
+        bytes += (c.offsets.capacity() + c.lengths.capacity() + c.nulls.capacity()) * sizeof(quint32);
+        bytes += c.types.capacity() * sizeof(quint8);
+    }
+    return bytes;
+}
+
+bool RowBlock::testBit(const QVector<quint32>& bits, int index)
+{
+    return bits.at(index / 32) & (1u << (index % 32));
+}
+
+void RowBlock::setBit(QVector<quint32>& bits, int index, bool value)
+{
+    if(index / 32 >= bits.size())
+        bits.resize(index / 32 + 1);
+
+    if(value)
+        bits[index / 32] |= (1u << (index % 32));
+    else
+        bits[index / 32] &= ~(1u << (index % 32));
+}
+
+void RowBlock::insertBit(QVector<quint32>& bits, int count, int index, bool value)
+{
+    // Move all bits from the insert position on one position to the back, then set the new bit
+    setBit(bits, count, false);
+    for(int i=count;i>index;i--)
+        setBit(bits, i, testBit(bits, i - 1));
+    setBit(bits, index, value);
+}
+
+void RowBlock::removeBit(QVector<quint32>& bits, int count, int index)
+{
+    for(int i=index;i<count-1;i++)
+        setBit(bits, i, testBit(bits, i + 1));
+    setBit(bits, count - 1, false);
+}
+
+RowCache::RowCache(size_t memoryBudget)
+    : m_memoryBudget(memoryBudget),
+      m_memoryUsage(0),
+      m_clock(0)
+{
+}
+
+void RowCache::setMemoryBudget(size_t bytes)
+{
+    m_memoryBudget = bytes;
+    evict(-1);
+}
+
+void RowCache::clear()
+{
+    m_pages.clear();
+    m_memoryUsage = 0;
+}
+
+RowCache::SegmentMap::iterator RowCache::findPage(int row)
+{
+    // Get the last page starting at or before the row and check if the row is inside of it
+    SegmentMap::iterator it = m_pages.upperBound(row);
+    if(it == m_pages.begin())
+        return m_pages.end();
+    --it;
+
+    if(row < it.key() + it->rows.rowCount())
+        return it;
+    else
+        return m_pages.end();
+}
+
+RowCache::SegmentMap::const_iterator RowCache::findPage(int row) const
+{
+    SegmentMap::const_iterator it = m_pages.upperBound(row);
+    if(it == m_pages.constBegin())
+        return m_pages.constEnd();
+    --it;
+
+    if(row < it.key() + it->rows.rowCount())
+        return it;
+    else
+        return m_pages.constEnd();
+}
+
+const RowCache::Page* RowCache::page(int row, int& index)
+{
+    SegmentMap::iterator it = findPage(row);
+    if(it == m_pages.end())
+        return nullptr;
+
+    it->lastUsed = ++m_clock;
+    index = row - it.key();
+    return &it->rows;
+}
+
+bool RowCache::contains(int row) const
+{
+    return findPage(row) != m_pages.constEnd();
+}
+
+bool RowCache::containsRange(int first, int count) const
+{
+    // Walk from page to page until the end of the range is reached or there is a gap
+    int row = first;
+    while(row < first + count)
+    {
+        SegmentMap::const_iterator it = findPage(row);
+        if(it == m_pages.constEnd())
+            return false;
+        row = it.key() + it->rows.rowCount();
+    }
+    return true;
+}
+
+bool RowCache::setCell(int row, int column, const QByteArray& value, int type)
+{
+    SegmentMap::iterator it = findPage(row);
+    if(it == m_pages.end())
+        return false;
+
+    if(column < 0 || column >= it->rows.columnCount())
+        return false;
+
+    it->rows.setCell(row - it.key(), column, value, type);
+    updateSize(it);
+    it->lastUsed = ++m_clock;
+
+    return true;
+}
+
+void RowCache::insertPage(int first, const Page& rows)
+{
+    if(rows.isEmpty())
+        return;
+
+    // Drop all pages overlapping the new one. We don't try to merge them because they might have been fetched at a different time
+    int end = first + rows.rowCount();
+    SegmentMap::iterator it = m_pages.begin();
+    while(it != m_pages.end() && it.key() < end)
+    {
+        if(it.key() + it->rows.rowCount() > first)
+        {
+            m_memoryUsage -= it->bytes;
+            it = m_pages.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    Segment segment;
+    segment.rows = rows;
+    segment.rows.squeeze();
+    segment.bytes = segment.rows.memoryUsage();
+    segment.lastUsed = ++m_clock;
+    m_pages.insert(first, segment);
+    m_memoryUsage += segment.bytes;
+
+    evict(first);
+}
+
+void RowCache::insertRow(int row, const Row& data, const QVector<int>& types)
+{
+    // Find the page which contains the row or ends right before it. The new row is added to this page.
+    SegmentMap::iterator it = m_pages.upperBound(row);
+    if(it != m_pages.begin())
+    {
+        --it;
+        if(row > it.key() + it->rows.rowCount())
+            it = m_pages.end();
+    } else {
+        it = m_pages.end();
+    }
+
+    if(it != m_pages.end())
+    {
+        dropPagesFrom(it.key() + 1);
+
+        it->rows.insertRow(row - it.key(), data, types);
+        updateSize(it);
+        it->lastUsed = ++m_clock;
+    } else {
+        dropPagesFrom(row);
+
+        Page page(data.size());
+        page.insertRow(0, data, types);
+        insertPage(row, page);
+    }
+}
+
+void RowCache::removeRows(int row, int count)
+{
+    SegmentMap::iterator it = findPage(row);
+    if(it == m_pages.end())
+    {
+        dropPagesFrom(row);
+        return;
+    }
+
+    dropPagesFrom(it.key() + 1);
+
+    // Remove the rows from the page containing the first of them. All the following pages have already been dropped.
+    int index = row - it.key();
+    int num = qMin(count, it->rows.rowCount() - index);
+    for(int i=0;i<num;i++)
+        it->rows.removeRow(index);
+
+    if(it->rows.isEmpty())
+        removePage(it);
+    else
+        updateSize(it);
+}
+
+void RowCache::dropPagesFrom(int row)
+{
+    SegmentMap::iterator it = m_pages.lowerBound(row);
+    while(it != m_pages.end())
+    {
+        m_memoryUsage -= it->bytes;
+        it = m_pages.erase(it);
+    }
+}
+
+void RowCache::removePage(SegmentMap::iterator it)
+{
+    m_memoryUsage -= it->bytes;
+    m_pages.erase(it);
+}
+
+void RowCache::updateSize(SegmentMap::iterator it)
+{
+    size_t bytes = it->rows.memoryUsage();
+    m_memoryUsage = m_memoryUsage - it->bytes + bytes;
+    it->bytes = bytes;
+}
+
+void RowCache::evict(int keep)
+{
+    // An unlimited cache never evicts anything
+    if(m_memoryBudget == 0)
+        return;
+
+    // Always keep at least two pages. The visible part of a table can span two pages and evicting one of them would only mean fetching it again
+    // for the next repaint.
+    while(m_memoryUsage > m_memoryBudget && m_pages.size() > 2)
+    {
+        // Find the least recently used page, but never evict the page which has just been added
+        SegmentMap::iterator oldest = m_pages.end();
+        for(SegmentMap::iterator it=m_pages.begin();it!=m_pages.end();++it)
+        {
+            if(it.key() != keep && (oldest == m_pages.end() || it->lastUsed < oldest->lastUsed))
+                oldest = it;
+        }
+
+        if(oldest == m_pages.end())
+            break;
+        removePage(oldest);
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef ROWCACHE_H
+#define ROWCACHE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QVector>
+
+/*!
+ * \brief The RowBlock class
+ *
+ * This holds the cells of a consecutive range of rows in a columnar layout. Instead of allocating a QByteArray for each cell, all
+ * values of a column are stored back to back in one byte arena. For each cell only its position in the arena, its length and its
+ * SQLite data type are stored separately. NULL values are marked in a bitmap.
+ */
+class RowBlock
+{
+public:
+    explicit RowBlock(int columns = 0);
+
+    int rowCount() const { return m_rows; }
+    int columnCount() const { return m_columns.size(); }
+    bool isEmpty() const { return m_rows == 0; }
+
+    void reserve(int rows);
+
+    /*!
+     * \brief appendCell adds a value to the end of a column. Add exactly one value to each column to complete a row.
+     * \param column Number of the column
+     * \param type SQLite data type of the value, i.e. SQLITE_INTEGER, SQLITE_TEXT, etc.
+     * \param data Pointer to the data. This is copied into the arena of the column.
+     * \param size Number of bytes
+     */
+    void appendCell(int column, int type, const char* data, int size);
+
+    //! Appends a copy of a row of another block with the same number of columns
+    void appendRow(const RowBlock& source, int row);
+
+    bool isNull(int row, int column) const;
+    int type(int row, int column) const;
+
+    /*!
+     * \brief cell returns a copy of the cell value. NULL values are returned as null byte arrays.
+     */
+    QByteArray cell(int row, int column) const;
+
+    /*!
+     * \brief cellView returns the cell value without copying it. The returned byte array points into the arena of the block, so it
+     * must not be used after the block has been modified or destroyed.
+     */
+    QByteArray cellView(int row, int column) const;
+
+    /*!
+     * \brief setCell changes the value of a cell. If the new value fits into the space of the old one, it's overwritten in place.
+     * \param type SQLite data type of the value. This is ignored for NULL values.
+     */
+    void setCell(int row, int column, const QByteArray& value, int type);
+
+    //! Inserts a row. The types are the SQLite data types of the values, missing types default to SQLITE_TEXT.
+    void insertRow(int row, const QList<QByteArray>& data, const QVector<int>& types);
+    void removeRow(int row);
+
+    //! Releases memory which has been reserved but isn't used
+    void squeeze();
+
+    size_t memoryUsage() const;
+
+private:
+    struct Column
+    {
+        Column() : unused(0) {}
+
+        QByteArray arena;           // Values of all cells, back to back
+        QVector<quint32> offsets;   // Position of each cell value in the arena
+        QVector<quint32> lengths;   // Length of each cell value
+        QVector<quint8> types;      // SQLite data type of each cell
+        QVector<quint32> nulls;     // Bitmap of the NULL cells
+        quint32 unused;             // Bytes in the arena which don't belong to any cell anymore because it has been changed or removed
+    };
+
+    // Removes the unused bytes from the arena of a column once they make up more than half of it
+    static void compact(Column& c);
+
+    static bool testBit(const QVector<quint32>& bits, int index);
+    static void setBit(QVector<quint32>& bits, int index, bool value);
+    static void insertBit(QVector<quint32>& bits, int count, int index, bool value);
+    static void removeBit(QVector<quint32>& bits, int count, int index);
+
+    QVector<Column> m_columns;
+    int m_rows;
+};
+
+/*!
+ * \brief The RowCache class
+ *
+ * This is a sparse cache for the rows of a result set. Rows are stored in pages which are keyed by the number of their first row, so
+ * any part of a result set can be cached without fetching all the rows before it. When the estimated memory usage of all pages exceeds
+ * the memory budget, the pages which haven't been accessed for the longest time are evicted.
+ */
+class RowCache
+{
+public:
+    typedef QList<QByteArray> Row;
+    typedef RowBlock Page;
+
+    /*!
+     * \brief RowCache
+     * \param memoryBudget Number of bytes the cached pages may use. 0 means the cache is unlimited.
+     */
+    explicit RowCache(size_t memoryBudget = 0);
+
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const { return m_memoryBudget; }
+    size_t memoryUsage() const { return m_memoryUsage; }
+    int pageCount() const { return m_pages.size(); }
+
+    void clear();
+
+    /*!
+     * \brief page returns the cached page containing a row and marks it as recently used
+     * \param row Number of the row to look up
+     * \param index Is set to the position of the row inside the page
+     * \return A pointer to the page or nullptr if the row isn't cached. The pointer is valid until the cache is modified.
+     */
+    const Page* page(int row, int& index);
+    bool contains(int row) const;
+
+    //! Returns true if all rows from first to first+count-1 are cached
+    bool containsRange(int first, int count) const;
+
+    /*!
+     * \brief setCell changes the value of a single cell if its row is cached
+     * \return true if the row is cached, false otherwise
+     */
+    bool setCell(int row, int column, const QByteArray& value, int type);
+
+    /*!
+     * \brief insertPage adds a page of rows to the cache. Cached pages overlapping the new one are dropped. If this exceeds the memory
+     * budget, the least recently used pages are evicted.
+     * \param first Number of the first row in the page
+     * \param rows The row data
+     */
+    void insertPage(int first, const Page& rows);
+
+    /*!
+     * \brief insertRow and removeRows change the row numbering of the data set. The page holding the modified row is updated and all
+     * pages behind it are dropped because their row numbers aren't correct anymore.
+     */
+    void insertRow(int row, const Row& data, const QVector<int>& types);
+    void removeRows(int row, int count);
+
+private:
+    struct Segment
+    {
+        Page rows;
+        size_t bytes;
+        quint64 lastUsed;
+    };
+    typedef QMap<int, Segment> SegmentMap;
+
+    SegmentMap::iterator findPage(int row);
+    SegmentMap::const_iterator findPage(int row) const;
+    void dropPagesFrom(int row);
+    void removePage(SegmentMap::iterator it);
+    void updateSize(SegmentMap::iterator it);
+    void evict(int keep);
+
+    SegmentMap m_pages;
+    size_t m_memoryBudget;
+    size_t m_memoryUsage;
+    quint64 m_clock;
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "RowLoader.h"
+#include "sqlite.h"
+
+#include <QMutexLocker>
+
+namespace {
+// Stops a statement as soon as its task is cancelled. See RowLoader::fetch() for when this is used.
+int cancelProgressHandler(void* cancel)
+{
+    return static_cast<const QAtomicInt*>(cancel)->load() != 0;
+}
+
+// Installs the progress handler on a connection which isn't a connection of the pool, e.g. the main connection. The connection stays locked
+// while the handler is installed, so it can't stop statements of other threads. Unlike sqlite3_interrupt() it only affects the statement
+// of the task.
+class CancelGuard
+{
+public:
+    CancelGuard(const ConnectionPool::Handle& db, const QAtomicInt* cancel)
+        : m_db(nullptr),
+          m_mutex(nullptr)
+    {
+        if(!cancel || db.isPooled() || !db.isValid())
+            return;
+
+        m_db = db;
+        m_mutex = sqlite3_db_mutex(m_db);
+        sqlite3_mutex_enter(m_mutex);
+        sqlite3_progress_handler(m_db, 1000, cancelProgressHandler, const_cast<QAtomicInt*>(cancel));
+    }
+
+    ~CancelGuard()
+    {
+        if(!m_db)
+            return;
+
+        sqlite3_progress_handler(m_db, 0, NULL, NULL);
+        sqlite3_mutex_leave(m_mutex);
+    }
+
+private:
+    sqlite3* m_db;
+    sqlite3_mutex* m_mutex;
+};
+}
+
+RowLoader::RowLoader(QObject* parent)
+    : QThread(parent),
+      m_busy(false),
+      m_quit(false),
+      m_cancel(0)
+{
+    qRegisterMetaType<RowLoader::Result>();
+}
+
+RowLoader::~RowLoader()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_quit = true;
+        m_tasks.clear();
+        m_cancel.store(1);
+        m_wakeUp.wakeAll();
+    }
+
+    wait();
+}
+
+bool RowLoader::isSupported()
+{
+    return sqlite3_threadsafe() != 0;
+}
+
+bool RowLoader::isPending(int generation, unsigned int from)
+{
+    QMutexLocker lock(&m_mutex);
+    return isPendingLocked(generation, from);
+}
+
+bool RowLoader::isPendingLocked(int generation, unsigned int from) const
+{
+    if(m_busy && m_current.generation == generation && m_current.from == from)
+        return true;
+    foreach(const Task& t, m_tasks)
+    {
+        if(t.generation == generation && t.from == from)
+            return true;
+    }
+    return false;
+}
+
+void RowLoader::enqueue(const Task& task)
+{
+    QMutexLocker lock(&m_mutex);
+
+    // Don't fetch the same chunk twice
+    if(isPendingLocked(task.generation, task.from))
+        return;
+
+    // When scrolling quickly lots of chunks are requested which aren't visible anymore by the time the worker gets to them. Only keep
+    // the most recent requests. The model requests the other chunks again when they are still needed.
+    m_tasks.append(task);
+    while(m_tasks.size() > MaxQueuedTasks)
+        m_tasks.removeFirst();
+
+    if(!isRunning())
+        start(QThread::LowPriority);
+    m_wakeUp.wakeOne();
+}
+
+void RowLoader::cancel()
+{
+    QMutexLocker lock(&m_mutex);
+    m_tasks.clear();
+    if(m_busy)
+        m_cancel.store(1);
+}
+
+void RowLoader::stop()
+{
+    QMutexLocker lock(&m_mutex);
+    m_tasks.clear();
+    if(m_busy)
+        m_cancel.store(1);
+    while(m_busy)
+        m_idle.wait(&m_mutex);
+}
+
+void RowLoader::interrupt()
+{
+    QMutexLocker lock(&m_mutex);
+    m_tasks.clear();
+    if(m_busy)
+    {
+        // Connections of the pool are only used by this worker right now, so nothing else is interrupted here. Statements on other
+        // connections are stopped by the progress handler which is installed while they are running.
+        m_cancel.store(1);
+        if(m_current.db.isPooled())
+            sqlite3_interrupt(m_current.db);
+    }
+    while(m_busy)
+        m_idle.wait(&m_mutex);
+}
+
+void RowLoader::run()
+{
+    forever
+    {
+        Task task;
+        {
+            QMutexLocker lock(&m_mutex);
+            while(m_tasks.isEmpty() && !m_quit)
+                m_wakeUp.wait(&m_mutex);
+            if(m_quit)
+                return;
+
+            task = m_tasks.takeLast();
+            m_current = task;
+            m_busy = true;
+            m_cancel.store(0);
+        }
+
+        // The statement might get interrupted because another worker using the same connection has been interrupted. In this case
+        // just try again.
+        Result result;
+        for(int attempt=0;attempt<MaxAttempts;attempt++)
+        {
+            result = fetch(task, &m_cancel);
+            if(result.ok || !result.interrupted || m_cancel.load())
+                break;
+        }
+
+        bool cancelled;
+        {
+            QMutexLocker lock(&m_mutex);
+            cancelled = m_cancel.load() != 0;
+            m_busy = false;
+            m_current.db = ConnectionPool::Handle();
+            m_idle.wakeAll();
+        }
+
+        // Failed results are handed back, too. Otherwise the model would keep waiting for them.
+        if(!cancelled)
+            emit fetched(result);
+    }
+}
+
+RowLoader::Result RowLoader::fetch(const Task& task, const QAtomicInt* cancel)
+{
+    Result result;
+    result.generation = task.generation;
+    result.from = task.from;
+    result.rows = RowBlock(task.columns);
+    result.rows.reserve(task.to - task.from);
+
+    CancelGuard guard(task.db, cancel);
+
+    sqlite3_stmt* stmt;
+    if(sqlite3_prepare_v2(task.db, task.query, task.query.size(), &stmt, NULL) != SQLITE_OK)
+        return result;
+
+    for(int i=0;i<task.bindings.size();i++)
+        bindValue(stmt, i + 1, task.bindings.at(i));
+
+    // Remember the data types of the sort key and the rowid column in the last row fetched. Floating point values are stored separately
+    // because their text representation might not be precise enough for seeking to them later.
+    double sortKeyDouble = 0.0, rowidDouble = 0.0;
+
+    int status;
+    while((status = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if(cancel && cancel->load())
+            break;
+
+        for(int i=0;i<task.columns;i++)
+        {
+            int type = sqlite3_column_type(stmt, i);
+            if(task.sortColumn >= 0 && type == SQLITE_FLOAT)
+            {
+                if(i == 0)
+                    rowidDouble = sqlite3_column_double(stmt, i);
+                if(i == task.sortColumn)
+                    sortKeyDouble = sqlite3_column_double(stmt, i);
+            }
+
+            // Copy the value straight into the arena of the column
+            if(type == SQLITE_NULL)
+            {
+                result.rows.appendCell(i, type, nullptr, 0);
+            } else {
+                const char* data = static_cast<const char*>(sqlite3_column_blob(stmt, i));
+                result.rows.appendCell(i, type, data, sqlite3_column_bytes(stmt, i));
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    // Only use the rows if all of them could be fetched
+    result.ok = status == SQLITE_DONE;
+    result.interrupted = status == SQLITE_INTERRUPT;
+
+    // Remember where this chunk ended so the next one can be fetched by seeking to this position
+    if(result.ok && task.sortColumn >= 0 && !result.rows.isEmpty())
+    {
+        auto makeSeekValue = [&result](int column, double d) -> SeekValue {
+            int row = result.rows.rowCount() - 1;
+            SeekValue v;
+            v.type = result.rows.type(row, column);
+            if(v.type == SQLITE_INTEGER)
+                v.value = result.rows.cell(row, column).toLongLong();
+            else if(v.type == SQLITE_FLOAT)
+                v.value = d;
+            else if(v.type != SQLITE_NULL)
+                v.value = result.rows.cell(row, column);
+            return v;
+        };
+
+        result.lastSortKey = makeSeekValue(task.sortColumn, sortKeyDouble);
+        result.lastRowid = makeSeekValue(0, rowidDouble);
+    }
+
+    return result;
+}
+
+void RowLoader::bindValue(sqlite3_stmt* stmt, int param, const SeekValue& value)
+{
+    switch(value.type)
+    {
+    case SQLITE_INTEGER:
+        sqlite3_bind_int64(stmt, param, value.value.toLongLong());
+        break;
+    case SQLITE_FLOAT:
+        sqlite3_bind_double(stmt, param, value.value.toDouble());
+        break;
+    case SQLITE_TEXT:
+    {
+        QByteArray data = value.value.toByteArray();
+        sqlite3_bind_text(stmt, param, data.constData(), data.size(), SQLITE_TRANSIENT);
+        break;
+    }
+    case SQLITE_BLOB:
+    {
+        QByteArray data = value.value.toByteArray();
+        sqlite3_bind_blob(stmt, param, data.constData(), data.size(), SQLITE_TRANSIENT);
+        break;
+    }
+    default:
+        sqlite3_bind_null(stmt, param);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef ROWLOADER_H
+#define ROWLOADER_H
+
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QMutex>
+#include <QThread>
+#include <QVariant>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "RowCache.h"
+#include "ConnectionPool.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/*!
+ * \brief The RowLoader class
+ *
+ * This is a worker thread which fetches chunks of rows for a SqliteTableModel in the background. Chunks are queued using enqueue() and
+ * the most recently requested chunk is always fetched first because that is usually the one the user is looking at. Finished chunks
+ * are handed back using the fetched() signal which should be connected using a queued connection. Chunks which couldn't be fetched are
+ * handed back, too, with their ok flag unset.
+ *
+ * The statements are executed on the connection which is passed in with the task. For this to be safe the connection must have been
+ * opened in serialized mode. Tasks keep their connection reserved until they have been executed or thrown away. Use isSupported() to check if the SQLite library has been compiled with thread safety enabled.
+ */
+class RowLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    // A typed value used for binding parameters, e.g. the position to seek to when using keyset pagination
+    struct SeekValue
+    {
+        SeekValue() : type(0) {}
+
+        int type;           // SQLite data type of the value, i.e. SQLITE_INTEGER, SQLITE_TEXT, etc.
+        QVariant value;
+    };
+
+    struct Task
+    {
+        Task() : generation(0), from(0), to(0), columns(0), sortColumn(-1) {}
+
+        ConnectionPool::Handle db;      // Either the main connection or a read-only connection of the pool
+        int generation;                 // Tasks and results of older generations are thrown away by the model
+        unsigned int from;
+        unsigned int to;
+        QByteArray query;               // The statement to execute for getting the rows of this chunk
+        QVector<SeekValue> bindings;    // Values to bind to the parameters ?1, ?2, ...
+        int columns;
+        int sortColumn;                 // If not -1 the values of the rowid and the sort column in the last row are stored in the result
+    };
+
+    struct Result
+    {
+        Result() : generation(0), from(0), ok(false), interrupted(false) {}
+
+        int generation;
+        unsigned int from;
+        bool ok;
+        bool interrupted;               // true if executing the statement has been stopped using sqlite3_interrupt()
+        RowBlock rows;
+        SeekValue lastSortKey;
+        SeekValue lastRowid;
+    };
+
+    explicit RowLoader(QObject* parent = nullptr);
+    ~RowLoader();
+
+    static bool isSupported();
+
+    /*!
+     * \brief fetch executes the statement of a task and returns the rows. This can be called from any thread.
+     * \param task The task to execute
+     * \param cancel If not null and set to a non-zero value while the statement is executed, fetching stops and an invalid result is returned.
+     * If the connection isn't a connection of the pool, it's locked while the statement is executed to make this work.
+     */
+    static Result fetch(const Task& task, const QAtomicInt* cancel = nullptr);
+
+    //! Adds a task to the queue. Tasks for chunks which are already queued or being fetched are ignored.
+    void enqueue(const Task& task);
+
+    //! Returns true if the chunk starting at the given row is queued or being fetched
+    bool isPending(int generation, unsigned int from);
+
+    //! Removes all queued tasks and stops the current one as soon as possible. This doesn't wait for the worker.
+    void cancel();
+
+    //! Like cancel() but also waits until the worker has stopped executing its current statement
+    void stop();
+
+    //! Like stop() but also interrupts the statement which is executed right now. Use this for statements which might take a long time
+    //! before returning their first row, like a COUNT query. Statements of other threads aren't affected.
+    void interrupt();
+
+signals:
+    void fetched(const RowLoader::Result& result);
+
+protected:
+    virtual void run();
+
+private:
+    static void bindValue(sqlite3_stmt* stmt, int param, const SeekValue& value);
+    bool isPendingLocked(int generation, unsigned int from) const;
+
+    QMutex m_mutex;
+    QWaitCondition m_wakeUp;
+    QWaitCondition m_idle;
+    QList<Task> m_tasks;
+    Task m_current;
+    bool m_busy;
+    bool m_quit;
+    QAtomicInt m_cancel;
+
+    static const int MaxQueuedTasks = 4;
+    static const int MaxAttempts = 3;
+};
+
+Q_DECLARE_METATYPE(RowLoader::Result)
+
+#endif
@@ -0,0 +1,57 @@
+#include "SchemaParser.h"
+
+#include <QThread>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class SchemaParser::Worker : public QThread
+{
+public:
+    explicit Worker(SchemaParser* parser) : m_parser(parser) {}
+
+protected:
+    virtual void run() { m_parser->work(); }
+
+private:
+    SchemaParser* m_parser;
+};
+
+SchemaParser::SchemaParser(QVector<Statement>& statements)
+    : m_statements(statements),
+      m_next(0)
+{
+}
+
+void SchemaParser::parse(QVector<Statement>& statements, int threads)
+{
+    // Detach the vector here, so the workers only write to their own elements and never copy the whole vector
+    statements.detach();
+
+    SchemaParser parser(statements);
+    threads = std::max(1, std::min(threads, statements.size() / MinStatementsPerThread));
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for(int i=1;i<threads;i++)
+    {
+        workers.emplace_back(new Worker(&parser));
+        workers.back()->start();
+    }
+
+    // The calling thread helps with the parsing instead of just waiting
+    parser.work();
+
+    for(const auto& worker : workers)
+        worker->wait();
+}
+
+void SchemaParser::work()
+{
+    // Hand out the statements one by one. They differ a lot in length, so this distributes the work better than fixed ranges.
+    int i;
+    while((i = m_next.fetchAndAddRelaxed(1)) < m_statements.size())
+    {
+        Statement& statement = m_statements[i];
+        statement.object = sqlb::Object::parseSQL(statement.type, statement.sql);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef SCHEMAPARSER_H
+#define SCHEMAPARSER_H
+
+#include "sqlitetypes.h"
+
+#include <QAtomicInt>
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief The SchemaParser class
+ *
+ * This parses the CREATE statements of a database schema into objects. Each statement is parsed using a lexer and a parser of its own,
+ * so for large schemata the statements are distributed over a couple of worker threads. The objects are returned in the order of the
+ * statements, no matter which thread has parsed them.
+ */
+class SchemaParser
+{
+public:
+    struct Statement
+    {
+        sqlb::Object::Types type;
+        QString sql;
+        sqlb::ObjectPtr object;     // Set by parse()
+    };
+
+    /*!
+     * \brief parse parses all statements and stores the results in them
+     * \param statements The statements to parse
+     * \param threads Maximum number of threads to use, including the calling one
+     */
+    static void parse(QVector<Statement>& statements, int threads);
+
+    //! Below this number of statements everything is parsed in the calling thread because starting threads would take longer
+    enum { MinStatementsPerThread = 50 };
+
+private:
+    class Worker;
+
+    explicit SchemaParser(QVector<Statement>& statements);
+    void work();
+
+    QVector<Statement>& m_statements;
+    QAtomicInt m_next;      // Index of the next statement to parse
+};
+
+#endif
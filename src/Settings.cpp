@@ -74,6 +74,10 @@ QVariant Settings::getDefaultValue(const QString& group, const QString& name)
     if(group == "db" && name == "prefetchsize")
         return 50000;
 
+    // db/rowcachesize?
+    if(group == "db" && name == "rowcachesize")
+        return 512;
+
     // db/defaultsqltext?
     if(group == "db" && name == "defaultsqltext")
         return "";
@@ -102,6 +106,10 @@ QVariant Settings::getDefaultValue(const QString& group, const QString& name)
     if(group == "exportjson" && name == "prettyprint")
         return true;
 
+    // exportjson/newlinedelimited?
+    if(group == "exportjson" && name == "newlinedelimited")
+        return false;
+
     // MainWindow/geometry?
     if(group == "MainWindow" && name == "geometry")
         return "";
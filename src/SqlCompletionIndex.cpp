@@ -0,0 +1,364 @@
+#include "SqlCompletionIndex.h"
+#include "SqlUiLexer.h"
+
+#include <QApplication>
+#include <QSet>
+#include "Qsci/qsciscintilla.h"
+
+#include <algorithm>
+
+namespace {
+struct Token
+{
+    enum Type
+    {
+        Word,           // Identifiers, keywords and numbers
+        QuotedId,       // Quoted identifiers. The text is unquoted.
+        Symbol
+    };
+
+    Type type;
+    QString text;
+};
+
+bool isWordCharacter(QChar c)
+{
+    return c.isLetterOrNumber() || c == '_' || c == '$' || c.unicode() > 127;
+}
+
+bool isSymbol(const Token& token, char symbol)
+{
+    return token.type == Token::Symbol && token.text.at(0) == symbol;
+}
+
+// Splits the statement the cursor is in into tokens. Strings, comments and whitespace are skipped.
+QVector<Token> currentStatementTokens(const QString& text, int cursor)
+{
+    QVector<Token> tokens;
+    const int length = text.size();
+    int i = 0;
+    while(i < length)
+    {
+        const QChar c = text.at(i);
+        if(c.isSpace())
+        {
+            ++i;
+        } else if(c == '-' && i+1 < length && text.at(i+1) == '-') {
+            int end = text.indexOf('\n', i);
+            i = end < 0 ? length : end + 1;
+        } else if(c == '/' && i+1 < length && text.at(i+1) == '*') {
+            int end = text.indexOf("*/", i + 2);
+            i = end < 0 ? length : end + 2;
+        } else if(c == '\'' || c == '"' || c == '`' || c == '[') {
+            // Strings and quoted identifiers. Apart from the square brackets the quote character is escaped by doubling it.
+            const QChar close = c == '[' ? QChar(']') : c;
+            QString unquoted;
+            ++i;
+            while(i < length)
+            {
+                if(text.at(i) == close)
+                {
+                    if(close != ']' && i+1 < length && text.at(i+1) == close)
+                        ++i;
+                    else
+                        break;
+                }
+                unquoted.append(text.at(i++));
+            }
+            ++i;
+
+            if(c != '\'')
+            {
+                Token token = {Token::QuotedId, unquoted};
+                tokens.push_back(token);
+            }
+        } else if(isWordCharacter(c)) {
+            int start = i;
+            while(i < length && isWordCharacter(text.at(i)))
+                ++i;
+            Token token = {Token::Word, text.mid(start, i - start)};
+            tokens.push_back(token);
+        } else if(c == ';') {
+            // The statement ends here. Stop if the cursor is in it, otherwise start over with the next statement.
+            if(i >= cursor)
+                break;
+            tokens.clear();
+            ++i;
+        } else {
+            Token token = {Token::Symbol, QString(c)};
+            tokens.push_back(token);
+            ++i;
+        }
+    }
+
+    return tokens;
+}
+
+bool enoughCommas(const QString& arguments, int commas)
+{
+    int end = arguments.indexOf(')');
+    if(end < 0)
+        return false;
+    return arguments.left(end).count(',') >= commas;
+}
+}
+
+SqlCompletionIndex::SqlCompletionIndex(QsciLexer* lexer)
+    : QsciAbstractAPIs(lexer)
+{
+}
+
+void SqlCompletionIndex::addKeyword(const QString& keyword)
+{
+    Word word = {keyword.toLower(), keyword, SqlUiLexer::ApiCompleterIconIdKeyword};
+    m_words.push_back(word);
+}
+
+void SqlCompletionIndex::addFunction(const QString& function, const QString& description)
+{
+    Word word = {function.toLower(), function, SqlUiLexer::ApiCompleterIconIdFunction};
+    m_words.push_back(word);
+
+    // The upper and lower case versions of a function share their call tips
+    QStringList& tips = m_callTips[word.key];
+    if(!tips.contains(description))
+        tips.push_back(description);
+}
+
+void SqlCompletionIndex::prepare()
+{
+    std::stable_sort(m_words.begin(), m_words.end(), [](const Word& a, const Word& b) {
+        return a.key < b.key;
+    });
+}
+
+void SqlCompletionIndex::setTables(const TablesAndColumnsMap& tables)
+{
+    QSet<QString> keys;
+    for(auto it=tables.constBegin();it!=tables.constEnd();++it)
+    {
+        const QString key = it.key().toLower();
+        keys.insert(key);
+
+        // Tables of the same name in different schemata are merged
+        QStringList columns = it.value();
+        columns.removeDuplicates();
+
+        // Leave the table alone if it hasn't changed
+        auto existing = m_tables.find(key);
+        if(existing != m_tables.end())
+        {
+            if(existing->name == it.key() && existing->columns == columns)
+                continue;
+            removeColumns(existing->columns);
+        }
+
+        Table table;
+        table.name = it.key();
+        table.columns = columns;
+        addColumns(table.columns);
+        m_tables.insert(key, table);
+    }
+
+    // Remove all tables which don't exist anymore
+    for(auto it=m_tables.begin();it!=m_tables.end();)
+    {
+        if(keys.contains(it.key()))
+        {
+            ++it;
+        } else {
+            removeColumns(it->columns);
+            it = m_tables.erase(it);
+        }
+    }
+}
+
+void SqlCompletionIndex::addColumns(const QStringList& columns)
+{
+    foreach(const QString& column, columns)
+        m_columns[column.toLower()][column]++;
+}
+
+void SqlCompletionIndex::removeColumns(const QStringList& columns)
+{
+    foreach(const QString& column, columns)
+    {
+        auto spellings = m_columns.find(column.toLower());
+        if(spellings == m_columns.end())
+            continue;
+
+        auto count = spellings->find(column);
+        if(count != spellings->end() && --count.value() <= 0)
+            spellings->erase(count);
+        if(spellings->isEmpty())
+            m_columns.erase(spellings);
+    }
+}
+
+void SqlCompletionIndex::updateAutoCompletionList(const QStringList& context, QStringList& list)
+{
+    if(context.isEmpty())
+        return;
+
+    const QString prefix = context.last().toLower();
+
+    // After a "qualifier." only the columns of the table it refers to are listed. They aren't sorted because tables don't have that many
+    // columns and because QScintilla sorts the list anyway.
+    if(context.size() > 1)
+    {
+        const Table* table = resolveQualifier(context.at(context.size() - 2));
+        if(table)
+        {
+            const QString iconId = "?" + QString::number(SqlUiLexer::ApiCompleterIconIdColumn);
+            foreach(const QString& column, table->columns)
+            {
+                if(column.startsWith(prefix, Qt::CaseInsensitive))
+                    list.push_back(column + iconId);
+            }
+        }
+        return;
+    }
+
+    // Keywords and functions
+    auto word = std::lower_bound(m_words.constBegin(), m_words.constEnd(), prefix, [](const Word& w, const QString& value) {
+        return w.key < value;
+    });
+    for(;word!=m_words.constEnd() && word->key.startsWith(prefix);++word)
+        list.push_back(word->word + "?" + QString::number(word->iconId));
+
+    // Tables
+    const QString tableIconId = "?" + QString::number(SqlUiLexer::ApiCompleterIconIdTable);
+    for(auto it=m_tables.lowerBound(prefix);it!=m_tables.end() && it.key().startsWith(prefix);++it)
+        list.push_back(it->name + tableIconId);
+
+    // Columns of all tables
+    const QString columnIconId = "?" + QString::number(SqlUiLexer::ApiCompleterIconIdColumn);
+    for(auto it=m_columns.lowerBound(prefix);it!=m_columns.end() && it.key().startsWith(prefix);++it)
+    {
+        for(auto spelling=it->constBegin();spelling!=it->constEnd();++spelling)
+            list.push_back(spelling.key() + columnIconId);
+    }
+}
+
+QStringList SqlCompletionIndex::callTips(const QStringList& context, int commas, QsciScintilla::CallTipsStyle style, QList<int>& shifts)
+{
+    Q_UNUSED(style);
+
+    // The last word of the context is empty, the one before it is the name of the function
+    QStringList tips;
+    if(context.size() < 2)
+        return tips;
+
+    const QString& function = context.at(context.size() - 2);
+    foreach(const QString& description, m_callTips.value(function.toLower()))
+    {
+        if(enoughCommas(description, commas))
+        {
+            tips.push_back(function + description);
+            shifts.push_back(0);
+        }
+    }
+
+    return tips;
+}
+
+bool SqlCompletionIndex::isKeyword(const QString& word) const
+{
+    const QString key = word.toLower();
+    auto it = std::lower_bound(m_words.constBegin(), m_words.constEnd(), key, [](const Word& w, const QString& value) {
+        return w.key < value;
+    });
+    for(;it!=m_words.constEnd() && it->key == key;++it)
+    {
+        if(it->iconId == SqlUiLexer::ApiCompleterIconIdKeyword)
+            return true;
+    }
+    return false;
+}
+
+const SqlCompletionIndex::Table* SqlCompletionIndex::resolveQualifier(const QString& qualifier) const
+{
+    // Aliases hide tables of the same name
+    QString name = currentAliases().value(qualifier.toLower(), qualifier);
+
+    auto it = m_tables.constFind(name.toLower());
+    if(it == m_tables.constEnd())
+        return nullptr;
+    return &it.value();
+}
+
+QHash<QString, QString> SqlCompletionIndex::currentAliases() const
+{
+    QHash<QString, QString> aliases;
+
+    // The lexer is shared by all editors, so use the one the user is typing in
+    QsciScintilla* editor = qobject_cast<QsciScintilla*>(QApplication::focusWidget());
+    if(!editor || editor->lexer() != lexer())
+        return aliases;
+
+    int line, index;
+    editor->getCursorPosition(&line, &index);
+    const QString textBeforeCursor = editor->text(0, editor->positionFromLineIndex(line, index));
+    const QVector<Token> tokens = currentStatementTokens(editor->text(), textBeforeCursor.size());
+
+    auto isName = [this](const Token& token) {
+        return token.type == Token::QuotedId || (token.type == Token::Word && !isKeyword(token.text));
+    };
+
+    // Look for table lists like "FROM schema.table AS alias, table alias" or "JOIN table alias"
+    for(int i=0;i<tokens.size();i++)
+    {
+        if(tokens.at(i).type != Token::Word)
+            continue;
+        const QString keyword = tokens.at(i).text.toUpper();
+        if(keyword != "FROM" && keyword != "JOIN" && keyword != "UPDATE" && keyword != "INTO")
+            continue;
+
+        int j = i + 1;
+        while(true)
+        {
+            QString table;
+            if(j < tokens.size() && isSymbol(tokens.at(j), '('))
+            {
+                // Skip subqueries. They can have an alias but it doesn't refer to any table.
+                int depth = 0;
+                for(;j<tokens.size();j++)
+                {
+                    if(isSymbol(tokens.at(j), '('))
+                        depth++;
+                    else if(isSymbol(tokens.at(j), ')') && --depth == 0)
+                        break;
+                }
+                j++;
+            } else {
+                // The table name is the last part of a name which can be qualified by the schema name
+                while(j < tokens.size() && isName(tokens.at(j)))
+                {
+                    table = tokens.at(j++).text;
+                    if(j+1 < tokens.size() && isSymbol(tokens.at(j), '.'))
+                        j++;
+                    else
+                        break;
+                }
+            }
+
+            if(j < tokens.size() && tokens.at(j).type == Token::Word && tokens.at(j).text.compare("AS", Qt::CaseInsensitive) == 0)
+                j++;
+            if(j < tokens.size() && isName(tokens.at(j)))
+            {
+                if(!table.isEmpty())
+                    aliases.insert(tokens.at(j).text.toLower(), table);
+                j++;
+            }
+
+            if(j < tokens.size() && isSymbol(tokens.at(j), ',') && (keyword == "FROM" || keyword == "JOIN"))
+                j++;
+            else
+                break;
+        }
+
+        i = j - 1;
+    }
+
+    return aliases;
+}
@@ -0,0 +1,78 @@
+#ifndef SQLCOMPLETIONINDEX_H
+#define SQLCOMPLETIONINDEX_H
+
+#include "Qsci/qsciabstractapis.h"
+
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief The SqlCompletionIndex class
+ *
+ * This provides the auto completion lists and call tips of the SQL editors. Unlike QsciAPIs, which needs to rebuild its whole word list
+ * whenever anything changes, it keeps the words in sorted containers keyed by their lower case spelling. A completion request is a binary
+ * search for the typed prefix followed by a walk over the matching entries, and a changed schema only touches the tables which have
+ * actually changed.
+ *
+ * Keywords and functions are added once using addKeyword() and addFunction(), followed by a call to prepare(). Tables and their columns
+ * are updated using setTables().
+ *
+ * When completing the column after a "qualifier." the qualifier can be a table name or an alias which has been defined in the FROM or JOIN
+ * clauses of the statement which is being edited.
+ */
+class SqlCompletionIndex : public QsciAbstractAPIs
+{
+public:
+    explicit SqlCompletionIndex(QsciLexer* lexer);
+
+    //! Adds a keyword to the completion list
+    void addKeyword(const QString& keyword);
+
+    //! Adds a function. The description starts with the argument list and is shown as call tip.
+    void addFunction(const QString& function, const QString& description);
+
+    //! Sorts the keywords and functions. Call this after adding them.
+    void prepare();
+
+    //! Updates the tables and their columns. Only the tables which have been added, removed or changed since the last call are processed.
+    typedef QMap<QString, QList<QString> > TablesAndColumnsMap;
+    void setTables(const TablesAndColumnsMap& tables);
+
+    virtual void updateAutoCompletionList(const QStringList& context, QStringList& list);
+    virtual QStringList callTips(const QStringList& context, int commas, QsciScintilla::CallTipsStyle style, QList<int>& shifts);
+
+private:
+    struct Word
+    {
+        QString key;        // The word in lower case. The lists are sorted by this.
+        QString word;
+        int iconId;
+    };
+
+    struct Table
+    {
+        QString name;
+        QStringList columns;
+    };
+
+    // Returns true if the word is an SQL keyword
+    bool isKeyword(const QString& word) const;
+
+    // Returns the table the qualifier in front of a column name refers to or a null pointer if it's unknown
+    const Table* resolveQualifier(const QString& qualifier) const;
+
+    // Returns the aliases of the statement in the focused editor in lower case, mapped to the names of the tables they refer to
+    QHash<QString, QString> currentAliases() const;
+
+    void addColumns(const QStringList& columns);
+    void removeColumns(const QStringList& columns);
+
+    QVector<Word> m_words;                          // Keywords and functions, sorted by their keys
+    QHash<QString, QStringList> m_callTips;         // Lower case function name -> argument lists and descriptions
+    QMap<QString, Table> m_tables;                  // Lower case table name -> table
+    QMap<QString, QMap<QString, int> > m_columns;   // Lower case column name -> each spelling of it and the number of tables using it
+};
+
+#endif
@@ -5,28 +5,56 @@
 #include "sqlitedb.h"
 #include "Settings.h"
 #include "ExportDataDialog.h"
+#include "sqlite.h"
 
+#include <QApplication>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QRegExp>
+
+SqlExecutionArea* SqlExecutionArea::mainConnectionOwner = nullptr;
 
 SqlExecutionArea::SqlExecutionArea(DBBrowserDB& _db, QWidget* parent) :
     QWidget(parent),
     db(_db),
-    ui(new Ui::SqlExecutionArea)
+    ui(new Ui::SqlExecutionArea),
+    executing(false),
+    stopRequested(false),
+    executionOffset(0),
+    executionLine(0),
+    executionIndex(0),
+    modified(false),
+    wasDirty(false),
+    structureUpdated(false),
+    savepointCreated(false),
+    currentStatementEnd(0),
+    currentReturnsRows(false),
+    currentReadOnly(false)
 {
     // Create UI
     ui->setupUi(this);
 
     // Create model
     model = new SqliteTableModel(db, this, Settings::getValue("db", "prefetchsize").toInt());
+    model->setAsyncFetching(true);
     ui->tableResult->setModel(model);
 
+    // Statements are executed in a worker thread so the application stays responsive while they are running
+    executor = new SqlExecutor(this);
+    connect(executor, &SqlExecutor::executed, this, &SqlExecutionArea::statementExecuted, Qt::QueuedConnection);
+    connect(&db, &DBBrowserDB::aboutToClose, this, &SqlExecutionArea::abortExecution);
+
     // Load settings
     reloadSettings();
 }
 
 SqlExecutionArea::~SqlExecutionArea()
 {
+    executor->stop();
+    executor->wait();
+    if(mainConnectionOwner == this)
+        mainConnectionOwner = nullptr;
+
     delete ui;
 }
 
@@ -40,6 +68,35 @@ QString SqlExecutionArea::getSelectedSql() const
     return ui->editEditor->selectedText().trimmed().replace(QChar(0x2029), '\n');
 }
 
+QString SqlExecutionArea::getCurrentStatement() const
+{
+    QString selected = getSelectedSql();
+    if(!selected.isEmpty())
+        return selected;
+
+    // Positions in the editor are byte offsets into the UTF-8 text. Just like for executing the current line, semicolons in strings and
+    // comments aren't taken into account here.
+    int line, index;
+    ui->editEditor->getCursorPosition(&line, &index);
+    int position = ui->editEditor->positionFromLineIndex(line, index);
+    QByteArray text = getSql().toUtf8();
+
+    // A negative start position would make lastIndexOf() search from the end of the text
+    int start = (position > 0 ? text.lastIndexOf(';', position - 1) : -1) + 1;
+    int end = text.indexOf(';', position);
+    if(end == -1)
+        end = text.size();
+
+    // If the cursor is right behind the end of a statement, take this statement
+    if(text.mid(start, end - start).trimmed().isEmpty() && start > 0)
+    {
+        end = start - 1;
+        start = (end > 0 ? text.lastIndexOf(';', end - 1) : -1) + 1;
+    }
+
+    return QString::fromUtf8(text.mid(start, end - start)).trimmed();
+}
+
 void SqlExecutionArea::finishExecution(const QString& result)
 {
     ui->editErrors->setPlainText(result);
@@ -53,6 +110,290 @@ void SqlExecutionArea::finishExecution(const QString& result)
     }
 }
 
+void SqlExecutionArea::execute(const QString& query, int startLine, int startIndex)
+{
+    if(executing)
+        return;
+
+    executing = true;
+    stopRequested = false;
+    executionQuery = query.toUtf8();
+    executionOffset = 0;
+    executionLine = startLine;
+    executionIndex = startIndex;
+    statusMessage.clear();
+    modified = false;
+    wasDirty = db.getDirty();
+    structureUpdated = false;
+    savepointCreated = false;
+
+    // Remove any error indicators
+    ui->editEditor->clearErrorIndicators();
+
+    emit executionStarted();
+
+    executionTimer.start();
+    executeNextStatement();
+}
+
+void SqlExecutionArea::executeNextStatement()
+{
+    if(stopRequested)
+    {
+        statusMessage = tr("Execution aborted by user");
+        finishStatements();
+        return;
+    }
+    if(executionOffset >= executionQuery.size())
+    {
+        finishStatements();
+        return;
+    }
+
+    // Prepare the statement on a read-only connection if possible. This doesn't have to wait for other tabs executing statements on
+    // the main connection. The statement is only prepared here for finding out where it ends and what it does. It's executed by the
+    // worker thread.
+    ConnectionPool::Handle connection;
+    if(mainConnectionOwner != this)
+        connection = db.readConnection();
+    if(!connection.isPooled())
+    {
+        if(!acquireMainConnection())
+        {
+            finishStatements();
+            return;
+        }
+        connection = ConnectionPool::wrap(db._db);
+    }
+
+    const char* tail = executionQuery.constData() + executionOffset;
+    const char* next = tail;
+    sqlite3_stmt* stmt = nullptr;
+    int status = sqlite3_prepare_v2(connection, tail, executionQuery.size() - executionOffset, &stmt, &next);
+    int length = next - tail;
+    QString queryPart = QString::fromUtf8(tail, length);
+    int execution_end_index = executionIndex + length;
+    if(status != SQLITE_OK)
+    {
+        statusMessage = QString::fromUtf8(sqlite3_errmsg(connection)) + ": " + queryPart;
+        ui->editEditor->setErrorIndicator(executionLine, executionIndex, executionLine, execution_end_index);
+        finishStatements();
+        return;
+    }
+    executionOffset += length;
+
+    // Nothing to do for whitespace or comments between the statements
+    if(!stmt)
+    {
+        executionIndex = execution_end_index;
+        executeNextStatement();
+        return;
+    }
+
+    bool returnsRows = sqlite3_column_count(stmt) > 0;
+    bool readOnly = sqlite3_stmt_readonly(stmt) != 0;
+    sqlite3_finalize(stmt);
+
+    // Transaction statements as well as ATTACH and DETACH don't change the database file but they change the state of the connection.
+    // PRAGMA statements might do so or return settings of the connection. So execute all of them on the main connection.
+    QString trimmed = queryPart.trimmed();
+    if(trimmed.contains(QRegExp("^(BEGIN|COMMIT|END|ROLLBACK|SAVEPOINT|RELEASE|ATTACH|DETACH|PRAGMA)\\b", Qt::CaseInsensitive)))
+        readOnly = false;
+
+    // Check whether the DB structure is changed by this statement
+    if(trimmed.startsWith("ALTER", Qt::CaseInsensitive) ||
+            trimmed.startsWith("CREATE", Qt::CaseInsensitive) ||
+            trimmed.startsWith("DROP", Qt::CaseInsensitive) ||
+            trimmed.startsWith("ROLLBACK", Qt::CaseInsensitive))
+        structureUpdated = true;
+
+    // Statements which only read data can stay on the read-only connection. They don't need a savepoint either.
+    if(!readOnly || !connection.isPooled())
+    {
+        if(!acquireMainConnection())
+        {
+            finishStatements();
+            return;
+        }
+        connection = ConnectionPool::wrap(db._db);
+
+        // Check whether this is trying to set a pragma or to vacuum the database
+        if((trimmed.startsWith("PRAGMA", Qt::CaseInsensitive) && trimmed.contains('=')) || trimmed.startsWith("VACUUM", Qt::CaseInsensitive))
+        {
+            // We're trying to set a pragma. If the database has been modified it needs to be committed first. We'll need to ask the
+            // user about that
+            if(db.getDirty())
+            {
+                if(QMessageBox::question(this,
+                                         QApplication::applicationName(),
+                                         tr("Setting PRAGMA values or vacuuming will commit your current transaction.\nAre you sure?"),
+                                         QMessageBox::Yes | QMessageBox::Default,
+                                         QMessageBox::No | QMessageBox::Escape) == QMessageBox::Yes)
+                {
+                    // Commit all changes
+                    db.releaseAllSavepoints();
+                } else {
+                    // Abort
+                    statusMessage = tr("Execution aborted by user");
+                    finishStatements();
+                    return;
+                }
+            }
+        } else if(!savepointCreated) {
+            // We're not trying to set a pragma or to vacuum the database. In this case make sure a savepoint has been created in order
+            // to avoid committing all changes to the database immediately. Don't set more than one savepoint.
+            // There is no choice, we have to start a transaction before the statement is executed, otherwise every executed statement
+            // will get committed after the prepared statement gets finalized, see http://www.sqlite.org/lang_transaction.html
+            db.setSavepoint();
+            savepointCreated = true;
+        }
+    }
+
+    currentStatement = queryPart;
+    currentStatementEnd = execution_end_index;
+    currentReturnsRows = returnsRows;
+    currentReadOnly = readOnly;
+
+    // Statements which return rows are executed by fetching their first chunk of rows into the model. All the other rows are fetched
+    // when they are needed, just like when browsing a table.
+    if(returnsRows)
+    {
+        RowLoader::Task task = model->prepareQuery(queryPart, connection);
+        if(task.columns == 0)
+        {
+            statusMessage = QString::fromUtf8(sqlite3_errmsg(connection)) + ": " + queryPart;
+            finishStatements();
+            return;
+        }
+        executor->fetch(task);
+    } else {
+        executor->execute(connection, queryPart.toUtf8());
+    }
+}
+
+void SqlExecutionArea::statementExecuted(const SqlExecutor::Result& result)
+{
+    // Ignore results arriving after the execution has been aborted
+    if(!executing)
+        return;
+
+    qint64 elapsed = executionTimer.restart();
+    QString trimmed = currentStatement.trimmed();
+
+    if(result.interrupted)
+    {
+        statusMessage = tr("Execution aborted by user");
+        finishStatements();
+        return;
+    } else if(result.status != SQLITE_DONE) {
+        statusMessage = result.error + ": " + currentStatement;
+        finishStatements();
+        return;
+    }
+
+    // Statements which don't just read data might have changed the database
+    if(!currentReadOnly)
+        modified = true;
+
+    if(currentReturnsRows)
+    {
+        model->setQueryResult(result.rows);
+        if(model->valid())
+        {
+            // The query takes the last placeholder as it may itself contain the sequence '%' + number
+            if(model->rowCountAvailable())
+                statusMessage = tr("%1 rows returned in %2ms from: %3").arg(model->totalRowCount()).arg(elapsed).arg(trimmed);
+            else
+                statusMessage = tr("About %1 rows returned in %2ms, still counting, from: %3").arg(model->totalRowCount()).arg(elapsed).arg(trimmed);
+        } else {
+            statusMessage = tr("Error executing query: %1").arg(currentStatement);
+            finishStatements();
+            return;
+        }
+    } else {
+        QString stmtHasChangedDatabase;
+        if(trimmed.startsWith("INSERT", Qt::CaseInsensitive) ||
+                trimmed.startsWith("UPDATE", Qt::CaseInsensitive) ||
+                trimmed.startsWith("DELETE", Qt::CaseInsensitive))
+        {
+            stmtHasChangedDatabase = tr(", %1 rows affected").arg(result.changes);
+        }
+
+        statusMessage = tr("Query executed successfully: %1 (took %2ms%3)").arg(trimmed).arg(elapsed).arg(stmtHasChangedDatabase);
+    }
+
+    executionIndex = currentStatementEnd;
+    executeNextStatement();
+}
+
+void SqlExecutionArea::finishStatements()
+{
+    executing = false;
+
+    if(!modified && !wasDirty && savepointCreated)
+        db.revertToSavepoint(); // better rollback, if the logic is not enough we can tune it.
+    releaseMainConnection();
+
+    finishExecution(statusMessage);
+
+    // If the DB structure was changed by some command in this SQL script, update our schema representations
+    if(structureUpdated)
+        db.updateSchema();
+
+    emit executionFinished();
+}
+
+void SqlExecutionArea::stopExecution()
+{
+    if(!executing)
+        return;
+
+    // The statement which is running right now is interrupted. If there is none, the next one isn't started.
+    stopRequested = true;
+    executor->stop();
+}
+
+void SqlExecutionArea::abortExecution()
+{
+    if(!executing)
+        return;
+
+    // Wait for the worker to stop. Its result is thrown away.
+    executor->stop();
+    executor->wait();
+    executing = false;
+    releaseMainConnection();
+
+    finishExecution(tr("Execution aborted by user"));
+    emit executionFinished();
+}
+
+bool SqlExecutionArea::acquireMainConnection()
+{
+    if(mainConnectionOwner && mainConnectionOwner != this)
+    {
+        statusMessage = tr("Another SQL tab is executing statements which might change the database right now. "
+                           "Wait for it to finish or stop it before executing these statements.");
+        return false;
+    }
+
+    if(!mainConnectionOwner)
+    {
+        mainConnectionOwner = this;
+        emit mainConnectionChanged();
+    }
+    return true;
+}
+
+void SqlExecutionArea::releaseMainConnection()
+{
+    if(mainConnectionOwner != this)
+        return;
+
+    mainConnectionOwner = nullptr;
+    emit mainConnectionChanged();
+}
+
 SqlTextEdit *SqlExecutionArea::getEditor()
 {
     return ui->editEditor;
@@ -110,4 +451,5 @@ void SqlExecutionArea::reloadSettings()
 
     // Set prefetch settings
     model->setChunkSize(Settings::getValue("db", "prefetchsize").toInt());
+    model->setCacheMemoryBudget(Settings::getValue("db", "rowcachesize").toULongLong() * 1024 * 1024);
 }
@@ -1,8 +1,11 @@
 #ifndef SQLEXECUTIONAREA_H
 #define SQLEXECUTIONAREA_H
 
+#include <QElapsedTimer>
 #include <QWidget>
 
+#include "SqlExecutor.h"
+
 class SqlTextEdit;
 class SqliteTableModel;
 class DBBrowserDB;
@@ -23,24 +26,79 @@ public:
     QString getSql() const;
     QString getSelectedSql() const;
 
+    //! Returns the selected text or, if nothing is selected, the statement in which the cursor is
+    QString getCurrentStatement() const;
+
     QString fileName() const { return sqlFileName; }
     void setFileName(const QString& filename) { sqlFileName = filename; }
 
     SqliteTableModel* getModel() { return model; }
     SqlTextEdit* getEditor();
     ExtendedTableWidget *getTableResult();
-    
+
+    /**
+     * @brief execute starts executing the statements of a query one after the other in the background
+     * @param query The statements to execute
+     * @param startLine Line of the editor in which the query starts. This is used for marking errors.
+     * @param startIndex Position in this line at which the query starts
+     */
+    void execute(const QString& query, int startLine, int startIndex);
+    bool isExecuting() const { return executing; }
+
+    //! Returns true while any tab is executing statements on the main connection. Nothing else should use it until then.
+    static bool mainConnectionBusy() { return mainConnectionOwner != nullptr; }
+
 public slots:
     virtual void finishExecution(const QString& result);
+    void stopExecution();
+    void abortExecution();
     virtual void saveAsCsv();
     virtual void saveAsView();
     virtual void reloadSettings();
 
+signals:
+    void executionStarted();
+    void executionFinished();
+    void mainConnectionChanged();
+
+private slots:
+    void statementExecuted(const SqlExecutor::Result& result);
+
 private:
+    void executeNextStatement();
+    void finishStatements();
+    bool acquireMainConnection();
+    void releaseMainConnection();
+
     DBBrowserDB& db;
     SqliteTableModel* model;
     QString sqlFileName;
     Ui::SqlExecutionArea* ui;
+
+    // State of the execution of a query
+    SqlExecutor* executor;
+    bool executing;
+    bool stopRequested;
+    QByteArray executionQuery;      // All statements to execute
+    int executionOffset;            // Position of the next statement in executionQuery
+    int executionLine;              // Position of the next statement in the editor
+    int executionIndex;
+    QElapsedTimer executionTimer;
+    QString statusMessage;
+    bool modified;
+    bool wasDirty;
+    bool structureUpdated;
+    bool savepointCreated;
+
+    // The statement which is executed right now
+    QString currentStatement;
+    int currentStatementEnd;
+    bool currentReturnsRows;
+    bool currentReadOnly;
+
+    // Statements which change the database are executed on the main connection and might set a savepoint which is only released at the
+    // end of the query. So only one tab at a time can execute statements there while others can still read on read-only connections.
+    static SqlExecutionArea* mainConnectionOwner;
 };
 
 #endif
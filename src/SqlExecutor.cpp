@@ -0,0 +1,113 @@
+#include "SqlExecutor.h"
+#include "sqlite.h"
+
+#include <QMutexLocker>
+
+SqlExecutor::SqlExecutor(QObject* parent)
+    : QThread(parent),
+      m_busy(false),
+      m_cancel(0)
+{
+    qRegisterMetaType<SqlExecutor::Result>();
+}
+
+SqlExecutor::~SqlExecutor()
+{
+    stop();
+    wait();
+}
+
+bool SqlExecutor::execute(const ConnectionPool::Handle& db, const QByteArray& statement)
+{
+    RowLoader::Task task;
+    task.db = db;
+    task.query = statement;
+    return startTask(task);
+}
+
+bool SqlExecutor::fetch(const RowLoader::Task& task)
+{
+    if(task.columns == 0)
+        return false;
+    return startTask(task);
+}
+
+bool SqlExecutor::startTask(const RowLoader::Task& task)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if(m_busy)
+            return false;
+        m_busy = true;
+        m_task = task;
+        m_cancel.store(0);
+    }
+
+    // The thread might still be finishing after handing back the result of the previous statement
+    wait();
+    QThread::start();
+    return true;
+}
+
+void SqlExecutor::stop()
+{
+    QMutexLocker lock(&m_mutex);
+    if(m_busy)
+    {
+        m_cancel.store(1);
+        sqlite3_interrupt(m_task.db);
+    }
+}
+
+bool SqlExecutor::isExecuting()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_busy;
+}
+
+void SqlExecutor::run()
+{
+    RowLoader::Task task;
+    {
+        QMutexLocker lock(&m_mutex);
+        task = m_task;
+    }
+
+    Result result;
+    if(task.columns > 0)
+    {
+        result.rows = RowLoader::fetch(task, &m_cancel);
+        result.status = result.rows.ok ? SQLITE_DONE : sqlite3_errcode(task.db);
+    } else {
+        sqlite3_stmt* stmt;
+        result.status = sqlite3_prepare_v2(task.db, task.query, task.query.size(), &stmt, NULL);
+        if(result.status == SQLITE_OK)
+        {
+            // Statements which are executed this way don't return any rows usually, but if they do just skip them
+            while((result.status = sqlite3_step(stmt)) == SQLITE_ROW)
+            {
+                if(m_cancel.load())
+                {
+                    result.status = SQLITE_INTERRUPT;
+                    break;
+                }
+            }
+            result.changes = sqlite3_changes(task.db);
+            if(result.status != SQLITE_DONE && result.status != SQLITE_INTERRUPT)
+                result.error = QString::fromUtf8(sqlite3_errmsg(task.db));
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    result.interrupted = m_cancel.load() || result.status == SQLITE_INTERRUPT;
+    if(result.status != SQLITE_DONE && result.error.isEmpty() && !result.interrupted)
+        result.error = QString::fromUtf8(sqlite3_errmsg(task.db));
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_busy = false;
+        m_task = RowLoader::Task();
+    }
+
+    emit executed(result);
+}
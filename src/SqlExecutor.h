@@ -0,0 +1,74 @@
+#ifndef SQLEXECUTOR_H
+#define SQLEXECUTOR_H
+
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QMutex>
+#include <QThread>
+
+#include "ConnectionPool.h"
+#include "RowLoader.h"
+
+/*!
+ * \brief The SqlExecutor class
+ *
+ * This is a worker thread which executes the statements of an SQL tab, one at a time, so the application doesn't freeze while a
+ * statement is running. Statements which don't return rows are executed to completion. For statements which return rows the first
+ * chunk is fetched, which is then handed to the model of the tab. The result is handed back using the executed() signal which should
+ * be connected using a queued connection.
+ *
+ * Only one statement can be executed at a time. A running statement can be stopped using stop().
+ */
+class SqlExecutor : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Result
+    {
+        Result() : status(0), changes(0), interrupted(false) {}
+
+        int status;                 // SQLite result code, i.e. SQLITE_DONE if the statement has been executed successfully
+        QString error;              // Error message if the statement failed
+        int changes;                // Number of rows changed by an INSERT, UPDATE or DELETE statement
+        bool interrupted;           // true if the statement has been stopped
+        RowLoader::Result rows;     // The first chunk of rows for statements which return rows
+    };
+
+    explicit SqlExecutor(QObject* parent = nullptr);
+    ~SqlExecutor();
+
+    /*!
+     * \brief execute starts executing a statement which doesn't return any rows
+     * \param db The connection to execute the statement on
+     * \param statement The statement
+     * \return false if another statement is still being executed
+     */
+    bool execute(const ConnectionPool::Handle& db, const QByteArray& statement);
+
+    //! Starts fetching the first chunk of rows for a statement. The connection and the statement are taken from the task.
+    bool fetch(const RowLoader::Task& task);
+
+    //! Stops the statement which is executed right now as soon as possible. This doesn't wait for the worker.
+    void stop();
+
+    bool isExecuting();
+
+signals:
+    void executed(const SqlExecutor::Result& result);
+
+protected:
+    virtual void run();
+
+private:
+    bool startTask(const RowLoader::Task& task);
+
+    QMutex m_mutex;
+    RowLoader::Task m_task;     // The statement to execute. If there are no columns, no rows are fetched.
+    bool m_busy;
+    QAtomicInt m_cancel;
+};
+
+Q_DECLARE_METATYPE(SqlExecutor::Result)
+
+#endif
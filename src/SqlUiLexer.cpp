@@ -1,11 +1,11 @@
 #include "SqlUiLexer.h"
-#include "Qsci/qsciapis.h"
+#include "SqlCompletionIndex.h"
 
 SqlUiLexer::SqlUiLexer(QObject* parent) :
     QsciLexerSQL(parent)
 {
     // Setup auto completion
-    autocompleteApi = new QsciAPIs(this);
+    autocompleteApi = new SqlCompletionIndex(this);
     setupAutoCompletion();
     autocompleteApi->prepare();
 
@@ -49,8 +49,8 @@ void SqlUiLexer::setupAutoCompletion()
             << "INT" << "INTEGER" << "REAL" << "TEXT" << "BLOB" << "NUMERIC" << "CHAR";
     foreach(const QString& keyword, keywordPatterns)
     {
-        autocompleteApi->add(keyword + "?" + QString::number(ApiCompleterIconIdKeyword));
-        autocompleteApi->add(keyword.toLower() + "?" + QString::number(ApiCompleterIconIdKeyword));
+        autocompleteApi->addKeyword(keyword);
+        autocompleteApi->addKeyword(keyword.toLower());
     }
 
     // Functions
@@ -118,8 +118,8 @@ void SqlUiLexer::setupAutoCompletion()
         QString fn = keyword.left(keyword.indexOf('('));
         QString descr = keyword.mid(keyword.indexOf('('));
 
-        autocompleteApi->add(fn + "?" + QString::number(ApiCompleterIconIdFunction) + descr);
-        autocompleteApi->add(fn.toUpper() + "?" + QString::number(ApiCompleterIconIdFunction) + descr);
+        autocompleteApi->addFunction(fn, descr);
+        autocompleteApi->addFunction(fn.toUpper(), descr);
 
         // Store all function names in order to highlight them in a different colour
         listFunctions.append(fn);
@@ -128,20 +128,11 @@ void SqlUiLexer::setupAutoCompletion()
 
 void SqlUiLexer::setTableNames(const TablesAndColumnsMap& tables)
 {
-    // Update list for auto completion
-    autocompleteApi->clear();
-    listTables.clear();
-    setupAutoCompletion();
-    for(auto it=tables.constBegin();it!=tables.constEnd();++it)
-    {
-        foreach(const QString& field, it.value())
-            autocompleteApi->add(it.key() + "?" + QString::number(SqlUiLexer::ApiCompleterIconIdTable) + "." +
-                                 field + "?" + QString::number(SqlUiLexer::ApiCompleterIconIdColumn));
+    // Update list for auto completion. Only the tables which have changed are updated.
+    autocompleteApi->setTables(tables);
 
-        // Store the table name list in order to highlight them in a different colour
-        listTables.append(it.key());
-    }
-    autocompleteApi->prepare();
+    // Store the table name list in order to highlight them in a different colour
+    listTables = tables.keys();
 }
 
 const char* SqlUiLexer::keywords(int set) const
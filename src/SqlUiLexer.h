@@ -5,7 +5,7 @@
 
 #include <QMap>
 
-class QsciAPIs;
+class SqlCompletionIndex;
 
 class SqlUiLexer : public QsciLexerSQL
 {
@@ -32,7 +32,7 @@ public:
     bool caseSensitive() const;
 
 private:
-    QsciAPIs* autocompleteApi;
+    SqlCompletionIndex* autocompleteApi;
 
     void setupAutoCompletion();
 
@@ -0,0 +1,170 @@
+#include "StatementCache.h"
+#include "sqlite.h"
+
+StatementCache::Handle::Handle(StatementCache* cache, sqlite3_stmt* stmt, const QByteArray& key)
+    : m_cache(cache),
+      m_stmt(stmt),
+      m_key(key)
+{
+}
+
+StatementCache::Handle::Handle(Handle&& other)
+    : m_cache(other.m_cache),
+      m_stmt(other.m_stmt),
+      m_key(other.m_key)
+{
+    other.m_cache = nullptr;
+    other.m_stmt = nullptr;
+}
+
+StatementCache::Handle::~Handle()
+{
+    if(m_cache && m_stmt)
+        m_cache->release(m_stmt, m_key);
+}
+
+StatementCache::StatementCache(int capacity)
+    : m_capacity(capacity),
+      m_clock(0),
+      m_hits(0),
+      m_misses(0)
+{
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+StatementCache::Handle StatementCache::acquire(sqlite3* db, const QString& sql)
+{
+    QByteArray key = normalize(sql);
+
+    auto it = m_entries.find(key);
+    if(it != m_entries.end() && !it->inUse)
+    {
+        m_hits++;
+        it->inUse = true;
+        it->lastUsed = ++m_clock;
+        return Handle(this, it->stmt, key);
+    }
+
+    m_misses++;
+    sqlite3_stmt* stmt;
+    if(sqlite3_prepare_v2(db, key, key.size(), &stmt, NULL) != SQLITE_OK)
+        return Handle();
+
+    // If the statement is cached but in use, e.g. because a query is executed while iterating over the results of the same query, hand
+    // out a statement which is finalised right after it has been used.
+    if(it != m_entries.end())
+        return Handle(this, stmt, QByteArray());
+
+    Entry entry;
+    entry.stmt = stmt;
+    entry.inUse = true;
+    entry.lastUsed = ++m_clock;
+    m_entries.insert(key, entry);
+    evict();
+
+    return Handle(this, stmt, key);
+}
+
+void StatementCache::release(sqlite3_stmt* stmt, const QByteArray& key)
+{
+    // Statements which aren't in the cache (anymore) are simply finalised
+    auto it = m_entries.find(key);
+    if(key.isEmpty() || it == m_entries.end() || it->stmt != stmt)
+    {
+        sqlite3_finalize(stmt);
+        return;
+    }
+
+    // Reset the statement so it doesn't keep a transaction open and doesn't hold on to any bound values
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    it->inUse = false;
+    evict();
+}
+
+void StatementCache::clear()
+{
+    for(auto it=m_entries.begin();it!=m_entries.end();++it)
+    {
+        if(!it->inUse)
+            sqlite3_finalize(it->stmt);
+    }
+    m_entries.clear();
+}
+
+void StatementCache::evict()
+{
+    while(m_entries.size() > m_capacity)
+    {
+        auto oldest = m_entries.end();
+        for(auto it=m_entries.begin();it!=m_entries.end();++it)
+        {
+            if(!it->inUse && (oldest == m_entries.end() || it->lastUsed < oldest->lastUsed))
+                oldest = it;
+        }
+
+        // Stop here if all statements are in use. The cache shrinks again when they are released.
+        if(oldest == m_entries.end())
+            return;
+
+        sqlite3_finalize(oldest->stmt);
+        m_entries.erase(oldest);
+    }
+}
+
+QByteArray StatementCache::normalize(const QString& sql)
+{
+    QByteArray in = sql.toUtf8();
+    QByteArray out;
+    out.reserve(in.size());
+
+    bool space = false;
+    for(int i=0;i<in.size();i++)
+    {
+        char c = in.at(i);
+
+        if(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v')
+        {
+            space = true;
+            continue;
+        }
+        if(space && !out.isEmpty())
+            out.append(' ');
+        space = false;
+
+        // Copy quoted identifiers, string literals and comments as they are
+        int end = -1;
+        if(c == '\'' || c == '"' || c == '`' || c == '[')
+        {
+            char close = (c == '[') ? ']' : c;
+            end = in.indexOf(close, i + 1);
+            // Doubled quote characters are escaped quotes and don't end the literal
+            while(close != ']' && end != -1 && end + 1 < in.size() && in.at(end + 1) == close)
+                end = in.indexOf(close, end + 2);
+        } else if(c == '-' && i + 1 < in.size() && in.at(i + 1) == '-') {
+            end = in.indexOf('\n', i);
+        } else if(c == '/' && i + 1 < in.size() && in.at(i + 1) == '*') {
+            end = in.indexOf("*/", i + 2);
+            if(end != -1)
+                end++;
+        } else {
+            out.append(c);
+            continue;
+        }
+
+        if(end == -1)
+            end = in.size() - 1;
+        out.append(in.mid(i, end - i + 1));
+        i = end;
+    }
+
+    // Trailing semicolons don't make a difference for single statements
+    while(out.endsWith(';') || out.endsWith(' '))
+        out.chop(1);
+
+    return out;
+}
@@ -0,0 +1,90 @@
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/*!
+ * \brief The StatementCache class
+ *
+ * This keeps prepared statements around so statements which are executed over and over again, like the ones for reading or updating a
+ * single row, don't need to be compiled each time. Statements are looked up by their SQL text after normalising the whitespace. When
+ * more than the maximum number of statements are cached, the ones which haven't been used for the longest time are finalised.
+ *
+ * A statement which has been acquired is reserved until its handle is destroyed. When the same statement is requested again while it is
+ * still in use, an uncached statement is prepared instead. The cache isn't thread safe, so only use it from one thread.
+ */
+class StatementCache
+{
+public:
+    /*!
+     * \brief The Handle class gives access to a statement of the cache. The statement is reset, its bindings are cleared, and it is
+     * handed back to the cache when the handle is destroyed.
+     */
+    class Handle
+    {
+    public:
+        Handle() : m_cache(nullptr), m_stmt(nullptr) {}
+        Handle(Handle&& other);
+        ~Handle();
+
+        sqlite3_stmt* get() const { return m_stmt; }
+        operator sqlite3_stmt*() const { return m_stmt; }
+        bool isValid() const { return m_stmt != nullptr; }
+
+    private:
+        friend class StatementCache;
+        Handle(StatementCache* cache, sqlite3_stmt* stmt, const QByteArray& key);
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        StatementCache* m_cache;
+        sqlite3_stmt* m_stmt;
+        QByteArray m_key;       // Empty if the statement isn't stored in the cache
+    };
+
+    explicit StatementCache(int capacity = 64);
+    ~StatementCache();
+
+    /*!
+     * \brief acquire returns a prepared statement for the given SQL text, either from the cache or freshly compiled
+     * \param db The database connection to prepare the statement on. All statements of one cache must belong to the same connection.
+     * \param sql A single SQL statement
+     * \return A handle to the statement. If the statement couldn't be prepared, the handle is invalid and sqlite3_errmsg() tells why.
+     */
+    Handle acquire(sqlite3* db, const QString& sql);
+
+    //! Finalises all cached statements. Statements which are in use right now are finalised as soon as their handles are destroyed.
+    void clear();
+
+    int size() const { return m_entries.size(); }
+    int capacity() const { return m_capacity; }
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+
+    //! Collapses whitespace outside of quotes and comments and removes trailing semicolons
+    static QByteArray normalize(const QString& sql);
+
+private:
+    struct Entry
+    {
+        sqlite3_stmt* stmt;
+        bool inUse;
+        quint64 lastUsed;
+    };
+
+    void release(sqlite3_stmt* stmt, const QByteArray& key);
+    void evict();
+
+    QMap<QByteArray, Entry> m_entries;
+    int m_capacity;
+    quint64 m_clock;
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+#endif
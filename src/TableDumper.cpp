@@ -0,0 +1,347 @@
+#include "TableDumper.h"
+#include "sqlitetypes.h"
+#include "sqlite.h"
+
+#include <QMutexLocker>
+#include <QObject>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+qint64 cacheMisses(sqlite3* db)
+{
+    // Every page which isn't in the page cache of the connection yet needs to be read from the file
+#ifdef SQLITE_DBSTATUS_CACHE_MISS
+    int current = 0, highwater = 0;
+    sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 0);
+    return current;
+#else
+    Q_UNUSED(db);
+    return 0;
+#endif
+}
+}
+
+class TableDumper::Worker : public QThread
+{
+public:
+    Worker(TableDumper* dumper, sqlite3* db, int index) : m_dumper(dumper), m_db(db), m_index(index) {}
+
+protected:
+    virtual void run() { m_dumper->work(m_db, m_index); }
+
+private:
+    TableDumper* m_dumper;
+    sqlite3* m_db;
+    int m_index;
+};
+
+TableDumper::TableDumper(const QVector<Table>& tables, bool columnNames, bool multiRowInserts)
+    : m_tables(tables),
+      m_columnNames(columnNames),
+      m_multiRowInserts(multiRowInserts),
+      m_states(tables.size()),
+      m_nextTable(0),
+      m_abort(0)
+{
+}
+
+TableDumper::~TableDumper()
+{
+    cancel();
+}
+
+void TableDumper::start(sqlite3* db, const QVector<ConnectionPool::Handle>& connections)
+{
+    if(m_tables.isEmpty())
+        return;
+
+    // Start a read transaction on each connection before any of them reads a table, so they all see the same data. Reading from
+    // sqlite_master is enough for acquiring the read lock. If this fails for any of them, use the main connection instead.
+    for(int i=0;i<connections.size() && i<m_tables.size();i++)
+    {
+        m_connections.push_back(connections.at(i));
+        if(!beginRead(connections.at(i)))
+        {
+            closeConnections();
+            break;
+        }
+    }
+
+    QVector<sqlite3*> workerConnections;
+    foreach(const ConnectionPool::Handle& connection, m_connections)
+        workerConnections.push_back(connection);
+    if(workerConnections.isEmpty())
+        workerConnections.push_back(db);
+
+    m_pages.fill(0, workerConnections.size());
+    m_pagesAtStart.clear();
+    for(int i=0;i<workerConnections.size();i++)
+        m_pagesAtStart.push_back(cacheMisses(workerConnections.at(i)));
+
+    for(int i=0;i<workerConnections.size();i++)
+    {
+        m_workers.emplace_back(new Worker(this, workerConnections.at(i), i));
+        m_workers.back()->start();
+    }
+}
+
+void TableDumper::cancel()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_abort.store(1);
+        m_blockAdded.wakeAll();
+        m_blockTaken.wakeAll();
+    }
+
+    for(auto it=m_workers.begin();it!=m_workers.end();++it)
+        (*it)->wait();
+    m_workers.clear();
+    closeConnections();
+}
+
+bool TableDumper::beginRead(sqlite3* db)
+{
+    if(sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return false;
+    return sqlite3_exec(db, "SELECT COUNT(*) FROM sqlite_master;", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+void TableDumper::closeConnections()
+{
+    // Hand the connections back to the pool without the read transactions
+    foreach(const ConnectionPool::Handle& connection, m_connections)
+    {
+        if(!sqlite3_get_autocommit(connection))
+            sqlite3_exec(connection, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+    m_connections.clear();
+}
+
+TableDumper::BlockResult TableDumper::nextBlock(int table, QByteArray& block, unsigned long timeout)
+{
+    QMutexLocker lock(&m_mutex);
+
+    TableState& state = m_states[table];
+    if(!m_abort.load() && state.blocks.isEmpty() && !state.finished)
+        m_blockAdded.wait(&m_mutex, timeout);
+
+    if(m_abort.load())
+        return DumpFailed;
+
+    if(!state.blocks.isEmpty())
+    {
+        block = state.blocks.takeFirst();
+        m_blockTaken.wakeAll();
+        return BlockReady;
+    }
+
+    return state.finished ? TableFinished : BlockTimeout;
+}
+
+qint64 TableDumper::pagesRead() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    qint64 pages = 0;
+    foreach(qint64 p, m_pages)
+        pages += p;
+    return pages;
+}
+
+QString TableDumper::errorMessage() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_error;
+}
+
+void TableDumper::fail(const QString& message)
+{
+    QMutexLocker lock(&m_mutex);
+    if(m_error.isEmpty())
+        m_error = message;
+    m_abort.store(1);
+    m_blockAdded.wakeAll();
+    m_blockTaken.wakeAll();
+}
+
+void TableDumper::work(sqlite3* db, int worker)
+{
+    // Take the tables in their order, so the table which is written next is always being read
+    forever
+    {
+        int table;
+        {
+            QMutexLocker lock(&m_mutex);
+            if(m_abort.load() || m_nextTable >= m_tables.size())
+                return;
+            table = m_nextTable++;
+        }
+
+        if(!dumpTable(db, worker, table))
+            return;
+    }
+}
+
+bool TableDumper::dumpTable(sqlite3* db, int worker, int table)
+{
+    const Table& t = m_tables.at(table);
+
+    QByteArray insert = "INSERT INTO " + sqlb::escapeIdentifier(t.name).toUtf8();
+    if(m_columnNames)
+        insert += " (" + t.columns.join(",").toUtf8() + ")";
+    insert += " VALUES (";
+    const char* lineSep = m_multiRowInserts ? "),\n" : ");\n";
+
+    QByteArray block;
+    QByteArray query = QString("SELECT * FROM %1;").arg(sqlb::escapeIdentifier(t.name)).toUtf8();
+    sqlite3_stmt* stmt;
+    if(sqlite3_prepare_v2(db, query, query.size(), &stmt, nullptr) != SQLITE_OK)
+    {
+        // Leaving out the data of a table would make the dump incomplete without anyone noticing
+        fail(QObject::tr("Reading the table %1 failed: %2").arg(t.name).arg(QString::fromUtf8(sqlite3_errmsg(db))));
+        return false;
+    }
+
+    block.reserve(BlockSize + 64 * 1024);
+    int columns = sqlite3_column_count(stmt);
+    size_t counter = 0;
+    int status;
+    while((status = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if(counter)
+            block.append(lineSep);
+
+        if(!m_multiRowInserts || !counter)
+            block.append(insert);
+        else
+            block.append(" (");
+
+        for(int i=0;i<columns;i++)
+        {
+            appendValue(block, stmt, i);
+            if(i != columns - 1)
+                block.append(',');
+        }
+        counter++;
+
+        if(m_abort.load())
+        {
+            sqlite3_finalize(stmt);
+            return false;
+        }
+
+        if(block.size() >= BlockSize)
+        {
+            if(!pushBlock(db, worker, table, block, false))
+            {
+                sqlite3_finalize(stmt);
+                return false;
+            }
+            block.reserve(BlockSize + 64 * 1024);
+        }
+    }
+
+    if(status != SQLITE_DONE)
+    {
+        fail(QObject::tr("Reading the table %1 failed: %2").arg(t.name).arg(QString::fromUtf8(sqlite3_errmsg(db))));
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    sqlite3_finalize(stmt);
+
+    if(counter)
+        block.append(");\n");
+    return pushBlock(db, worker, table, block, true);
+}
+
+bool TableDumper::pushBlock(sqlite3* db, int worker, int table, QByteArray& block, bool last)
+{
+    qint64 pages = cacheMisses(db);
+
+    QMutexLocker lock(&m_mutex);
+    m_pages[worker] = pages - m_pagesAtStart.at(worker);
+
+    // Don't run ahead too far of the table which is being written
+    while(!m_abort.load() && m_states.at(table).blocks.size() >= MaxPendingBlocks)
+        m_blockTaken.wait(&m_mutex);
+    if(m_abort.load())
+        return false;
+
+    if(!block.isEmpty())
+        m_states[table].blocks.push_back(block);
+    m_states[table].finished = last;
+    block.clear();
+    m_blockAdded.wakeAll();
+    return true;
+}
+
+void TableDumper::appendValue(QByteArray& out, sqlite3_stmt* stmt, int column)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    int type = sqlite3_column_type(stmt, column);
+    if(type == SQLITE_NULL)
+    {
+        out.append("NULL");
+        return;
+    }
+
+    const char* data = reinterpret_cast<const char*>(sqlite3_column_blob(stmt, column));
+    int size = sqlite3_column_bytes(stmt, column);
+
+    // Values with a null byte near the start are considered binary and written as hex literals
+    if(size && std::memchr(data, 0, std::min(size, 2048)))
+    {
+        out.append("X'");
+        for(int i=0;i<size;i++)
+        {
+            unsigned char c = static_cast<unsigned char>(data[i]);
+            out.append(hex[c >> 4]);
+            out.append(hex[c & 0xF]);
+        }
+        out.append('\'');
+        return;
+    }
+
+    switch(type)
+    {
+    case SQLITE_TEXT:
+    case SQLITE_BLOB:
+    {
+        // Double all quote characters but copy the parts between them at once
+        out.append('\'');
+        const char* end = data + size;
+        const char* p = data;
+        while(p < end)
+        {
+            const char* quote = static_cast<const char*>(std::memchr(p, '\'', end - p));
+            if(!quote)
+            {
+                out.append(p, end - p);
+                break;
+            }
+            out.append(p, quote - p + 1);
+            out.append('\'');
+            p = quote + 1;
+        }
+        out.append('\'');
+        break;
+    }
+    case SQLITE_FLOAT:
+        // Infinity can't be written as a number literal
+        if(std::search(data, data + size, "Inf", "Inf" + 3) != data + size)
+        {
+            out.append('\'');
+            out.append(data, size);
+            out.append('\'');
+        } else {
+            out.append(data, size);
+        }
+        break;
+    default:
+        out.append(data, size);
+    }
+}
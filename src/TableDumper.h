@@ -0,0 +1,124 @@
+#ifndef TABLEDUMPER_H
+#define TABLEDUMPER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+#include <QWaitCondition>
+#include <memory>
+#include <vector>
+
+#include "ConnectionPool.h"
+
+class QThread;
+struct sqlite3;
+struct sqlite3_stmt;
+
+/*!
+ * \brief The TableDumper class
+ *
+ * This formats the rows of tables as INSERT statements for the SQL export. The tables are read by a couple of worker threads, each of
+ * them using a read-only connection of its own, so several tables are read and formatted at the same time. The SQL of each table is
+ * handed out in blocks and in the order of the tables, so the caller can write it to the output while later tables are still being read.
+ * Workers only ever run ahead by a few blocks, so the memory usage doesn't depend on the size of the tables.
+ *
+ * All connections need to see the same data. So only use separate connections if there are no uncommitted changes. Before reading
+ * anything, a read transaction is started on each of them and kept open until the dump is complete. In rollback journal mode this
+ * keeps anyone from committing in between, so they all see the same state of the file. In WAL mode each connection could see a
+ * different snapshot, so pass only one connection there. Without separate connections all tables are read from the main connection,
+ * which needs to have been opened in serialized mode because it's used from the worker thread.
+ */
+class TableDumper
+{
+public:
+    struct Table
+    {
+        QString name;
+        QStringList columns;    // Column names for the INSERT statements
+    };
+
+    enum BlockResult
+    {
+        BlockReady,             // A block of SQL has been returned
+        BlockTimeout,           // There is no block yet, try again later
+        TableFinished,          // All of the table has been handed out
+        DumpFailed              // Reading the table failed or the dump has been cancelled
+    };
+
+    /*!
+     * \param tables The tables to dump, in the order in which they are written
+     * \param columnNames Add the column names to each INSERT statement
+     * \param multiRowInserts Insert all rows of a table using one INSERT statement
+     */
+    TableDumper(const QVector<Table>& tables, bool columnNames, bool multiRowInserts);
+    ~TableDumper();
+
+    /*!
+     * \brief start starts reading the tables
+     * \param db The main connection. This is used if there are no separate connections or starting a read transaction on them fails.
+     * \param connections Read-only connections for the workers, one worker per connection. They are handed back when the dump is complete.
+     */
+    void start(sqlite3* db, const QVector<ConnectionPool::Handle>& connections);
+
+    //! Cancels reading and waits for the workers to stop
+    void cancel();
+
+    /*!
+     * \brief nextBlock returns the next block of SQL for a table. Call this for all tables in their order.
+     * \param table Index of the table in the list passed to the constructor
+     * \param block Is set to the SQL text
+     * \param timeout Maximum number of milliseconds to wait for the block
+     */
+    BlockResult nextBlock(int table, QByteArray& block, unsigned long timeout);
+
+    //! Number of database pages which have been read so far. This is a good measure for the progress because it doesn't need counting the rows.
+    qint64 pagesRead() const;
+
+    QString errorMessage() const;
+
+    //! Appends a value of the current row of a statement as SQL literal
+    static void appendValue(QByteArray& out, sqlite3_stmt* stmt, int column);
+
+private:
+    class Worker;
+
+    struct TableState
+    {
+        TableState() : finished(false) {}
+
+        QList<QByteArray> blocks;
+        bool finished;
+    };
+
+    void work(sqlite3* db, int worker);
+    bool dumpTable(sqlite3* db, int worker, int table);
+    bool pushBlock(sqlite3* db, int worker, int table, QByteArray& block, bool last);
+    void fail(const QString& message);
+    static bool beginRead(sqlite3* db);
+    void closeConnections();
+
+    QVector<Table> m_tables;
+    bool m_columnNames;
+    bool m_multiRowInserts;
+
+    std::vector<std::unique_ptr<QThread>> m_workers;
+    QVector<ConnectionPool::Handle> m_connections;  // Connections of the workers. Each of them is in a read transaction until the dump is finished.
+    QVector<qint64> m_pages;                // Pages read by each worker
+    QVector<qint64> m_pagesAtStart;         // Pages read on each connection before the dump started
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_blockAdded;
+    QWaitCondition m_blockTaken;
+    QVector<TableState> m_states;
+    int m_nextTable;
+    QString m_error;
+    QAtomicInt m_abort;                     // Set when the dump has been cancelled or has failed
+
+    static const int BlockSize = 1024 * 1024;
+    static const int MaxPendingBlocks = 4;
+};
+
+#endif
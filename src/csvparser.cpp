@@ -1,7 +1,23 @@
 #include "csvparser.h"
 
+#include <QFile>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QTextCodec>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
 #include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CSV_PARSER_SSE2
+#endif
 
 CSVParser::CSVParser(bool trimfields, const QChar& fieldseparator, const QChar& quotechar)
     : m_bTrimFields(trimfields)
@@ -9,6 +25,7 @@ CSVParser::CSVParser(bool trimfields, const QChar& fieldseparator, const QChar&
     , m_cQuoteChar(quotechar)
     , m_pCSVProgress(0)
     , m_nBufferSize(4096)
+    , m_nChunkSize(4 * 1024 * 1024)
 {
 }
 
@@ -26,6 +43,86 @@ inline void addColumn(QStringList& r, QString& field, bool trim)
         r << field;
     field.clear();
 }
+
+inline bool isAsciiSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+#ifdef CSV_PARSER_SSE2
+inline int firstSetBit(unsigned int mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while(!(mask & 1))
+    {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+#endif
+
+// Returns a pointer to the first occurrence of any of the four characters or end if there is none. This compares 16 bytes at once if
+// SSE2 is available.
+const char* findAnyOf(const char* p, const char* end, char a, char b, char c, char d)
+{
+#ifdef CSV_PARSER_SSE2
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    const __m128i vd = _mm_set1_epi8(d);
+    while(end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(chunk, vc), _mm_cmpeq_epi8(chunk, vd)));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(match));
+        if(mask)
+            return p + firstSetBit(mask);
+        p += 16;
+    }
+#endif
+
+    for(;p<end;p++)
+    {
+        if(*p == a || *p == b || *p == c || *p == d)
+            return p;
+    }
+    return end;
+}
+
+const char* findChar(const char* p, const char* end, char c)
+{
+    const char* r = static_cast<const char*>(std::memchr(p, c, end - p));
+    return r ? r : end;
+}
+
+// Runs a function on a thread of a thread pool and releases the semaphore, if any, when it's done
+class FunctionTask : public QRunnable
+{
+public:
+    explicit FunctionTask(std::function<void()> function, QSemaphore* done = nullptr) : m_function(function), m_done(done) {}
+
+    virtual void run()
+    {
+        m_function();
+        if(m_done)
+            m_done->release();
+    }
+
+private:
+    std::function<void()> m_function;
+    QSemaphore* m_done;
+};
 }
 
 CSVParser::ParserResult CSVParser::parse(csvRowFunction insertFunction, QTextStream& stream, qint64 nMaxRecords)
@@ -188,3 +285,570 @@ CSVParser::ParserResult CSVParser::parse(csvRowFunction insertFunction, QTextStr
 
     return (state == StateNormal) ? ParserResult::ParserResultSuccess : ParserResult::ParserResultError;
 }
+
+bool CSVParser::isByteCompatible(QTextCodec* codec)
+{
+    // The file can only be processed byte by byte if the separator, quote and line break characters are stored as the same single bytes
+    // as in ASCII and if these bytes are never part of a multi-byte character. This is the case for UTF-8 and the common 8 bit encodings.
+    if(!codec)
+        return false;
+
+    int mib = codec->mibEnum();
+    return mib == 106                       // UTF-8
+            || mib == 3                     // US-ASCII
+            || (mib >= 4 && mib <= 13)      // ISO-8859-1 to ISO-8859-10
+            || (mib >= 109 && mib <= 112)   // ISO-8859-13 to ISO-8859-16
+            || (mib >= 2250 && mib <= 2258) // Windows-1250 to Windows-1258
+            || mib == 2084 || mib == 2088;  // KOI8-R, KOI8-U
+}
+
+size_t CSVParser::findChunkEnd(const char* data, size_t begin, size_t size, size_t target) const
+{
+    // Chunks must end at the end of a record. Starting at the beginning of a record, every quote character toggles between being inside
+    // and outside of a quoted field, and every line feed outside of a quoted field ends a record.
+    const char quote = m_cQuoteChar.toLatin1();
+    const char* p = data + begin;
+    const char* t = data + std::min(target, size);
+    const char* end = data + size;
+    bool inQuote = false;
+
+    // Up to the target position only the quotes are of interest
+    while(p < t)
+    {
+        const char* q = findChar(p, t, quote);
+        if(q == t)
+            break;
+        inQuote = !inQuote;
+        p = q + 1;
+    }
+    p = t;
+
+    // From there find the next line feed outside of a quoted field
+    while(p < end)
+    {
+        const char* n = findAnyOf(p, end, quote, '\n', '\n', '\n');
+        if(n == end)
+            break;
+        if(*n == quote)
+            inQuote = !inQuote;
+        else if(!inQuote)
+            return n - data + 1;
+        p = n + 1;
+    }
+
+    return size;
+}
+
+
+void CSVParser::finishField(Chunk& chunk, int fieldStart, QTextCodec* codec) const
+{
+    QByteArray& data = chunk.data;
+
+    if(codec)
+    {
+        // Values in other encodings than UTF-8 are converted here
+        QString value = codec->toUnicode(data.constData() + fieldStart, data.size() - fieldStart);
+        if(m_bTrimFields)
+            value = value.trimmed();
+        data.resize(fieldStart);
+        data.append(value.toUtf8());
+    } else if(m_bTrimFields) {
+        // ASCII whitespace is removed right here. Only if the remaining value starts or ends with a non-ASCII character it needs to be
+        // decoded for checking for other whitespace characters.
+        int first = fieldStart;
+        int last = data.size();
+        while(first < last && isAsciiSpace(data.at(first)))
+            first++;
+        while(last > first && isAsciiSpace(data.at(last - 1)))
+            last--;
+
+        if(first < last && (static_cast<unsigned char>(data.at(first)) >= 0x80 || static_cast<unsigned char>(data.at(last - 1)) >= 0x80))
+        {
+            QByteArray value = QString::fromUtf8(data.constData() + first, last - first).trimmed().toUtf8();
+            data.resize(fieldStart);
+            data.append(value);
+        } else {
+            data.resize(last);
+            if(first > fieldStart)
+                data.remove(fieldStart, first - fieldStart);
+        }
+    }
+
+    chunk.fieldEnds.push_back(data.size());
+}
+
+CSVParser::Chunk CSVParser::parseChunk(const char* data, size_t begin, size_t end, bool lastChunk, QTextCodec* codec) const
+{
+    // This is the same state machine as the one for parsing streams. It only differs in that it copies runs of ordinary characters
+    // at once instead of looking at each character separately, and that it stores the values of all fields in one buffer.
+    const char separator = m_cFieldSeparator.toLatin1();
+    const char quote = m_cQuoteChar.toLatin1();
+    const char* p = data + begin;
+    const char* e = data + end;
+
+    Chunk chunk;
+    chunk.end = end;
+    chunk.data.reserve(end - begin);
+    ParseStates state = StateNormal;
+    int fieldStart = 0;
+
+    auto addColumn = [&]() {
+        finishField(chunk, fieldStart, codec);
+        fieldStart = chunk.data.size();
+    };
+    auto addRow = [&]() {
+        addColumn();
+        chunk.rowEnds.push_back(chunk.fieldEnds.size());
+    };
+
+    while(p < e)
+    {
+        switch(state)
+        {
+        case StateNormal:
+        {
+            const char* next = findAnyOf(p, e, separator, quote, '\r', '\n');
+            chunk.data.append(p, next - p);
+            p = next;
+            if(p == e)
+                break;
+
+            char c = *p;
+            if(c == separator)
+            {
+                addColumn();
+            }
+            else if(c == quote)
+            {
+                state = StateInQuote;
+            }
+            else if(c == '\r')
+            {
+                // no linefeed, so assume that CR represents a newline
+                if(p + 1 != e && *(p + 1) != '\n')
+                    addRow();
+            }
+            else
+            {
+                addRow();
+            }
+            p++;
+        }
+        break;
+        case StateInQuote:
+        {
+            const char* next = findChar(p, e, quote);
+            chunk.data.append(p, next - p);
+            p = next;
+            if(p == e)
+                break;
+
+            state = StateEndQuote;
+            p++;
+        }
+        break;
+        case StateEndQuote:
+        {
+            char c = *p;
+            if(c == quote)
+            {
+                state = StateInQuote;
+                chunk.data.append(c);
+            }
+            else if(c == separator)
+            {
+                state = StateNormal;
+                addColumn();
+            }
+            else if(c == '\n')
+            {
+                state = StateNormal;
+                addRow();
+            }
+            else if(c == '\r')
+            {
+                // no linefeed, so assume that CR represents a newline
+                if(p + 1 != e && *(p + 1) != '\n')
+                    addRow();
+            }
+            else
+            {
+                state = StateNormal;
+                chunk.data.append(c);
+            }
+            p++;
+        }
+        break;
+        }
+    }
+
+    // Add the last row if it hasn't been terminated by a line break
+    int rowFields = chunk.fieldEnds.size() - (chunk.rowEnds.isEmpty() ? 0 : chunk.rowEnds.last());
+    if(lastChunk && rowFields > 0)
+        addRow();
+
+    chunk.state = state;
+    return chunk;
+}
+
+bool CSVParser::checkByteParsing(QFile& file, QTextCodec*& codec, size_t& begin) const
+{
+    if(!codec)
+        codec = QTextCodec::codecForLocale();
+
+    // Like QTextStream, use the encoding indicated by a byte order mark if there is one
+    QByteArray bom = file.peek(3);
+    begin = 0;
+    if(bom.startsWith("\xEF\xBB\xBF"))
+    {
+        codec = QTextCodec::codecForMib(106);
+        begin = 3;
+    }
+
+    return isByteCompatible(codec) && !bom.startsWith("\xFF\xFE") && !bom.startsWith("\xFE\xFF") &&
+            m_cFieldSeparator.unicode() < 0x80 && m_cQuoteChar.unicode() < 0x80;
+}
+
+CSVParser::ParserResult CSVParser::parse(csvRowFunction insertFunction, QFile& file, QTextCodec* codec, qint64 nMaxRecords)
+{
+    // Fall back to parsing the file as a stream if it can't be processed byte by byte
+    size_t begin;
+    if(!checkByteParsing(file, codec, begin))
+    {
+        QTextStream stream(&file);
+        stream.setCodec(codec);
+        return parse(insertFunction, stream, nMaxRecords);
+    }
+
+    QStringList row;
+    return parseFields([&insertFunction, &row](size_t rowNum, const Field* fields, size_t count) -> bool {
+        row.clear();
+        for(size_t i=0;i<count;i++)
+            row << QString::fromUtf8(fields[i].data, fields[i].size);
+        return insertFunction(rowNum, row);
+    }, file, codec, nMaxRecords);
+}
+
+CSVParser::ParserResult CSVParser::parseFields(csvFieldRowFunction insertFunction, QFile& file, QTextCodec* codec, qint64 nMaxRecords)
+{
+    size_t begin;
+    if(!checkByteParsing(file, codec, begin))
+    {
+        // Parse the file as a stream and convert the values to UTF-8
+        QByteArray buffer;
+        QVector<int> ends;
+        QVector<Field> fields;
+        QTextStream stream(&file);
+        stream.setCodec(codec);
+        return parse([&](size_t rowNum, const QStringList& data) -> bool {
+            buffer.resize(0);
+            ends.resize(0);
+            foreach(const QString& value, data)
+            {
+                buffer.append(value.toUtf8());
+                ends.push_back(buffer.size());
+            }
+
+            fields.resize(0);
+            for(int i=0;i<ends.size();i++)
+            {
+                Field f;
+                f.data = buffer.constData() + (i ? ends.at(i - 1) : 0);
+                f.size = ends.at(i) - (i ? ends.at(i - 1) : 0);
+                fields.push_back(f);
+            }
+
+            return insertFunction(rowNum, fields.constData(), fields.size());
+        }, stream, nMaxRecords);
+    }
+
+    // Map the file into memory. If this isn't possible, read it instead
+    size_t size = file.size();
+    uchar* mapped = size ? file.map(0, size) : nullptr;
+    QByteArray buffer;
+    const char* data;
+    if(mapped)
+    {
+        data = reinterpret_cast<const char*>(mapped);
+    } else {
+        file.seek(0);
+        buffer = file.readAll();
+        data = buffer.constData();
+        size = buffer.size();
+    }
+
+    // UTF-8 values can be used as they are, all others are converted
+    QTextCodec* fieldCodec = (codec->mibEnum() == 106) ? nullptr : codec;
+
+    m_iParsedRows = 0;
+
+    if(m_pCSVProgress)
+        m_pCSVProgress->start();
+
+    // Split the file into chunks which are parsed in parallel. The rows of each chunk are inserted in the order of the chunks as soon as
+    // they are ready. When only reading the first couple of records just parse small chunks one after the other when they are needed.
+    bool limited = nMaxRecords != -1;
+    size_t chunkSize = limited ? 64 * 1024 : m_nChunkSize;
+    size_t maxPending = limited ? 1 : std::max(1, QThread::idealThreadCount()) * 2;
+
+    // The chunks are parsed by the threads of a pool which are reused for all chunks instead of starting a thread for each of them
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+
+    struct PendingChunk
+    {
+        PendingChunk() : queued(false) {}
+
+        Chunk chunk;
+        bool queued;
+        QSemaphore done;
+    };
+
+    ParserResult result = ParserResult::ParserResultSuccess;
+    ParseStates state = StateNormal;
+    bool stop = false;
+    std::deque<std::unique_ptr<PendingChunk>> pending;
+    QVector<Field> fields;
+    size_t pos = begin;
+    while(!stop && (pos < size || !pending.empty()))
+    {
+        while(pos < size && pending.size() < maxPending)
+        {
+            size_t end = findChunkEnd(data, pos, size, pos + chunkSize);
+            bool last = end >= size;
+
+            std::unique_ptr<PendingChunk> p(new PendingChunk);
+            PendingChunk* target = p.get();
+            auto job = [this, target, data, pos, end, last, fieldCodec]() {
+                target->chunk = parseChunk(data, pos, end, last, fieldCodec);
+            };
+            if(limited)
+            {
+                job();
+            } else {
+                target->queued = true;
+                pool.start(new FunctionTask(job, &target->done));
+            }
+
+            pending.push_back(std::move(p));
+            pos = end;
+        }
+
+        std::unique_ptr<PendingChunk> current = std::move(pending.front());
+        pending.pop_front();
+        if(current->queued)
+            current->done.acquire();
+        const Chunk& chunk = current->chunk;
+        state = chunk.state;
+
+        // Hand out the fields of each row as views into the buffer of the chunk
+        int field = 0;
+        for(int row=0;row<chunk.rowEnds.size();row++)
+        {
+            fields.resize(0);
+            for(;field<chunk.rowEnds.at(row);field++)
+            {
+                int start = field ? chunk.fieldEnds.at(field - 1) : 0;
+                Field f;
+                f.data = chunk.data.constData() + start;
+                f.size = chunk.fieldEnds.at(field) - start;
+                fields.push_back(f);
+            }
+
+            if(!insertFunction(m_iParsedRows, fields.constData(), fields.size()))
+            {
+                result = ParserResult::ParserResultError;
+                stop = true;
+                break;
+            }
+            m_iParsedRows++;
+
+            if(limited && m_iParsedRows >= nMaxRecords)
+            {
+                stop = true;
+                break;
+            }
+        }
+
+        if(!stop && m_pCSVProgress && !m_pCSVProgress->update(chunk.end))
+        {
+            result = ParserResult::ParserResultCancelled;
+            stop = true;
+        }
+    }
+
+    // Wait for the chunks which are still being parsed before unmapping the file
+    pool.waitForDone();
+    pending.clear();
+    if(mapped)
+        file.unmap(mapped);
+
+    if(stop)
+        return result;
+
+    if(m_pCSVProgress)
+        m_pCSVProgress->end();
+
+    return (state == StateNormal) ? ParserResult::ParserResultSuccess : ParserResult::ParserResultError;
+}
+
+bool CSVParser::toInteger(const char* data, int size, qint64& value)
+{
+    const char* p = data;
+    const char* end = data + size;
+    bool negative = p < end && *p == '-';
+    if(negative)
+        p++;
+    if(p == end)
+        return false;
+
+    quint64 v = 0;
+    const quint64 limit = negative ? static_cast<quint64>(std::numeric_limits<qint64>::max()) + 1 : std::numeric_limits<qint64>::max();
+    for(;p<end;p++)
+    {
+        if(!isDigit(*p))
+            return false;
+        unsigned int digit = *p - '0';
+        if(v > (limit - digit) / 10)
+            return false;
+        v = v * 10 + digit;
+    }
+
+    value = negative ? -static_cast<qint64>(v - 1) - 1 : static_cast<qint64>(v);
+    return true;
+}
+
+CSVParser::FieldType CSVParser::fieldType(const char* data, int size)
+{
+    if(size == 0)
+        return FieldTypeEmpty;
+    if(std::memchr(data, 0, size))
+        return FieldTypeBlob;
+
+    // Plus signs, leading zeros and other decorations would get lost when storing the value as a number, so these values are text
+    const char* end = data + size;
+    const char* p = (*data == '-') ? data + 1 : data;
+    if(p == end || !isDigit(*p) || (*p == '0' && p + 1 < end && isDigit(p[1])))
+        return FieldTypeText;
+
+    // Negative zero would be stored as zero
+    qint64 integer;
+    if(toInteger(data, size, integer))
+        return (integer == 0 && *data == '-') ? FieldTypeText : FieldTypeInteger;
+
+    // Real numbers are only numeric if SQLite writes them back the same way. So exponents, trailing zeros in the fraction and more
+    // significant digits than a double can hold make them text. Integers which are too large for 64 bits are text as well because
+    // storing them as floating point numbers would lose precision.
+    const char* digits = p;
+    while(p < end && isDigit(*p))
+        p++;
+    if(p == end || *p != '.')
+        return FieldTypeText;
+    const char* fraction = ++p;
+    while(p < end && isDigit(*p))
+        p++;
+    if(p != end || p == fraction || p[-1] == '0')
+        return FieldTypeText;
+
+    // SQLite switches to the exponent notation for numbers below 0.0001
+    int significant = 0;
+    int leadingZeros = 0;
+    for(const char* c=digits;c<end;c++)
+    {
+        if(*c == '.')
+            continue;
+        if(*c == '0' && !significant)
+            leadingZeros++;
+        else
+            significant++;
+    }
+    return (significant <= 15 && leadingZeros <= 4) ? FieldTypeReal : FieldTypeText;
+}
+
+QVector<CSVParser::FieldType> CSVParser::inferTypes(QFile& file, QTextCodec* codec, bool skipFirstRow, qint64 nHeadRecords, int nSamples)
+{
+    QVector<FieldType> types;
+    auto addRow = [&types](const Field* fields, int count) {
+        for(int i=0;i<count && i<types.size();i++)
+            types[i] = std::max(types.at(i), fieldType(fields[i].data, fields[i].size));
+    };
+
+    // Analyse the first records. They also determine the number of columns.
+    size_t begin;
+    bool byteParsing = checkByteParsing(file, codec, begin);
+    CSVProgress* progress = m_pCSVProgress;
+    m_pCSVProgress = nullptr;
+    parseFields([&](size_t rowNum, const Field* fields, size_t count) -> bool {
+        if(types.size() < static_cast<int>(count))
+            types.resize(count);
+        if(rowNum > 0 || !skipFirstRow)
+            addRow(fields, count);
+        return true;
+    }, file, codec, nHeadRecords);
+    m_pCSVProgress = progress;
+
+    // Then look at blocks of records at random positions in the rest of the file. They are parsed in parallel. Because the parser can't
+    // know whether a random position is inside a quoted field, each block starts at the next line break, and rows which don't have the
+    // expected number of fields are ignored.
+    if(types.isEmpty() || nSamples <= 0 || !byteParsing)
+        return types;
+
+    size_t size = file.size();
+    uchar* mapped = size > begin ? file.map(0, size) : nullptr;
+    if(!mapped)
+        return types;
+    const char* data = reinterpret_cast<const char*>(mapped);
+    QTextCodec* fieldCodec = (codec->mibEnum() == 106) ? nullptr : codec;
+
+    // Use the same positions each time the same file is analysed
+    std::mt19937 random(static_cast<unsigned int>(size));
+    const size_t sampleSize = 16 * 1024;
+    const size_t partSize = (size - begin) / nSamples;
+    std::vector<Chunk> samples(nSamples);
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+    for(int i=0;i<nSamples;i++)
+    {
+        size_t offset = begin + i * partSize;
+        if(partSize)
+            offset += std::uniform_int_distribution<size_t>(0, partSize - 1)(random);
+        const char* lineBreak = findChar(data + offset, data + size, '\n');
+        size_t start = lineBreak - data + 1;
+        if(start >= size)
+            continue;
+        size_t end = findChunkEnd(data, start, size, start + sampleSize);
+
+        Chunk* target = &samples[i];
+        pool.start(new FunctionTask([this, target, data, start, end, size, fieldCodec]() {
+            *target = parseChunk(data, start, end, end >= size, fieldCodec);
+        }));
+    }
+    pool.waitForDone();
+    file.unmap(mapped);
+
+    QVector<Field> fields;
+    for(auto it=samples.cbegin();it!=samples.cend();++it)
+    {
+        const Chunk& chunk = *it;
+        for(int row=0;row<chunk.rowEnds.size();row++)
+        {
+            int first = row ? chunk.rowEnds.at(row - 1) : 0;
+            int count = chunk.rowEnds.at(row) - first;
+            if(count != types.size())
+                continue;
+
+            fields.resize(0);
+            for(int field=first;field<first+count;field++)
+            {
+                int fieldStart = field ? chunk.fieldEnds.at(field - 1) : 0;
+                Field f;
+                f.data = chunk.data.constData() + fieldStart;
+                f.size = chunk.fieldEnds.at(field) - fieldStart;
+                fields.push_back(f);
+            }
+            addRow(fields.constData(), count);
+        }
+    }
+
+    return types;
+}
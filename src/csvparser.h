@@ -3,8 +3,11 @@
 
 #include <QChar>
 #include <QStringList>
+#include <QVector>
 #include <functional>
 
+class QFile;
+class QTextCodec;
 class QTextStream;
 
 /*!
@@ -27,6 +30,26 @@ class CSVParser
 public:
     typedef std::function<bool(size_t, QStringList)> csvRowFunction;
 
+    // The value of a field as UTF-8 encoded text. This points into an internal buffer of the parser, so it is only valid until the
+    // function it has been passed to returns.
+    struct Field
+    {
+        const char* data;
+        int size;
+    };
+    typedef std::function<bool(size_t, const Field*, size_t)> csvFieldRowFunction;
+
+    // The kind of data in a field or column. The types are ordered from the most specific to the most general one, so the type of a
+    // column is the greatest type of all its values.
+    enum FieldType
+    {
+        FieldTypeEmpty,
+        FieldTypeInteger,
+        FieldTypeReal,
+        FieldTypeText,
+        FieldTypeBlob
+    };
+
     CSVParser(bool trimfields = true, const QChar& fieldseparator = ',', const QChar& quotechar = '"');
     ~CSVParser();
 
@@ -47,6 +70,45 @@ public:
      */
     ParserResult parse(csvRowFunction insertFunction, QTextStream& stream, qint64 nMaxRecords = -1);
 
+    /*!
+     * \brief parse the given file. This is a lot faster than parsing a stream: the file is memory mapped and split into parts which are
+     * parsed on several threads. The rows are still passed to the insert function one after the other and in the order of the file.
+     * If the encoding or the separator and quote characters don't allow the file to be processed byte by byte, this falls back to
+     * parsing it as a stream.
+     * @param insertFunction See above
+     * \param file The file to parse. It must be opened for reading.
+     * \param codec Encoding of the file or nullptr to use the default encoding of the system
+     * \param nMaxRecords Max records too read, -1 if unlimited
+     * \return ParserResult value that indicated whether action finished normally, was cancelled or errored.
+     */
+    ParserResult parse(csvRowFunction insertFunction, QFile& file, QTextCodec* codec, qint64 nMaxRecords = -1);
+
+    /*!
+     * \brief parseFields works like parse() but doesn't create a QStringList for each row. Instead the insert function gets the row
+     * number, a pointer to the first of the fields of the row and the number of fields. No memory is allocated for the fields if the
+     * file is UTF-8 encoded and doesn't need to be parsed as a stream.
+     */
+    ParserResult parseFields(csvFieldRowFunction insertFunction, QFile& file, QTextCodec* codec, qint64 nMaxRecords = -1);
+
+    /*!
+     * \brief inferTypes guesses the data types of the columns of a file. Instead of looking at the entire file, the first records are
+     * analysed as well as a couple of blocks of records spread over the rest of the file. These samples are parsed in parallel.
+     * \param file The file to analyse. It must be opened for reading.
+     * \param codec Encoding of the file or nullptr to use the default encoding of the system
+     * \param skipFirstRow true if the first row contains the column names
+     * \param nHeadRecords Number of records at the start of the file to analyse
+     * \param nSamples Number of blocks of records to analyse in the rest of the file
+     * \return The type of each column. Columns which are empty in all analysed records are FieldTypeEmpty.
+     */
+    QVector<FieldType> inferTypes(QFile& file, QTextCodec* codec, bool skipFirstRow, qint64 nHeadRecords = 1000, int nSamples = 32);
+
+    //! Returns the type of a single value. Only values which SQLite writes back with the same spelling when storing them as numbers are
+    //! considered numeric.
+    static FieldType fieldType(const char* data, int size);
+
+    //! Converts a value of type FieldTypeInteger to a number. Returns false if the value doesn't fit into 64 bits.
+    static bool toInteger(const char* data, int size, qint64& value);
+
     void setCSVProgress(CSVProgress* csvp) { m_pCSVProgress = csvp; }
 
 private:
@@ -57,6 +119,24 @@ private:
         StateEndQuote
     };
 
+    // The rows of a part of a memory mapped file
+    struct Chunk
+    {
+        Chunk() : state(StateNormal), end(0) {}
+
+        QByteArray data;        // UTF-8 encoded values of all fields, back to back
+        QVector<int> fieldEnds; // Position in data behind the last byte of each field
+        QVector<int> rowEnds;   // Number of fields up to and including each row
+        ParseStates state;      // Parser state at the end of the chunk
+        size_t end;             // Position of the end of the chunk in the file
+    };
+
+    static bool isByteCompatible(QTextCodec* codec);
+    bool checkByteParsing(QFile& file, QTextCodec*& codec, size_t& begin) const;
+    Chunk parseChunk(const char* data, size_t begin, size_t end, bool lastChunk, QTextCodec* codec) const;
+    void finishField(Chunk& chunk, int fieldStart, QTextCodec* codec) const;
+    size_t findChunkEnd(const char* data, size_t begin, size_t size, size_t target) const;
+
     inline bool addRow(QStringList& r)
     {
         if(!m_insertFunction(m_iParsedRows, r))
@@ -77,6 +157,7 @@ private:
     qint64 m_iParsedRows;   // Number of rows parsed so far
 
     size_t m_nBufferSize; //! internal buffer read size
+    size_t m_nChunkSize;  //! size of the parts a memory mapped file is split into
 };
 
 #endif
@@ -1,8 +1,9 @@
 #include "sqlitedb.h"
 #include "sqlite.h"
-#include "sqlitetablemodel.h"
 #include "CipherDialog.h"
 #include "Settings.h"
+#include "TableDumper.h"
+#include "SchemaParser.h"
 
 #include <QFile>
 #include <QMessageBox>
@@ -13,6 +14,9 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QThread>
+#include <algorithm>
+#include <limits>
 
 // collation callbacks
 int collCompare(void* /*pArg*/, int /*eTextRepA*/, const void* sA, int /*eTextRepB*/, const void* sB)
@@ -54,6 +58,12 @@ void collation_needed(void* /*pData*/, sqlite3* db, int eTextRep, const char* sC
         sqlite3_create_collation(db, sCollationName, eTextRep, NULL, collCompare);
 }
 
+static void collation_needed_readonly(void* /*pData*/, sqlite3* db, int eTextRep, const char* sCollationName)
+{
+    // Read-only connections can't do any harm to the database, so don't bother the user and use the fallback collation right away
+    sqlite3_create_collation(db, sCollationName, eTextRep, NULL, collCompare);
+}
+
 
 static void regexp(sqlite3_context* ctx, int /*argc*/, sqlite3_value* argv[])
 {
@@ -74,6 +84,30 @@ static void regexp(sqlite3_context* ctx, int /*argc*/, sqlite3_value* argv[])
     sqlite3_result_int(ctx, arg1.indexIn(arg2) >= 0);
 }
 
+static bool setupReadConnection(sqlite3* db, bool regex, const QStringList& extensions, QueryProfiler* profiler)
+{
+    sqlite3_create_collation(db, "UTF16", SQLITE_UTF16, 0, sqlite_compare_utf16);
+    sqlite3_create_collation(db, "UTF16CI", SQLITE_UTF16, 0, sqlite_compare_utf16ci);
+    sqlite3_collation_needed(db, NULL, collation_needed_readonly);
+
+    if(regex)
+        sqlite3_create_function(db, "REGEXP", 2, SQLITE_UTF8, NULL, regexp, NULL, NULL);
+
+    // Load the same extensions as for the main connection because queries might use the functions they provide
+    if(!extensions.isEmpty())
+    {
+        sqlite3_enable_load_extension(db, 1);
+        for(const QString& extension : extensions)
+        {
+            if(sqlite3_load_extension(db, extension.toUtf8(), 0, NULL) != SQLITE_OK)
+                return false;
+        }
+    }
+
+    profiler->attach(db);
+    return true;
+}
+
 bool DBBrowserDB::isOpen ( ) const
 {
     return _db!=0;
@@ -81,10 +115,10 @@ bool DBBrowserDB::isOpen ( ) const
 
 bool DBBrowserDB::getDirty() const
 {
-    return !savepointList.empty();
+    return !savepointList.empty() || memoryModified;
 }
 
-bool DBBrowserDB::open(const QString& db, bool readOnly)
+bool DBBrowserDB::open(const QString& db, bool readOnly, bool inMemory)
 {
     if (isOpen()) close();
 
@@ -96,8 +130,8 @@ bool DBBrowserDB::open(const QString& db, bool readOnly)
     if(tryEncryptionSettings(db, &isEncrypted, cipher) == false)
         return false;
 
-    // Open database file
-    if(sqlite3_open_v2(db.toUtf8(), &_db, readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+    // Open database file. Use the serialized threading mode because the rows of a table are fetched in a background thread.
+    if(sqlite3_open_v2(db.toUtf8(), &_db, (readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE) | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK)
     {
         lastErrorMessage = QString::fromUtf8((const char*)sqlite3_errmsg(_db));
         return false;
@@ -114,6 +148,35 @@ bool DBBrowserDB::open(const QString& db, bool readOnly)
 #endif
     delete cipher;
 
+    // Load the database into memory if requested and continue working on the in-memory copy from here on. Encrypted databases would
+    // be decrypted in memory, and the backup API can't write them back encrypted, so they are always opened as they are.
+    if(_db && inMemory && !isEncrypted)
+    {
+        sqlite3* memory;
+        if(sqlite3_open_v2(":memory:", &memory, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK)
+        {
+            lastErrorMessage = QString::fromUtf8(sqlite3_errmsg(memory));
+            sqlite3_close(memory);
+            sqlite3_close(_db);
+            _db = 0;
+            return false;
+        }
+
+        bool loaded = copyDatabase(_db, memory, tr("Loading database into memory..."));
+        sqlite3_close(_db);
+        if(!loaded)
+        {
+            if(lastErrorMessage.isEmpty())
+                lastErrorMessage = tr("Loading the database has been cancelled.");
+            sqlite3_close(memory);
+            _db = 0;
+            return false;
+        }
+
+        _db = memory;
+        isInMemory = true;
+    }
+
     if (_db)
     {
         // add UTF16 collation (comparison is performed by QString functions)
@@ -150,6 +213,8 @@ bool DBBrowserDB::open(const QString& db, bool readOnly)
 
         curDBFilename = db;
 
+        queryProfiler.attach(_db);
+        openReadConnections();
         updateSchema();
 
         return true;
@@ -310,6 +375,11 @@ bool DBBrowserDB::releaseSavepoint(const QString& pointname)
     // so we should too
     int point_index = savepointList.lastIndexOf(pointname);
     savepointList.erase(savepointList.begin()+point_index, savepointList.end());
+
+    // Releasing the outermost savepoint commits the changes. For an in-memory copy of the file they still need to be written to the file.
+    if(isInMemory && savepointList.isEmpty())
+        memoryModified = true;
+
     emit dbChanged(getDirty());
 
     return true;
@@ -320,6 +390,9 @@ bool DBBrowserDB::revertToSavepoint(const QString& pointname)
     if(!isOpen() || savepointList.contains(pointname) == false)
         return false;
 
+    // Rolling back resets the schema versions. Make sure the schema is loaded again, even if the versions happen to be the same as before.
+    schemaVersions.clear();
+
     QString query = QString("ROLLBACK TO SAVEPOINT %1;").arg(sqlb::escapeIdentifier(pointname));
     executeSQL(query, false, false);
     query = QString("RELEASE %1;").arg(sqlb::escapeIdentifier(pointname));
@@ -349,6 +422,19 @@ bool DBBrowserDB::releaseAllSavepoints()
     return true;
 }
 
+bool DBBrowserDB::saveChanges()
+{
+    if(!releaseAllSavepoints())
+        return false;
+
+    // When working on an in-memory copy of the database file, saving means writing the copy back to the file. Only do this when the
+    // user asks for it, other commits just leave the changes in memory.
+    if(memoryModified && !isReadOnly)
+        return writeMemoryToFile();
+
+    return true;
+}
+
 bool DBBrowserDB::revertAll()
 {
     foreach(const QString& point, savepointList)
@@ -356,6 +442,55 @@ bool DBBrowserDB::revertAll()
         if(!revertToSavepoint(point))
             return false;
     }
+
+    // Changes which have been committed to an in-memory copy of the file are undone by loading the file again
+    if(memoryModified)
+    {
+        sqlite3* file;
+        if(sqlite3_open_v2(curDBFilename.toUtf8(), &file, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+        {
+            lastErrorMessage = QString::fromUtf8(sqlite3_errmsg(file));
+            sqlite3_close(file);
+            return false;
+        }
+
+        statementCache.clear();
+        bool loaded = copyDatabase(file, _db, tr("Loading database into memory..."));
+        sqlite3_close(file);
+        if(!loaded)
+            return false;
+
+        memoryModified = false;
+        schemaVersions.clear();
+        updateSchema();
+        emit dbChanged(getDirty());
+    }
+
+    return true;
+}
+
+bool DBBrowserDB::writeMemoryToFile()
+{
+    sqlite3* file;
+    if(sqlite3_open_v2(curDBFilename.toUtf8(), &file, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+    {
+        lastErrorMessage = QString::fromUtf8(sqlite3_errmsg(file));
+        sqlite3_close(file);
+        return false;
+    }
+
+    // The backup replaces the content of the file in one transaction, so the file stays intact if this fails or is cancelled
+    bool written = copyDatabase(_db, file, tr("Writing database to %1...").arg(QFileInfo(curDBFilename).fileName()));
+    sqlite3_close(file);
+    if(!written)
+    {
+        if(lastErrorMessage.isEmpty())
+            lastErrorMessage = tr("Writing the database file has been cancelled.");
+        return false;
+    }
+
+    memoryModified = false;
+    emit dbChanged(getDirty());
     return true;
 }
 
@@ -410,6 +545,10 @@ bool DBBrowserDB::create ( const QString & db)
         curDBFilename = db;
         isEncrypted = false;
         isReadOnly = false;
+        isInMemory = false;
+        memoryModified = false;
+        queryProfiler.attach(_db);
+        openReadConnections();
         updateSchema();
         return true;
     } else {
@@ -436,14 +575,30 @@ bool DBBrowserDB::close()
 
             // If he didn't it was either yes or no
             if(reply == QMessageBox::Save)
-                releaseAllSavepoints();
-            else
+            {
+                saveChanges();
+            } else {
+                memoryModified = false;     // No need to load an in-memory copy again just to close it
                 revertAll(); //not really necessary, I think... but will not hurt.
+            }
         }
+
+        // Give everybody who is still reading from the database in the background a chance to stop doing so
+        emit aboutToClose();
+
+        statementCache.clear();
+        readConnections.close();
+        queryProfiler.detach(_db);
         sqlite3_close(_db);
     }
     _db = 0;
+    isInMemory = false;
+    memoryModified = false;
+    isWal = false;
+    loadedExtensions.clear();
     schemata.clear();
+    schemaVersions.clear();
+    parsedObjects.clear();
     savepointList.clear();
     emit dbChanged(getDirty());
     emit structureUpdated();
@@ -466,7 +621,6 @@ bool DBBrowserDB::dump(const QString& filename,
     {
         QApplication::setOverrideCursor(Qt::WaitCursor);
 
-        size_t numRecordsTotal = 0, numRecordsCurrent = 0;
         objectMap objMap = schemata["main"];            // We only always export the main database, not the attached databases
         QList<sqlb::ObjectPtr> tables = objMap.values("table");
         QMutableListIterator<sqlb::ObjectPtr> it(tables);
@@ -476,29 +630,72 @@ bool DBBrowserDB::dump(const QString& filename,
 
             // Remove the sqlite_stat1 table if there is one
             if(it.value()->name() == "sqlite_stat1" || it.value()->name() == "sqlite_sequence")
-            {
                 it.remove();
-            } else {
-                // Otherwise get the number of records in this table
-                SqliteTableModel tableModel(*this);
-                tableModel.setTable(sqlb::ObjectIdentifier("main", it.value()->name()));
-                numRecordsTotal += tableModel.totalRowCount();
+        }
+
+        // The data of the tables is read and formatted in the background, several tables at once if possible. Separate connections can
+        // only be used if they see exactly the same data as this one, i.e. if there are no uncommitted changes.
+        QVector<TableDumper::Table> dumpTables;
+        if(exportData)
+        {
+            for(auto it=tables.constBegin();it!=tables.constEnd();++it)
+            {
+                if(tablesToDump.contains((*it)->name()))
+                {
+                    TableDumper::Table table;
+                    table.name = (*it)->name();
+                    table.columns = (*it).dynamicCast<sqlb::Table>()->fieldNames();
+                    dumpTables.push_back(table);
+                }
+            }
+        }
+        // The connections of the pool are set up just like the main connection, so they have the same extensions and collations. In WAL
+        // mode separate connections might see different snapshots of the database, so only one of them is used there.
+        TableDumper dumper(dumpTables, insertColNames, insertNewSyntx);
+        QVector<ConnectionPool::Handle> connections;
+        if(!getDirty() && readConnections.isOpen())
+        {
+            int threads = isWal ? 1 : QThread::idealThreadCount();
+            for(int i=0;i<threads;i++)
+            {
+                ConnectionPool::Handle connection = readConnections.acquire();
+                if(!connection.isValid())
+                    break;
+                connections.push_back(connection);
             }
         }
+        dumper.start(_db, connections);
 
+        // Instead of counting the rows of all tables first, the progress is measured in pages read. The number of pages in the database
+        // file is an upper bound for this because the indices aren't read.
+        qint64 numPagesTotal = exportData ? getPragma("page_count").toLongLong() : 0;
+        int progressMax = static_cast<int>(std::min<qint64>(numPagesTotal, std::numeric_limits<int>::max()));
         QProgressDialog progress(tr("Exporting database to SQL file..."),
-                                 tr("Cancel"), 0, numRecordsTotal);
+                                 tr("Cancel"), 0, progressMax);
         progress.setWindowModality(Qt::ApplicationModal);
         progress.show();
         qApp->processEvents();
 
-        // Open text stream to the file
-        QTextStream stream(&file);
+        // Everything is written as UTF-8
+        bool writeFailed = false;
+        auto write = [&file, &writeFailed](const QByteArray& data) {
+            if(!writeFailed && file.write(data) != data.size())
+                writeFailed = true;
+        };
+        auto abort = [&](const QString& error) -> bool {
+            dumper.cancel();
+            file.close();
+            file.remove();
+            lastErrorMessage = error;
+            QApplication::restoreOverrideCursor();
+            return false;
+        };
 
         // Put the SQL commands in a transaction block
-        stream << "BEGIN TRANSACTION;\n";
+        write("BEGIN TRANSACTION;\n");
 
         // Loop through all tables first as they are required to generate views, indices etc. later
+        int dumpIndex = 0;
         for(auto it=tables.constBegin();it!=tables.constEnd();++it)
         {
             if (tablesToDump.indexOf((*it)->name()) == -1)
@@ -508,102 +705,37 @@ bool DBBrowserDB::dump(const QString& filename,
             if(exportSchema)
             {
                 if(!keepOldSchema)
-                    stream << QString("DROP TABLE IF EXISTS %1;\n").arg(sqlb::escapeIdentifier((*it)->name()));
+                    write(QString("DROP TABLE IF EXISTS %1;\n").arg(sqlb::escapeIdentifier((*it)->name())).toUtf8());
 
                 if((*it)->fullyParsed())
-                    stream << (*it)->sql("main", true) << "\n";
+                    write(((*it)->sql("main", true) + "\n").toUtf8());
                 else
-                    stream << (*it)->originalSql() << ";\n";
+                    write(((*it)->originalSql() + ";\n").toUtf8());
             }
 
             // If the user doesn't want the data to be exported skip the rest of the loop block here
             if(!exportData)
                 continue;
 
-            // get columns
-            QStringList cols((*it).dynamicCast<sqlb::Table>()->fieldNames());
-
-            QString sQuery = QString("SELECT * FROM %1;").arg(sqlb::escapeIdentifier((*it)->name()));
-            QByteArray utf8Query = sQuery.toUtf8();
-            sqlite3_stmt *stmt;
-            QString lineSep(QString(")%1\n").arg(insertNewSyntx?',':';'));
-
-            int status = sqlite3_prepare_v2(this->_db, utf8Query.data(), utf8Query.size(), &stmt, NULL);
-            if(SQLITE_OK == status)
+            // Write the INSERT statements of this table as soon as they are ready
+            QByteArray block;
+            TableDumper::BlockResult result;
+            while((result = dumper.nextBlock(dumpIndex, block, 100)) != TableDumper::TableFinished)
             {
-                int columns = sqlite3_column_count(stmt);
-                size_t counter = 0;
-                qApp->processEvents();
-                while(sqlite3_step(stmt) == SQLITE_ROW)
-                {
-                    if (counter) stream << lineSep;
+                if(result == TableDumper::DumpFailed)
+                    return abort(dumper.errorMessage());
+                else if(result == TableDumper::BlockReady)
+                    write(block);
 
-                    if (!insertNewSyntx || !counter)
-                    {
-                        stream << "INSERT INTO " << sqlb::escapeIdentifier((*it)->name());
-                        if (insertColNames)
-                            stream << " (" << cols.join(",") << ")";
-                        stream << " VALUES (";
-                    }
-                    else
-                    {
-                        stream << " (";
-                    }
-
-                    for (int i = 0; i < columns; ++i)
-                    {
-                        int fieldsize = sqlite3_column_bytes(stmt, i);
-                        int fieldtype = sqlite3_column_type(stmt, i);
-                        QByteArray bcontent(
-                                    (const char*)sqlite3_column_blob(stmt, i),
-                                    fieldsize);
-
-                        if(bcontent.left(2048).contains('\0')) // binary check
-                        {
-                            stream << QString("X'%1'").arg(QString(bcontent.toHex()));
-                        }
-                        else
-                        {
-                            switch(fieldtype)
-                            {
-                            case SQLITE_TEXT:
-                            case SQLITE_BLOB:
-                                stream << "'" << bcontent.replace("'", "''") << "'";
-                            break;
-                            case SQLITE_NULL:
-                                stream << "NULL";
-                            break;
-                            case SQLITE_FLOAT:
-                                if(bcontent.indexOf("Inf") != -1)
-                                    stream << "'" << bcontent << "'";
-                                else
-                                    stream << bcontent;
-                            break;
-                            default:
-                                stream << bcontent;
-                            }
-                        }
-                        if(i != columns - 1)
-                            stream << ',';
-                    }
-
-                    progress.setValue(++numRecordsCurrent);
-                    if(counter % 5000 == 0)
-                        qApp->processEvents();
-                    counter++;
+                progress.setValue(static_cast<int>(std::min<qint64>(dumper.pagesRead(), progressMax)));
+                qApp->processEvents();
 
-                    if(progress.wasCanceled())
-                    {
-                        sqlite3_finalize(stmt);
-                        file.close();
-                        file.remove();
-                        QApplication::restoreOverrideCursor();
-                        return false;
-                    }
-                }
-                if (counter > 0) stream << ");\n";
+                if(progress.wasCanceled())
+                    return abort(QString());
+                if(writeFailed)
+                    return abort(file.errorString());
             }
-            sqlite3_finalize(stmt);
+            dumpIndex++;
         }
 
         // Now dump all the other objects (but only if we are exporting the schema)
@@ -624,20 +756,22 @@ bool DBBrowserDB::dump(const QString& filename,
                 if(!(*it)->originalSql().isEmpty())
                 {
                     if(!keepOldSchema)
-                        stream << QString("DROP %1 IF EXISTS %2;\n")
-                                  .arg(sqlb::Object::typeToString((*it)->type()).toUpper())
-                                  .arg(sqlb::escapeIdentifier((*it)->name()));
+                        write(QString("DROP %1 IF EXISTS %2;\n")
+                              .arg(sqlb::Object::typeToString((*it)->type()).toUpper())
+                              .arg(sqlb::escapeIdentifier((*it)->name())).toUtf8());
 
                     if((*it)->fullyParsed())
-                        stream << (*it)->sql("main", true) << "\n";
+                        write(((*it)->sql("main", true) + "\n").toUtf8());
                     else
-                        stream << (*it)->originalSql() << ";\n";
+                        write(((*it)->originalSql() + ";\n").toUtf8());
                 }
             }
         }
 
         // Done
-        stream << "COMMIT;\n";
+        write("COMMIT;\n");
+        if(writeFailed)
+            return abort(file.errorString());
         file.close();
 
         QApplication::restoreOverrideCursor();
@@ -647,6 +781,98 @@ bool DBBrowserDB::dump(const QString& filename,
     return false;
 }
 
+bool DBBrowserDB::saveCopyAs(const QString& filename)
+{
+    if(!isOpen())
+        return false;
+
+    // The online backup only copies committed data
+    if(getDirty())
+    {
+        lastErrorMessage = tr("There are pending changes. Write or revert them before copying the database.");
+        return false;
+    }
+
+    if(QFileInfo(filename) == QFileInfo(curDBFilename))
+    {
+        lastErrorMessage = tr("The database can't be copied onto itself.");
+        return false;
+    }
+
+    // Start with an empty file because the backup can't overwrite files which aren't valid databases
+    if(QFile::exists(filename) && !QFile::remove(filename))
+    {
+        lastErrorMessage = tr("Couldn't remove the file %1.").arg(filename);
+        return false;
+    }
+
+    sqlite3* destination;
+    if(sqlite3_open_v2(filename.toUtf8(), &destination, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK)
+    {
+        lastErrorMessage = QString::fromUtf8(sqlite3_errmsg(destination));
+        sqlite3_close(destination);
+        return false;
+    }
+
+    bool ok = copyDatabase(_db, destination, tr("Copying database to %1...").arg(QFileInfo(filename).fileName()));
+    sqlite3_close(destination);
+    if(!ok)
+        QFile::remove(filename);
+
+    return ok;
+}
+
+bool DBBrowserDB::copyDatabase(sqlite3* source, sqlite3* destination, const QString& label, int pagesPerStep)
+{
+    sqlite3_backup* backup = sqlite3_backup_init(destination, "main", source, "main");
+    if(!backup)
+    {
+        lastErrorMessage = QString::fromUtf8(sqlite3_errmsg(destination));
+        return false;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QProgressDialog progress(label, tr("Cancel"), 0, 0);
+    progress.setWindowModality(Qt::ApplicationModal);
+    progress.show();
+    qApp->processEvents();
+
+    // Copy a couple of pages at a time and let the GUI update in between. If the source is locked by another connection, wait a moment and
+    // try again.
+    int status;
+    do
+    {
+        status = sqlite3_backup_step(backup, pagesPerStep);
+
+        int total = sqlite3_backup_pagecount(backup);
+        progress.setMaximum(total);
+        progress.setValue(total - sqlite3_backup_remaining(backup));
+        qApp->processEvents();
+
+        if(progress.wasCanceled())
+        {
+            sqlite3_backup_finish(backup);
+            lastErrorMessage.clear();
+            QApplication::restoreOverrideCursor();
+            return false;
+        }
+
+        if(status == SQLITE_BUSY || status == SQLITE_LOCKED)
+            sqlite3_sleep(50);
+    } while(status == SQLITE_OK || status == SQLITE_BUSY || status == SQLITE_LOCKED);
+
+    sqlite3_backup_finish(backup);
+    QApplication::restoreOverrideCursor();
+
+    if(status != SQLITE_DONE)
+    {
+        lastErrorMessage = QString::fromUtf8(sqlite3_errmsg(destination));
+        return false;
+    }
+
+    return true;
+}
+
 bool DBBrowserDB::executeSQL(QString statement, bool dirtyDB, bool logsql)
 {
     if (!isOpen())
@@ -786,23 +1012,31 @@ bool DBBrowserDB::executeMultiSQL(const QString& statement, bool dirty, bool log
     return true;
 }
 
-bool DBBrowserDB::getRow(const sqlb::ObjectIdentifier& table, const QString& rowid, QList<QByteArray>& rowdata)
+bool DBBrowserDB::getRow(const sqlb::ObjectIdentifier& table, const QString& rowid, QList<QByteArray>& rowdata, QVector<int>* types)
 {
-    QString sQuery = QString("SELECT * FROM %1 WHERE %2='%3';")
+    sqlb::TablePtr tbl = getObjectByName(table).dynamicCast<sqlb::Table>();
+    if(!tbl)
+        return false;
+
+    QString sQuery = QString("SELECT * FROM %1 WHERE %2=?;")
             .arg(table.toString())
-            .arg(sqlb::escapeIdentifier(getObjectByName(table).dynamicCast<sqlb::Table>()->rowidColumn()))
-            .arg(rowid);
+            .arg(sqlb::escapeIdentifier(tbl->rowidColumn()));
 
-    QByteArray utf8Query = sQuery.toUtf8();
-    sqlite3_stmt *stmt;
+    StatementCache::Handle stmt = prepareCached(sQuery);
     bool ret = false;
-    if(sqlite3_prepare_v2(_db, utf8Query, utf8Query.size(), &stmt, NULL) == SQLITE_OK)
+    if(stmt.isValid())
     {
+        QByteArray utf8Rowid = rowid.toUtf8();
+        sqlite3_bind_text(stmt, 1, utf8Rowid.constData(), utf8Rowid.size(), SQLITE_TRANSIENT);
+
         // even this is a while loop, the statement should always only return 1 row
         while(sqlite3_step(stmt) == SQLITE_ROW)
         {
             for (int i = 0; i < sqlite3_column_count(stmt); ++i)
             {
+                if(types)
+                    types->push_back(sqlite3_column_type(stmt, i));
+
                 if(sqlite3_column_type(stmt, i) == SQLITE_NULL)
                 {
                     rowdata.append(QByteArray());
@@ -817,7 +1051,6 @@ bool DBBrowserDB::getRow(const sqlb::ObjectIdentifier& table, const QString& row
             ret = true;
         }
     }
-    sqlite3_finalize(stmt);
 
     return ret;
 }
@@ -825,11 +1058,10 @@ bool DBBrowserDB::getRow(const sqlb::ObjectIdentifier& table, const QString& row
 QString DBBrowserDB::max(const sqlb::ObjectIdentifier& tableName, sqlb::FieldPtr field) const
 {
     QString sQuery = QString("SELECT MAX(CAST(%2 AS INTEGER)) FROM %1;").arg(tableName.toString()).arg(sqlb::escapeIdentifier(field->name()));
-    QByteArray utf8Query = sQuery.toUtf8();
-    sqlite3_stmt *stmt;
+    StatementCache::Handle stmt = prepareCached(sQuery);
     QString ret = "0";
 
-    if(sqlite3_prepare_v2(_db, utf8Query, utf8Query.size(), &stmt, NULL) == SQLITE_OK)
+    if(stmt.isValid())
     {
         // even this is a while loop, the statement should always only return 1 row
         while(sqlite3_step(stmt) == SQLITE_ROW)
@@ -838,7 +1070,6 @@ QString DBBrowserDB::max(const sqlb::ObjectIdentifier& tableName, sqlb::FieldPtr
                 ret = QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
         }
     }
-    sqlite3_finalize(stmt);
 
     return ret;
 }
@@ -975,23 +1206,26 @@ bool DBBrowserDB::updateRecord(const sqlb::ObjectIdentifier& table, const QStrin
         pk = pseudo_pk;
     }
 
-    QString sql = QString("UPDATE %1 SET %2=? WHERE %3='%4';")
+    // The rowid is passed as a parameter, so all updates of the same column share one cached statement
+    QString sql = QString("UPDATE %1 SET %2=? WHERE %3=?;")
             .arg(table.toString())
             .arg(sqlb::escapeIdentifier(column))
-            .arg(pk)
-            .arg(rowid);
+            .arg(pk);
 
-    logSQL(sql, kLogMsg_App);
+    logSQL(QString(sql).replace(sql.lastIndexOf('?'), 1, "'" + rowid + "'"), kLogMsg_App);
     setSavepoint();
 
     // If we get a NULL QByteArray we insert a NULL value, and for that
     // we can pass NULL to sqlite3_bind_text() so that it behaves like sqlite3_bind_null()
     const char *rawValue = value.isNull() ? NULL : value.constData();
+    QByteArray utf8Rowid = rowid.toUtf8();
 
-    sqlite3_stmt* stmt;
+    StatementCache::Handle stmt = prepareCached(sql);
     int success = 1;
-    if(sqlite3_prepare_v2(_db, sql.toUtf8(), -1, &stmt, 0) != SQLITE_OK)
+    if(!stmt.isValid())
         success = 0;
+    if(success == 1 && sqlite3_bind_text(stmt, 2, utf8Rowid.constData(), utf8Rowid.size(), SQLITE_STATIC))
+        success = -1;
     if(success == 1) {
         if(itsBlob)
         {
@@ -1006,8 +1240,6 @@ bool DBBrowserDB::updateRecord(const sqlb::ObjectIdentifier& table, const QStrin
     }
     if(success == 1 && sqlite3_step(stmt) != SQLITE_DONE)
         success = -1;
-    if(success != 0 && sqlite3_finalize(stmt) != SQLITE_OK)
-        success = -1;
 
     if(success == 1)
     {
@@ -1019,6 +1251,87 @@ bool DBBrowserDB::updateRecord(const sqlb::ObjectIdentifier& table, const QStrin
     }
 }
 
+bool DBBrowserDB::updateRecords(const sqlb::ObjectIdentifier& table, const QStringList& columns, const QStringList& rowids,
+                                const QList<QList<QByteArray>>& values, bool itsBlob, const QString& pseudo_pk)
+{
+    if (!isOpen()) return false;
+
+    // Get the primary key the same way as in updateRecord()
+    QString pk;
+    if(pseudo_pk.isEmpty())
+    {
+        sqlb::TablePtr tbl = getObjectByName(table).dynamicCast<sqlb::Table>();
+        if(tbl)
+        {
+            pk = tbl->rowidColumn();
+        } else {
+            lastErrorMessage = tr("Cannot set data on this object");
+            return false;
+        }
+    } else {
+        pk = pseudo_pk;
+    }
+
+    // Apply the changes in a savepoint of their own, so they can be undone as a whole if one of them fails
+    setSavepoint();
+    QString savepointName = generateSavepointName("updaterecords");
+    setSavepoint(savepointName);
+
+    // Change the values column by column. This way only one statement per column needs to be prepared. Only log each statement once
+    // because logging each single change would take longer than making it.
+    bool success = true;
+    for(int column=0;column<columns.size() && success;column++)
+    {
+        QString sql = QString("UPDATE %1 SET %2=? WHERE %3=?;")
+                .arg(table.toString())
+                .arg(sqlb::escapeIdentifier(columns.at(column)))
+                .arg(pk);
+        logSQL(sql, kLogMsg_App);
+
+        StatementCache::Handle stmt = prepareCached(sql);
+        if(!stmt.isValid())
+        {
+            lastErrorMessage = sqlite3_errmsg(_db);
+            success = false;
+            break;
+        }
+
+        for(int row=0;row<rowids.size() && row<values.size();row++)
+        {
+            if(column >= values.at(row).size())
+                continue;
+
+            const QByteArray& value = values.at(row).at(column);
+            const char *rawValue = value.isNull() ? NULL : value.constData();
+            QByteArray utf8Rowid = rowids.at(row).toUtf8();
+
+            sqlite3_reset(stmt);
+            if(itsBlob)
+                sqlite3_bind_blob(stmt, 1, rawValue, value.length(), SQLITE_STATIC);
+            else
+                sqlite3_bind_text(stmt, 1, rawValue, value.length(), SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, utf8Rowid.constData(), utf8Rowid.size(), SQLITE_TRANSIENT);
+
+            if(sqlite3_step(stmt) != SQLITE_DONE)
+            {
+                lastErrorMessage = sqlite3_errmsg(_db);
+                success = false;
+                break;
+            }
+        }
+    }
+
+    if(success)
+    {
+        releaseSavepoint(savepointName);
+        return true;
+    } else {
+        qWarning() << "updateRecords: " << lastErrorMessage;
+        revertToSavepoint(savepointName);
+        return false;
+    }
+}
+
 bool DBBrowserDB::createTable(const sqlb::ObjectIdentifier& name, const sqlb::FieldVector& structure)
 {
     // Build SQL statement
@@ -1317,13 +1630,21 @@ void DBBrowserDB::logSQL(QString statement, int msgtype)
 
 void DBBrowserDB::updateSchema()
 {
-    schemata.clear();
-
     // Exit here is no DB is opened
     if(!isOpen())
+    {
+        schemata.clear();
+        schemaVersions.clear();
+        parsedObjects.clear();
+        statementCache.clear();
         return;
+    }
+
+    // The journal mode might have been changed, too. This decides whether the read-only connections can be used.
+    isWal = !isInMemory && getPragma("journal_mode").compare("wal", Qt::CaseInsensitive) == 0;
 
     // Get a list of all databases. This list always includes the main and the temp database but can include more items if there are attached databases
+    QStringList schemaNames;
     QString db_statement = "PRAGMA database_list;";
     QByteArray db_utf8Statement = db_statement.toUtf8();
     logSQL(db_statement, kLogMsg_App);
@@ -1331,88 +1652,183 @@ void DBBrowserDB::updateSchema()
     const char* db_tail;
     if(sqlite3_prepare_v2(_db, db_utf8Statement, db_utf8Statement.length(), &db_vm, &db_tail) == SQLITE_OK)
     {
-        // Loop through all the databases
+        // Get the schema names which are in column 1 (counting starts with 0). 0 contains an ID and 2 the file path.
         while(sqlite3_step(db_vm) == SQLITE_ROW)
+            schemaNames.push_back(QString::fromUtf8((const char*)sqlite3_column_text(db_vm, 1)));
+        sqlite3_finalize(db_vm);
+    } else {
+        qWarning() << tr("could not get list of databases: %1").arg(sqlite3_errmsg(_db));
+    }
+
+    // SQLite increments the schema version of a database with each change of its structure. If none of them has changed and no database
+    // has been attached or detached since the last update, the objects which have been loaded then are still up to date.
+    QMap<QString, int> versions;
+    foreach(const QString& schema_name, schemaNames)
+    {
+        QString statement = QString("PRAGMA %1.schema_version;").arg(sqlb::escapeIdentifier(schema_name));
+        QByteArray utf8Statement = statement.toUtf8();
+        logSQL(statement, kLogMsg_App);
+
+        int version = -1;
+        sqlite3_stmt* vm;
+        if(sqlite3_prepare_v2(_db, utf8Statement, utf8Statement.length(), &vm, NULL) == SQLITE_OK)
         {
-            // Get the schema name which is in column 1 (counting starts with 0). 0 contains an ID and 2 the file path.
-            QString schema_name = QString::fromUtf8((const char*)sqlite3_column_text(db_vm, 1));
-
-            // Get a list of all the tables for the current database schema. We need to do this differently for normal databases and the temporary schema
-            // because SQLite doesn't understand the "temp.sqlite_master" notation.
-            QString statement;
-            if(schema_name == "temp")
-                statement = QString("SELECT type,name,sql,tbl_name FROM sqlite_temp_master;");
-            else
-                statement = QString("SELECT type,name,sql,tbl_name FROM %1.sqlite_master;").arg(sqlb::escapeIdentifier(schema_name));
-            QByteArray utf8Statement = statement.toUtf8();
-            logSQL(statement, kLogMsg_App);
-
-            sqlite3_stmt* vm;
-            const char* tail;
-            int err = sqlite3_prepare_v2(_db, utf8Statement, utf8Statement.length(), &vm, &tail);
-            if(err == SQLITE_OK)
+            if(sqlite3_step(vm) == SQLITE_ROW)
+                version = sqlite3_column_int(vm, 0);
+            sqlite3_finalize(vm);
+        }
+        versions.insert(schema_name, version);
+    }
+    if(!schemaVersions.isEmpty() && versions == schemaVersions)
+        return;
+
+    schemata.clear();
+
+    // The cached statements might refer to objects which have been changed or don't exist anymore
+    statementCache.clear();
+
+    // Objects whose CREATE statement is still the same are taken from the last update instead of parsing them again
+    QHash<QString, QPair<QString, sqlb::ObjectPtr>> previouslyParsed;
+    previouslyParsed.swap(parsedObjects);
+
+    // Read the rows of all schemata first, so the statements which need to be parsed can be parsed at the same time
+    struct SchemaRow
+    {
+        QString schema;
+        QString type;
+        QString name;
+        QString tableName;
+        QString key;
+        sqlb::ObjectPtr object;     // Reused object or null if the statement is parsed
+        int statement;              // Index in the list of statements to parse
+    };
+    QVector<SchemaRow> rows;
+    QVector<SchemaParser::Statement> statements;
+
+    foreach(const QString& schema_name, schemaNames)
+    {
+        // Get a list of all the tables for the current database schema. We need to do this differently for normal databases and the temporary schema
+        // because SQLite doesn't understand the "temp.sqlite_master" notation.
+        QString statement;
+        if(schema_name == "temp")
+            statement = QString("SELECT type,name,sql,tbl_name FROM sqlite_temp_master;");
+        else
+            statement = QString("SELECT type,name,sql,tbl_name FROM %1.sqlite_master;").arg(sqlb::escapeIdentifier(schema_name));
+        QByteArray utf8Statement = statement.toUtf8();
+        logSQL(statement, kLogMsg_App);
+
+        sqlite3_stmt* vm;
+        const char* tail;
+        int err = sqlite3_prepare_v2(_db, utf8Statement, utf8Statement.length(), &vm, &tail);
+        if(err == SQLITE_OK)
+        {
+            while(sqlite3_step(vm) == SQLITE_ROW)
             {
-                while(sqlite3_step(vm) == SQLITE_ROW)
-                {
-                    QString val_type = QString::fromUtf8((const char*)sqlite3_column_text(vm, 0));
-                    QString val_name = QString::fromUtf8((const char*)sqlite3_column_text(vm, 1));
-                    QString val_sql = QString::fromUtf8((const char*)sqlite3_column_text(vm, 2));
-                    QString val_tblname = QString::fromUtf8((const char*)sqlite3_column_text(vm, 3));
-                    val_sql.replace("\r", "");
-
-                    sqlb::Object::Types type;
-                    if(val_type == "table")
-                        type = sqlb::Object::Types::Table;
-                    else if(val_type == "index")
-                        type = sqlb::Object::Types::Index;
-                    else if(val_type == "trigger")
-                        type = sqlb::Object::Types::Trigger;
-                    else if(val_type == "view")
-                        type = sqlb::Object::Types::View;
-                    else
-                        continue;
+                QString val_type = QString::fromUtf8((const char*)sqlite3_column_text(vm, 0));
+                QString val_name = QString::fromUtf8((const char*)sqlite3_column_text(vm, 1));
+                QString val_sql = QString::fromUtf8((const char*)sqlite3_column_text(vm, 2));
+                QString val_tblname = QString::fromUtf8((const char*)sqlite3_column_text(vm, 3));
+                val_sql.replace("\r", "");
+
+                sqlb::Object::Types type;
+                if(val_type == "table")
+                    type = sqlb::Object::Types::Table;
+                else if(val_type == "index")
+                    type = sqlb::Object::Types::Index;
+                else if(val_type == "trigger")
+                    type = sqlb::Object::Types::Trigger;
+                else if(val_type == "view")
+                    type = sqlb::Object::Types::View;
+                else
+                    continue;
 
-                    if(!val_sql.isEmpty())
+                if(!val_sql.isEmpty())
+                {
+                    SchemaRow row;
+                    row.schema = schema_name;
+                    row.type = val_type;
+                    row.name = val_name;
+                    row.tableName = val_tblname;
+                    row.key = val_type + " " + sqlb::ObjectIdentifier(schema_name, val_name).toString();
+                    row.statement = -1;
+
+                    auto cached = previouslyParsed.constFind(row.key);
+                    if(cached != previouslyParsed.constEnd() && cached->first == val_sql)
                     {
-                        sqlb::ObjectPtr object = sqlb::Object::parseSQL(type, val_sql);
-
-                        // If parsing wasn't successful set the object name manually, so that at least the name is going to be correct
-                        if(!object->fullyParsed())
-                            object->setName(val_name);
-
-                        // For virtual tables and views query the column list using the SQLite pragma because for both we can't yet rely on our grammar parser
-                        if((type == sqlb::Object::Types::Table && object.dynamicCast<sqlb::Table>()->isVirtual()) || type == sqlb::Object::Types::View)
-                        {
-                            auto columns = queryColumnInformation(schema_name, val_name);
-
-                            if(type == sqlb::Object::Types::Table)
-                            {
-                                sqlb::TablePtr tab = object.dynamicCast<sqlb::Table>();
-                                foreach(const auto& column, columns)
-                                    tab->addField(sqlb::FieldPtr(new sqlb::Field(column.first, column.second)));
-                            } else {
-                                sqlb::ViewPtr view = object.dynamicCast<sqlb::View>();
-                                foreach(const auto& column, columns)
-                                    view->addField(sqlb::FieldPtr(new sqlb::Field(column.first, column.second)));
-                            }
-                        } else if(type == sqlb::Object::Types::Trigger) {
-                            // For triggers set the name of the table the trigger operates on here because we don't have a parser for trigger statements yet.
-                            sqlb::TriggerPtr trg = object.dynamicCast<sqlb::Trigger>();
-                            trg->setTable(val_tblname);
-                        }
-
-                        schemata[schema_name].insert(val_type, object);
+                        row.object = cached->second;
+                        parsedObjects.insert(row.key, *cached);
+                    } else {
+                        SchemaParser::Statement parse;
+                        parse.type = type;
+                        parse.sql = val_sql;
+                        row.statement = statements.size();
+                        statements.push_back(parse);
                     }
+                    rows.push_back(row);
                 }
-                sqlite3_finalize(vm);
+            }
+            sqlite3_finalize(vm);
+        } else {
+            qWarning() << tr("could not get list of db objects: %1, %2").arg(err).arg(sqlite3_errmsg(_db));
+        }
+    }
+
+    // Each statement gets a parser of its own, so they can be parsed on several threads
+    SchemaParser::parse(statements, QThread::idealThreadCount());
+
+    // Add the objects in the order of the rows, so the result doesn't depend on the order in which they have been parsed
+    foreach(const SchemaRow& row, rows)
+    {
+        if(row.object)
+        {
+            schemata[row.schema].insert(row.type, row.object);
+            continue;
+        }
+
+        sqlb::ObjectPtr object = statements.at(row.statement).object;
+        sqlb::Object::Types type = statements.at(row.statement).type;
+
+        // If parsing wasn't successful set the object name manually, so that at least the name is going to be correct
+        if(!object->fullyParsed())
+            object->setName(row.name);
+
+        // For virtual tables and views query the column list using the SQLite pragma because for both we can't yet rely on our grammar parser
+        if((type == sqlb::Object::Types::Table && object.dynamicCast<sqlb::Table>()->isVirtual()) || type == sqlb::Object::Types::View)
+        {
+            auto columns = queryColumnInformation(row.schema, row.name);
+
+            if(type == sqlb::Object::Types::Table)
+            {
+                sqlb::TablePtr tab = object.dynamicCast<sqlb::Table>();
+                foreach(const auto& column, columns)
+                    tab->addField(sqlb::FieldPtr(new sqlb::Field(column.first, column.second)));
             } else {
-                qWarning() << tr("could not get list of db objects: %1, %2").arg(err).arg(sqlite3_errmsg(_db));
+                sqlb::ViewPtr view = object.dynamicCast<sqlb::View>();
+                foreach(const auto& column, columns)
+                    view->addField(sqlb::FieldPtr(new sqlb::Field(column.first, column.second)));
+            }
+        } else {
+            if(type == sqlb::Object::Types::Trigger)
+            {
+                // For triggers set the name of the table the trigger operates on here because we don't have a parser for trigger statements yet.
+                sqlb::TriggerPtr trg = object.dynamicCast<sqlb::Trigger>();
+                trg->setTable(row.tableName);
             }
+
+            // The columns of views and virtual tables can change without a change of their own statement, e.g. when a table
+            // they select from is altered. All other objects only depend on their statement, so they can be reused next time.
+            parsedObjects.insert(row.key, qMakePair(statements.at(row.statement).sql, object));
         }
-    } else {
-        qWarning() << tr("could not get list of databases: %1").arg(sqlite3_errmsg(_db));
+
+        schemata[row.schema].insert(row.type, object);
     }
 
+    // If a version couldn't be read, don't rely on it next time
+    if(!versions.values().contains(-1) && !schemaNames.isEmpty())
+        schemaVersions = versions;
+    else
+        schemaVersions.clear();
+
     emit structureUpdated();
 }
 
@@ -1422,22 +1838,18 @@ QString DBBrowserDB::getPragma(const QString& pragma)
         return QString();
 
     QString sql = QString("PRAGMA %1").arg(pragma);
-    sqlite3_stmt* vm;
-    const char* tail;
     QString retval;
 
     // Get value from DB
-    int err = sqlite3_prepare_v2(_db, sql.toUtf8(), sql.toUtf8().length(), &vm, &tail);
-    if(err == SQLITE_OK){
+    StatementCache::Handle vm = prepareCached(sql);
+    if(vm.isValid()){
         logSQL(sql, kLogMsg_App);
         if(sqlite3_step(vm) == SQLITE_ROW)
             retval = QString::fromUtf8((const char *) sqlite3_column_text(vm, 0));
         else
             qWarning() << tr("didn't receive any output from pragma %1").arg(pragma);
-
-        sqlite3_finalize(vm);
     } else {
-        qWarning() << tr("could not execute pragma command: %1, %2").arg(err).arg(sqlite3_errmsg(_db));
+        qWarning() << tr("could not execute pragma command: %1, %2").arg(sqlite3_errcode(_db)).arg(sqlite3_errmsg(_db));
     }
 
     // Return it
@@ -1460,6 +1872,17 @@ bool DBBrowserDB::setPragma(const QString& pragma, const QString& value)
     if( !res )
         qWarning() << tr("Error setting pragma %1 to %2: %3").arg(pragma).arg(value).arg(lastErrorMessage);
 
+    // Most pragmas only affect the connection but some of them are stored in the database file
+    if(res && isInMemory && (pragma == "user_version" || pragma == "application_id" || pragma == "auto_vacuum" || pragma == "page_size"))
+    {
+        memoryModified = true;
+        emit dbChanged(getDirty());
+    }
+
+    // Switching to or from WAL mode decides whether the read-only connections can be used
+    if(res && pragma == "journal_mode")
+        isWal = !isInMemory && getPragma("journal_mode").compare("wal", Qt::CaseInsensitive) == 0;
+
     // If this is the page_size pragma being set, we need to execute the vacuum command right after the pragma statement or the new
     // page size won't be saved.
     if(res && pragma == "page_size")
@@ -1511,6 +1934,9 @@ bool DBBrowserDB::loadExtension(const QString& filename)
     char* error;
     if(sqlite3_load_extension(_db, filename.toUtf8(), 0, &error) == SQLITE_OK)
     {
+        // Connections of the pool need to be reopened to load the extension there, too
+        loadedExtensions.append(filename);
+        openReadConnections();
         return true;
     } else {
         lastErrorMessage = QString::fromUtf8(error);
@@ -1544,6 +1970,54 @@ QVector<QPair<QString, QString>> DBBrowserDB::queryColumnInformation(const QStri
     return result;
 }
 
+StatementCache::Handle DBBrowserDB::prepareCached(const QString& sql) const
+{
+    return statementCache.acquire(_db, sql);
+}
+
+void DBBrowserDB::openReadConnections()
+{
+    // Separate connections would read the file and not the in-memory copy, and for encrypted files they would need the key
+    if(isInMemory || isEncrypted)
+    {
+        readConnections.close();
+        return;
+    }
+
+    bool regex = Settings::getValue("extensions", "disableregex").toBool() == false;
+    QStringList extensions = loadedExtensions;
+    QueryProfiler* profiler = &queryProfiler;
+    readConnections.open(curDBFilename, [regex, extensions, profiler](sqlite3* db) {
+        return setupReadConnection(db, regex, extensions, profiler);
+    });
+}
+
+ConnectionPool::Handle DBBrowserDB::readConnection(const ConnectionPool::Handle& current)
+{
+    // The connections of the pool only see what has been committed to the main database. So use the main connection while there are
+    // uncommitted changes and when there are temporary objects or attached databases which queries might refer to.
+    bool otherSchemata = false;
+    for(auto it=schemata.constBegin();it!=schemata.constEnd();++it)
+    {
+        if(it.key() != "main" && !it.value().isEmpty())
+            otherSchemata = true;
+    }
+
+    // Outside of WAL mode a reader on another connection would make committing on the main connection fail for as long as it's
+    // reading, so the pool is only used for databases in WAL mode.
+    if(isWal && !getDirty() && !otherSchemata)
+    {
+        if(readConnections.isCurrent(current))
+            return current;
+
+        ConnectionPool::Handle handle = readConnections.acquire();
+        if(handle.isValid())
+            return handle;
+    }
+
+    return ConnectionPool::wrap(_db);
+}
+
 QString DBBrowserDB::generateSavepointName(const QString& identifier) const
 {
     // Generate some sort of unique name for a savepoint for internal use.
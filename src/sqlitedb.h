@@ -2,7 +2,11 @@
 #define SQLITEDB_H
 
 #include "sqlitetypes.h"
+#include "StatementCache.h"
+#include "ConnectionPool.h"
+#include "QueryProfiler.h"
 
+#include <QHash>
 #include <QStringList>
 #include <QMultiMap>
 #include <QByteArray>
@@ -24,9 +28,18 @@ class DBBrowserDB : public QObject
     Q_OBJECT
 
 public:
-    explicit DBBrowserDB () : _db(0), isEncrypted(false), isReadOnly(false), dontCheckForStructureUpdates(false) {}
+    explicit DBBrowserDB () : _db(0), isEncrypted(false), isReadOnly(false), isInMemory(false), memoryModified(false), isWal(false), dontCheckForStructureUpdates(false) {}
     virtual ~DBBrowserDB (){}
-    bool open(const QString& db, bool readOnly = false);
+
+    /**
+     * @brief open opens a database file
+     * @param db Name of the file
+     * @param readOnly Don't allow any changes to the file
+     * @param inMemory Load the entire file into an in-memory database and work on that. Changes are written back to the file when they
+     *        are saved. This isn't supported for encrypted databases which are opened normally instead. Use inMemory() to check.
+     * @return true if the database has been opened, false if not. In the latter case also lastErrorMessage is set
+     */
+    bool open(const QString& db, bool readOnly = false, bool inMemory = false);
     bool attach(const QString& filename, QString attach_as = "");
     bool create ( const QString & db);
     bool close();
@@ -35,7 +48,30 @@ public:
     bool revertToSavepoint(const QString& pointname = "RESTOREPOINT");
     bool releaseAllSavepoints();
     bool revertAll();
+
+    //! Commits all changes. For an in-memory copy of a file the copy is written back to the file, too.
+    bool saveChanges();
     bool dump(const QString & filename, const QStringList &tablesToDump, bool insertColNames, bool insertNew, bool exportSchema, bool exportData, bool keepOldSchema);
+
+    /**
+     * @brief saveCopyAs copies the main database page by page to a new file. This is a lot faster than dumping and re-importing it.
+     *        Changes which haven't been written yet can't be copied, so this fails if there are any.
+     * @param filename Name of the new database file. An existing file is overwritten.
+     * @return true if the database has been copied, false if not. In the latter case also lastErrorMessage is set unless it was cancelled.
+     */
+    bool saveCopyAs(const QString& filename);
+
+    /**
+     * @brief copyDatabase copies the main schema of one connection to another one using the online backup API. This works for database
+     *        files as well as for in-memory databases. The copy is done in steps and a progress dialog is shown which allows cancelling
+     *        it. The GUI keeps running between the steps.
+     * @param source Connection to copy from
+     * @param destination Connection to copy to. All of its content is replaced.
+     * @param label Text for the progress dialog
+     * @param pagesPerStep Number of pages to copy in each step
+     * @return true if the database has been copied, false if not. In the latter case also lastErrorMessage is set unless it was cancelled.
+     */
+    bool copyDatabase(sqlite3* source, sqlite3* destination, const QString& label, int pagesPerStep = 1024);
     bool executeSQL(QString statement, bool dirtyDB = true, bool logsql = true);
     bool executeMultiSQL(const QString& statement, bool dirty = true, bool log = false);
     const QString& lastError() const { return lastErrorMessage; }
@@ -47,9 +83,10 @@ public:
      * @param sTableName Table to query.
      * @param rowid The rowid to fetch.
      * @param rowdata A list of QByteArray containing the row data.
+     * @param types If not null, this is filled with the SQLite data types of the values.
      * @return true if statement execution was ok, else false.
      */
-    bool getRow(const sqlb::ObjectIdentifier& table, const QString& rowid, QList<QByteArray>& rowdata);
+    bool getRow(const sqlb::ObjectIdentifier& table, const QString& rowid, QList<QByteArray>& rowdata, QVector<int>* types = nullptr);
 
     /**
      * @brief max Queries the table t for the max value of field.
@@ -72,6 +109,21 @@ public:
     bool deleteRecords(const sqlb::ObjectIdentifier& table, const QStringList& rowids);
     bool updateRecord(const sqlb::ObjectIdentifier& table, const QString& column, const QString& rowid, const QByteArray& value, bool itsBlob, const QString& pseudo_pk = QString());
 
+    /**
+     * @brief updateRecords Changes the values of a block of cells. All changes are applied in one savepoint and
+     *        either all of them or none of them are made.
+     * @param table The table to edit
+     * @param columns Names of the columns to change
+     * @param rowids The rowid (or pseudo primary key) values of the rows to change
+     * @param values For each row a list of values, one for each column. If a list is shorter than the list of columns,
+     *        the remaining columns of this row are not changed.
+     * @param itsBlob Set this to true to store the values as BLOBs instead of text
+     * @param pseudo_pk The pseudo primary key when editing a view
+     * @return true if all values could be changed, false if not. In the latter case also lastErrorMessage is set
+     */
+    bool updateRecords(const sqlb::ObjectIdentifier& table, const QStringList& columns, const QStringList& rowids,
+                       const QList<QList<QByteArray>>& values, bool itsBlob, const QString& pseudo_pk = QString());
+
     bool createTable(const sqlb::ObjectIdentifier& name, const sqlb::FieldVector& structure);
     bool renameTable(const QString& schema, const QString& from_table, const QString& to_table);
     bool addColumn(const sqlb::ObjectIdentifier& tablename, const sqlb::FieldPtr& field);
@@ -94,6 +146,7 @@ public:
     bool isOpen() const;
     bool encrypted() const { return isEncrypted; }
     bool readOnly() const { return isReadOnly; }
+    bool inMemory() const { return isInMemory; }
     bool getDirty() const;
     QString currentFile() const { return curDBFilename; }
     void logSQL(QString statement, int msgtype);
@@ -109,6 +162,31 @@ public:
 
     QString generateSavepointName(const QString& identifier = QString()) const;
 
+    /**
+     * @brief prepareCached returns a prepared statement from the statement cache. Use this for statements which are executed
+     *        frequently. Values should be passed using parameters instead of being part of the SQL text, so different values
+     *        can share the same statement. The statement is handed back to the cache when the returned handle is destroyed.
+     *        The cached statements are thrown away when the schema is updated.
+     * @param sql The statement to prepare.
+     * @return A handle to the statement. It is invalid if the statement couldn't be prepared.
+     */
+    StatementCache::Handle prepareCached(const QString& sql) const;
+    quint64 statementCacheHits() const { return statementCache.hits(); }
+    quint64 statementCacheMisses() const { return statementCache.misses(); }
+
+    /**
+     * @brief readConnection returns a connection for running queries which only read data, e.g. for browsing tables or exporting them.
+     *        If the database is in WAL mode and everything these queries could see has been committed, this is a read-only connection
+     *        of a pool. These connections don't have to wait for each other or for the main connection. Otherwise the handle simply
+     *        refers to the main connection. All statements prepared on the connection must be finalised before the handle is destroyed.
+     * @param current A connection which has been returned by this function before. If it's a connection of the pool and can still be
+     *        used, it's returned again instead of taking another connection from the pool.
+     */
+    ConnectionPool::Handle readConnection(const ConnectionPool::Handle& current = ConnectionPool::Handle());
+
+    //! The profiler collects statistics for the statements executed on the main connection and on the read-only connections
+    QueryProfiler& profiler() { return queryProfiler; }
+
     sqlite3 * _db;
 
     schemaMap schemata;
@@ -117,13 +195,30 @@ signals:
     void sqlExecuted(QString sql, int msgtype);
     void dbChanged(bool dirty);
     void structureUpdated();
+    void aboutToClose();
 
 private:
     QString curDBFilename;
     QString lastErrorMessage;
     QStringList savepointList;
+    mutable StatementCache statementCache;
     bool isEncrypted;
     bool isReadOnly;
+    bool isInMemory;            // true if the file has been loaded into an in-memory database
+    bool memoryModified;        // true if changes have been committed to the in-memory database which haven't been written to the file yet
+    bool isWal;                 // true if the database file is in WAL mode
+    QStringList loadedExtensions;
+    QueryProfiler queryProfiler;
+
+    // Schema version of each database when the schema has been loaded the last time, and the objects which have been parsed then. Maps from
+    // the type and the full name of each object to its CREATE statement and the parsed object.
+    QMap<QString, int> schemaVersions;
+    QHash<QString, QPair<QString, sqlb::ObjectPtr>> parsedObjects;
+    ConnectionPool readConnections;
+
+    void openReadConnections();
+
+    bool writeMemoryToFile();
 
     bool tryEncryptionSettings(const QString& filename, bool* encrypted, CipherDialog*& cipherSettings);
 
@@ -11,15 +11,36 @@
 #include <QFile>
 #include <QUrl>
 
+#include <limits>
+
 SqliteTableModel::SqliteTableModel(DBBrowserDB& db, QObject* parent, size_t chunkSize, const QString& encoding)
     : QAbstractTableModel(parent)
     , m_db(db)
     , m_rowCount(0)
+    , m_fetchedRows(0)
+    , m_cache(Settings::getValue("db", "rowcachesize").toULongLong() * 1024 * 1024)
+    , m_keysetPagination(false)
+    , m_loader(nullptr)
+    , m_generation(0)
+    , m_counter(nullptr)
+    , m_countGeneration(0)
+    , m_rowCountEstimated(false)
+    , m_countPending(false)
+    , m_firstChunkPending(false)
+    , m_loadingPaused(false)
     , m_chunkSize(chunkSize)
     , m_valid(false)
     , m_encoding(encoding)
 {
     reset();
+
+    // Stop fetching in the background before the database is closed
+    connect(&m_db, &DBBrowserDB::aboutToClose, this, &SqliteTableModel::stopLoading);
+}
+
+SqliteTableModel::~SqliteTableModel()
+{
+    stopLoading();
 }
 
 void SqliteTableModel::reset()
@@ -30,9 +51,15 @@ void SqliteTableModel::reset()
     m_sSortOrder = "ASC";
     m_headers.clear();
     m_mWhere.clear();
+    m_mFilterValues.clear();
     m_vDataTypes.clear();
     m_vDisplayFormat.clear();
     m_pseudoPk.clear();
+    m_keysetPagination = false;
+    m_sKeysetSelect.clear();
+    m_sKeysetWhere.clear();
+    m_sKeysetOrder.clear();
+    m_seekPositions.clear();
 }
 
 void SqliteTableModel::setChunkSize(size_t chunksize)
@@ -40,6 +67,11 @@ void SqliteTableModel::setChunkSize(size_t chunksize)
     m_chunkSize = chunksize;
 }
 
+void SqliteTableModel::setCacheMemoryBudget(size_t bytes)
+{
+    m_cache.setMemoryBudget(bytes);
+}
+
 void SqliteTableModel::setTable(const sqlb::ObjectIdentifier& table, int sortColumn, Qt::SortOrder sortOrder, const QVector<QString>& display_format)
 {
     // Unset all previous settings. When setting a table all information on the previously browsed data set is removed first.
@@ -99,12 +131,37 @@ void SqliteTableModel::setTable(const sqlb::ObjectIdentifier& table, int sortCol
 }
 
 namespace {
+// Appends the column names of a query. The statement is only prepared for this because stepping it might take as long as executing all of it.
+bool queryColumnNames(sqlite3* db, const QString& query, QStringList& names)
+{
+    sqlite3_stmt* stmt;
+    QByteArray utf8Query = query.toUtf8();
+    if(sqlite3_prepare_v2(db, utf8Query, utf8Query.size(), &stmt, NULL) != SQLITE_OK)
+        return false;
+    int columns = sqlite3_column_count(stmt);
+    for(int i=0;i<columns;i++)
+        names.append(QString::fromUtf8(sqlite3_column_name(stmt, i)));
+    sqlite3_finalize(stmt);
+    return true;
+}
+
 QString rtrimChar(const QString& s, QChar c) {
     QString r = s.trimmed();
     while(r.endsWith(c))
         r.chop(1);
     return r;
 }
+
+// Converts ASCII characters to lower case and leaves all others as they are. This is how the LIKE operator of SQLite compares strings.
+QByteArray asciiToLower(const QByteArray& s) {
+    QByteArray r(s.constData(), s.size());
+    for(int i=0;i<r.size();i++)
+    {
+        if(r.at(i) >= 'A' && r.at(i) <= 'Z')
+            r[i] = r.at(i) + ('a' - 'A');
+    }
+    return r;
+}
 }
 
 void SqliteTableModel::setQuery(const QString& sQuery, bool dontClearHeaders)
@@ -120,9 +177,19 @@ void SqliteTableModel::setQuery(const QString& sQuery, bool dontClearHeaders)
 
     removeCommentsFromQuery(m_sQuery);
 
+    // Remove all rows of the previous query
+    clearCache();
+
+    // When fetching in the background don't wait for the row count before showing the first rows
+    if(m_loader && !m_sQuery.startsWith("EXPLAIN", Qt::CaseInsensitive) && !m_sQuery.startsWith("PRAGMA", Qt::CaseInsensitive))
+    {
+        setQueryWithEstimatedRowCount(sQuery, dontClearHeaders);
+        return;
+    }
+
     // do a count query to get the full row count in a fast manner
-    m_rowCount = getQueryRowCount();
-    if(m_rowCount == -1)
+    int rowCount = getQueryRowCount();
+    if(rowCount == -1)
     {
         m_valid = false;
         return;
@@ -134,14 +201,220 @@ void SqliteTableModel::setQuery(const QString& sQuery, bool dontClearHeaders)
         m_headers.append(getColumns(sQuery, m_vDataTypes));
     }
 
-    // now fetch the first entries
-    clearCache();
+    // The model always reports the full number of rows. Only the first chunk is fetched right now, all other chunks are fetched
+    // as soon as the view accesses them.
+    if(rowCount > 0)
+    {
+        beginInsertRows(QModelIndex(), 0, rowCount - 1);
+        m_rowCount = rowCount;
+        endInsertRows();
+    }
     fetchData(0, m_chunkSize);
     m_valid = true;
 
     emit layoutChanged();
 }
 
+void SqliteTableModel::setQueryWithEstimatedRowCount(const QString& sQuery, bool dontClearHeaders)
+{
+    // headers
+    if(!dontClearHeaders && !queryColumnNames(m_db._db, sQuery, m_headers))
+    {
+        m_valid = false;
+        return;
+    }
+
+    // Even the first chunk is fetched in the background because with a selective filter on a large table it might take a while until
+    // the first rows are found. The model stays empty until it arrives, see handleChunkFetched().
+    m_firstChunkPending = true;
+    m_valid = true;
+    if(!m_loadingPaused)
+        m_loader->enqueue(makeTask(0, qMax<size_t>(m_chunkSize, 1)));
+
+    emit layoutChanged();
+    emit rowCountChanged();
+}
+
+RowLoader::Task SqliteTableModel::prepareQuery(const QString& sQuery, const ConnectionPool::Handle& db)
+{
+    reset();
+    m_valid = false;
+    m_sQuery = sQuery.trimmed();
+    removeCommentsFromQuery(m_sQuery);
+    clearCache();
+
+    if(!queryColumnNames(db, m_sQuery, m_headers) || m_headers.isEmpty())
+        return RowLoader::Task();
+
+    RowLoader::Task task = makeTask(0, qMax<size_t>(m_chunkSize, 1));
+    task.db = db;
+    return task;
+}
+
+void SqliteTableModel::setQueryResult(const RowLoader::Result& first)
+{
+    if(!first.ok)
+    {
+        m_valid = false;
+        return;
+    }
+
+    // If the first chunk isn't full we know the exact number of rows without counting them. PRAGMA and EXPLAIN statements can't be
+    // split into chunks, so all of their rows are in the first one.
+    size_t chunkSize = qMax<size_t>(m_chunkSize, 1);
+    int rowCount = first.rows.rowCount();
+    bool exact = static_cast<size_t>(rowCount) < chunkSize ||
+            m_sQuery.startsWith("PRAGMA", Qt::CaseInsensitive) || m_sQuery.startsWith("EXPLAIN", Qt::CaseInsensitive);
+    if(!exact)
+        rowCount = qMax(rowCount, estimateRowCount());
+
+    if(rowCount > 0)
+    {
+        beginInsertRows(QModelIndex(), 0, rowCount - 1);
+        m_rowCount = rowCount;
+        endInsertRows();
+    }
+    storeChunk(first);
+    m_valid = true;
+
+    // Count the rows in the background. The estimate is replaced as soon as the result is there.
+    if(!exact)
+    {
+        m_rowCountEstimated = true;
+        requestRowCount();
+    }
+
+    emit layoutChanged();
+    emit rowCountChanged();
+}
+
+int SqliteTableModel::estimateRowCount() const
+{
+    // Only unfiltered tables can be estimated without executing the query
+    if(m_sTable.isEmpty() || !m_mWhere.isEmpty())
+        return -1;
+    sqlb::TablePtr table = m_db.getObjectByName(m_sTable).dynamicCast<sqlb::Table>();
+    if(!table || table->isVirtual())
+        return -1;
+
+    // If the database has been analysed, the first number in the stat column of sqlite_stat1 is the approximate number of rows in the table.
+    // If not, there is no cheap way of estimating it. Things like the largest rowid can be off by billions when the rowids are sparse, so
+    // the caller sticks to the number of rows in the first chunk until the rows have been counted in the background.
+    QString stat = QString("SELECT stat FROM %1.sqlite_stat1 WHERE tbl='%2' LIMIT 1;")
+            .arg(sqlb::escapeIdentifier(m_sTable.schema()), QString(m_sTable.name()).replace("'", "''"));
+    qint64 count = querySingleInteger(stat);
+
+    return static_cast<int>(qMin<qint64>(count, std::numeric_limits<int>::max()));
+}
+
+qint64 SqliteTableModel::querySingleInteger(const QString& query) const
+{
+    qint64 value = -1;
+
+    StatementCache::Handle stmt = m_db.prepareCached(query);
+    if(stmt.isValid())
+    {
+        if(sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL)
+        {
+            // The stat column of sqlite_stat1 contains a list of numbers separated by spaces. Only the first one is used here.
+            QByteArray data(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+            bool ok;
+            qint64 v = data.split(' ').first().toLongLong(&ok);
+            if(ok)
+                value = v;
+        }
+    }
+
+    return value;
+}
+
+QString SqliteTableModel::countQuery() const
+{
+    return QString("SELECT COUNT(*) FROM (%1);").arg(rtrimChar(m_sQuery, ';'));
+}
+
+void SqliteTableModel::requestRowCount()
+{
+    if(!m_counter || m_loadingPaused || !m_rowCountEstimated || m_countPending)
+        return;
+
+    // Counting the rows has a connection of its own, so interrupting it doesn't interrupt fetching the chunks
+    m_countConnection = m_db.readConnection(m_countConnection);
+
+    RowLoader::Task task;
+    task.db = m_countConnection;
+    task.generation = ++m_countGeneration;
+    task.columns = 1;
+    task.query = countQuery().toUtf8();
+    m_db.logSQL(QString::fromUtf8(task.query), kLogMsg_App);
+    m_counter->enqueue(task);
+    m_countPending = true;
+}
+
+void SqliteTableModel::handleRowCountFetched(const RowLoader::Result& result)
+{
+    // Ignore results for older queries
+    if(result.generation != m_countGeneration)
+        return;
+    m_countPending = false;
+    if(!m_rowCountEstimated)
+        return;
+
+    if(result.ok && !result.rows.isEmpty())
+    {
+        setExactRowCount(result.rows.cell(0, 0).toInt());
+    } else if(result.interrupted) {
+        // Counting has been stopped by an interrupt of another statement on the same connection. It's started again with the next
+        // request for a chunk, just like after cancelRowCount().
+    } else {
+        // Counting has failed, so try it once more on the main connection. If this fails too, the estimate is all we get.
+        int count = getQueryRowCount();
+        setExactRowCount(count >= 0 ? count : m_rowCount);
+    }
+}
+
+void SqliteTableModel::setExactRowCount(int count)
+{
+    m_rowCountEstimated = false;
+
+    // Add or remove the rows the estimate was off by
+    if(count > m_rowCount)
+    {
+        beginInsertRows(QModelIndex(), m_rowCount, count - 1);
+        m_rowCount = count;
+        endInsertRows();
+    } else if(count < m_rowCount) {
+        beginRemoveRows(QModelIndex(), count, m_rowCount - 1);
+        m_cache.removeRows(count, m_rowCount - count);
+        m_fetchedRows = qMin(m_fetchedRows, count);
+        invalidateSeekPositions(count);
+        m_rowCount = count;
+        endRemoveRows();
+    }
+
+    emit rowCountChanged();
+}
+
+void SqliteTableModel::waitForRowCount()
+{
+    // Without the first chunk there isn't even an estimate yet, so fetch it right here
+    if(m_firstChunkPending)
+    {
+        m_firstChunkPending = false;
+        cancelLoading();
+        setQueryResult(RowLoader::fetch(makeTask(0, qMax<size_t>(m_chunkSize, 1), true)));
+    }
+
+    if(!m_rowCountEstimated)
+        return;
+
+    // Stop counting in the background and count the rows right here because we need the exact number now
+    cancelRowCount();
+    int count = getQueryRowCount();
+    if(count >= 0)
+        setExactRowCount(count);
+}
+
 int SqliteTableModel::getQueryRowCount()
 {
     // Return -1 if there is an error
@@ -167,21 +440,17 @@ int SqliteTableModel::getQueryRowCount()
         }
     } else {
         // If it is a normal query - hopefully starting with SELECT - just do a COUNT on it and return the results
-        QString sCountQuery = QString("SELECT COUNT(*) FROM (%1);").arg(rtrimChar(m_sQuery, ';'));
+        QString sCountQuery = countQuery();
         m_db.logSQL(sCountQuery, kLogMsg_App);
-        QByteArray utf8Query = sCountQuery.toUtf8();
 
-        sqlite3_stmt* stmt;
-        int status = sqlite3_prepare_v2(m_db._db, utf8Query, utf8Query.size(), &stmt, NULL);
-        if(status == SQLITE_OK)
+        StatementCache::Handle stmt = m_db.prepareCached(sCountQuery);
+        if(stmt.isValid())
         {
-            status = sqlite3_step(stmt);
-            if(status == SQLITE_ROW)
+            if(sqlite3_step(stmt) == SQLITE_ROW)
             {
                 QString sCount = QString::fromUtf8((const char*)sqlite3_column_text(stmt, 0));
                 retval = sCount.toInt();
             }
-            sqlite3_finalize(stmt);
         } else {
             qWarning() << "Count query failed: " << sCountQuery;
         }
@@ -192,7 +461,7 @@ int SqliteTableModel::getQueryRowCount()
 
 int SqliteTableModel::rowCount(const QModelIndex&) const
 {
-    return m_data.size(); // current fetched row count
+    return m_rowCount;
 }
 
 int SqliteTableModel::totalRowCount() const
@@ -230,46 +499,73 @@ QVariant SqliteTableModel::data(const QModelIndex &index, int role) const
     if (index.row() >= m_rowCount)
         return QVariant();
 
-    if(role == Qt::DisplayRole || role == Qt::EditRole)
+    if(role == Qt::DisplayRole || role == Qt::EditRole || role == Qt::FontRole || role == Qt::ForegroundRole || role == Qt::BackgroundRole)
     {
-        // If this row is not in the cache yet get it first
-        while(index.row() >= m_data.size() && canFetchMore())
-            const_cast<SqliteTableModel*>(this)->fetchMore();   // Nothing evil to see here, move along
+        // Get the row from the cache. If it's not in the cache yet, this fetches the chunk it is in first. When fetching in the background,
+        // only request the chunk and return a placeholder for now, unless the actual data is needed for editing.
+        int row;
+        const RowBlock* block;
+        if(m_loader && role != Qt::EditRole)
+        {
+            block = const_cast<SqliteTableModel*>(this)->m_cache.page(index.row(), row);
+            if(!block)
+            {
+                requestChunk(index.row());
+
+                if(role == Qt::DisplayRole)
+                    return tr("loading...");
+                else if(role == Qt::FontRole)
+                {
+                    QFont font;
+                    font.setItalic(true);
+                    return font;
+                }
+                return QVariant();
+            }
+        } else {
+            block = cachedBlock(index.row(), row);
+        }
+        if(!block || index.column() >= block->columnCount())
+            return QVariant();
+
+        // Read the value directly from the block. Only copy it for the roles which return it because the returned variant might outlive
+        // the block.
+        const QByteArray value = (role == Qt::DisplayRole || role == Qt::EditRole) ? block->cell(row, index.column()) : block->cellView(row, index.column());
+        bool binary = isBinary(*block, row, index.column());
 
-        if(role == Qt::DisplayRole && m_data.at(index.row()).at(index.column()).isNull())
+        if(role == Qt::DisplayRole && value.isNull())
         {
             return Settings::getValue("databrowser", "null_text").toString();
-        } else if(role == Qt::DisplayRole && isBinary(index)) {
+        } else if(role == Qt::DisplayRole && binary) {
             return "BLOB";
         } else if(role == Qt::DisplayRole) {
             int limit = Settings::getValue("databrowser", "symbol_limit").toInt();
-            QByteArray displayText = m_data.at(index.row()).at(index.column());
-            if (displayText.length() > limit) {
+            if (value.length() > limit) {
                 // Add "..." to the end of truncated strings
-                return decode(displayText.left(limit).append(" ..."));
+                return decode(value.left(limit).append(" ..."));
             } else {
-                return decode(displayText);
+                return decode(value);
             }
+        } else if(role == Qt::EditRole) {
+            return decode(value);
+        } else if(role == Qt::FontRole) {
+            QFont font;
+            if(value.isNull() || binary)
+                font.setItalic(true);
+            return font;
+        } else if(role == Qt::ForegroundRole) {
+            if(value.isNull())
+                return QColor(Settings::getValue("databrowser", "null_fg_colour").toString());
+            else if (binary)
+                return QColor(Settings::getValue("databrowser", "bin_fg_colour").toString());
+            return QColor(Settings::getValue("databrowser", "reg_fg_colour").toString());
         } else {
-            return decode(m_data.at(index.row()).at(index.column()));
+            if(value.isNull())
+                return QColor(Settings::getValue("databrowser", "null_bg_colour").toString());
+            else if (binary)
+                return QColor(Settings::getValue("databrowser", "bin_bg_colour").toString());
+            return QColor(Settings::getValue("databrowser", "reg_bg_colour").toString());
         }
-    } else if(role == Qt::FontRole) {
-        QFont font;
-        if(m_data.at(index.row()).at(index.column()).isNull() || isBinary(index))
-            font.setItalic(true);
-        return font;
-    } else if(role == Qt::ForegroundRole) {
-        if(m_data.at(index.row()).at(index.column()).isNull())
-            return QColor(Settings::getValue("databrowser", "null_fg_colour").toString());
-        else if (isBinary(index))
-            return QColor(Settings::getValue("databrowser", "bin_fg_colour").toString());
-        return QColor(Settings::getValue("databrowser", "reg_fg_colour").toString());
-    } else if (role == Qt::BackgroundRole) {
-        if(m_data.at(index.row()).at(index.column()).isNull())
-            return QColor(Settings::getValue("databrowser", "null_bg_colour").toString());
-        else if (isBinary(index))
-            return QColor(Settings::getValue("databrowser", "bin_bg_colour").toString());
-        return QColor(Settings::getValue("databrowser", "reg_bg_colour").toString());
     } else if(role == Qt::ToolTipRole) {
         sqlb::ForeignKeyClause fk = getForeignKeyClause(index.column()-1);
         if(fk.isSet())
@@ -327,8 +623,14 @@ bool SqliteTableModel::setTypedData(const QModelIndex& index, bool isBlob, const
 {
     if(index.isValid() && role == Qt::EditRole)
     {
+        int row;
+        const RowBlock* block = cachedBlock(index.row(), row);
+        if(!block)
+            return false;
+
         QByteArray newValue = encode(value.toByteArray());
-        QByteArray oldValue = m_data.at(index.row()).at(index.column());
+        QByteArray oldValue = block->cell(row, index.column());
+        QByteArray rowid = block->cell(row, 0);
 
         // Special handling for integer columns: instead of setting an integer column to an empty string, set it to '0' when it is also
         // used in a primary key. Otherwise SQLite will always output an 'datatype mismatch' error.
@@ -348,11 +650,18 @@ bool SqliteTableModel::setTypedData(const QModelIndex& index, bool isBlob, const
         if(oldValue == newValue && oldValue.isNull() == newValue.isNull())
             return true;
 
-        if(m_db.updateRecord(m_sTable, m_headers.at(index.column()), m_data[index.row()].at(0), newValue, isBlob, m_pseudoPk))
+        if(m_db.updateRecord(m_sTable, m_headers.at(index.column()), rowid, newValue, isBlob, m_pseudoPk))
         {
-            // Only update the cache if this row has already been read, if not there's no need to do any changes to the cache
-            if(index.row() < m_data.size())
-                m_data[index.row()].replace(index.column(), newValue);
+            // Chunks which are being fetched right now might contain the old value
+            cancelLoading();
+
+            // Only update the cache if this row is still cached, if not there's no need to do any changes to the cache
+            QByteArrayList storedValues;
+            QVector<int> storedTypes;
+            if(index.column() > 0 && readStoredRow(rowid, storedValues, storedTypes))
+                m_cache.setCell(index.row(), index.column(), storedValues.at(index.column() - 1), storedTypes.at(index.column() - 1));
+            else
+                m_cache.setCell(index.row(), index.column(), newValue, variantType(value, isBlob));
 
             emit(dataChanged(index, index));
             return true;
@@ -365,14 +674,123 @@ bool SqliteTableModel::setTypedData(const QModelIndex& index, bool isBlob, const
     return false;
 }
 
+bool SqliteTableModel::setDataBlock(const QModelIndex& topLeft, const QList<QVariantList>& values)
+{
+    if(!topLeft.isValid())
+        return false;
+
+    int columns = 0;
+    foreach(const QVariantList& row, values)
+        columns = qMax(columns, row.size());
+
+    QVector<int> columnList;
+    for(int column=topLeft.column();column<topLeft.column()+columns && column<columnCount();column++)
+        columnList.push_back(column);
+
+    return setDataBlock(topLeft.row(), columnList, values);
+}
+
+bool SqliteTableModel::setDataBlock(int firstRow, const QVector<int>& columns, const QList<QVariantList>& values)
+{
+    // Don't even try setting any data if we're not browsing a table, i.e. the model data comes from a custom query
+    if(!isEditable() || firstRow < 0 || columns.isEmpty())
+        return false;
+
+    int rows = qMin(values.size(), m_rowCount - firstRow);
+    if(rows <= 0)
+        return false;
+
+    // Find out for which columns empty strings need to be replaced by '0'. See setTypedData() for details.
+    sqlb::TablePtr table = m_db.getObjectByName(m_sTable).dynamicCast<sqlb::Table>();
+    QStringList columnNames;
+    QVector<bool> zeroForEmpty(columns.size(), false);
+    for(int i=0;i<columns.size();i++)
+    {
+        columnNames.push_back(m_headers.at(columns.at(i)));
+        if(table)
+        {
+            int field_index = table->findField(m_headers.at(columns.at(i)));
+            if(field_index >= 0)
+            {
+                sqlb::FieldPtr field = table->field(field_index);
+                zeroForEmpty[i] = table->primaryKey().contains(field) && field->isInteger();
+            }
+        }
+    }
+
+    // Collect the rowids of the rows to change and prepare the new values
+    QStringList rowids;
+    QList<QByteArrayList> newValues;
+    bool changed = false;
+    for(int i=0;i<rows;i++)
+    {
+        int index;
+        const RowBlock* block = cachedBlock(firstRow + i, index);
+        if(!block)
+            return false;
+
+        rowids.push_back(block->cell(index, 0));
+
+        QByteArrayList rowValues;
+        for(int j=0;j<columns.size() && j<values.at(i).size();j++)
+        {
+            QByteArray newValue = encode(values.at(i).at(j).toByteArray());
+            if(zeroForEmpty.at(j) && newValue == "" && !newValue.isNull())
+                newValue = "0";
+
+            QByteArray oldValue = block->cell(index, columns.at(j));
+            if(oldValue != newValue || oldValue.isNull() != newValue.isNull())
+                changed = true;
+
+            rowValues.push_back(newValue);
+        }
+        newValues.push_back(rowValues);
+    }
+
+    // Don't do anything if the data hasn't changed
+    if(!changed)
+        return true;
+
+    if(m_db.updateRecords(m_sTable, columnNames, rowids, newValues, false, m_pseudoPk))
+    {
+        // Chunks which are being fetched right now might contain the old values
+        cancelLoading();
+
+        int firstColumn = columns.first(), lastColumn = columns.first();
+        for(int i=0;i<newValues.size();i++)
+        {
+            QByteArrayList storedValues;
+            QVector<int> storedTypes;
+            bool stored = readStoredRow(rowids.at(i), storedValues, storedTypes);
+
+            for(int j=0;j<newValues.at(i).size();j++)
+            {
+                int column = columns.at(j);
+                if(stored && column > 0)
+                    m_cache.setCell(firstRow + i, column, storedValues.at(column - 1), storedTypes.at(column - 1));
+                else
+                    m_cache.setCell(firstRow + i, column, newValues.at(i).at(j), variantType(values.at(i).at(j), false));
+                firstColumn = qMin(firstColumn, column);
+                lastColumn = qMax(lastColumn, column);
+            }
+        }
+
+        emit dataChanged(index(firstRow, firstColumn), index(firstRow + rows - 1, lastColumn));
+        return true;
+    } else {
+        QMessageBox::warning(0, qApp->applicationName(), tr("Error changing data:\n%1").arg(m_db.lastError()));
+        return false;
+    }
+}
+
 bool SqliteTableModel::canFetchMore(const QModelIndex&) const
 {
-    return m_data.size() < m_rowCount;
+    return m_fetchedRows < m_rowCount;
 }
 
 void SqliteTableModel::fetchMore(const QModelIndex&)
 {
-    int row = m_data.size();
+    int row = m_fetchedRows;
     fetchData(row, row + m_chunkSize);
 }
 
@@ -418,11 +836,22 @@ bool SqliteTableModel::insertRows(int row, int count, const QModelIndex& parent)
     if(!isEditable())
         return false;
 
+    // Row numbers need to be exact when changing them
+    waitForRowCount();
+
     QByteArrayList blank_data;
     for(int i=0; i < m_headers.size(); ++i)
         blank_data.push_back("");
 
+    // The rowid of tables with a rowid is an integer, the type of the primary key of WITHOUT ROWID tables is looked up below
+    sqlb::TablePtr table = m_db.getObjectByName(m_sTable).dynamicCast<sqlb::Table>();
+    int pkField = (table && table->isWithoutRowidTable()) ? table->findField(table->rowidColumn()) : -1;
+    QVector<int> blank_types(m_headers.size(), SQLITE_TEXT);
+    if(!blank_types.isEmpty())
+        blank_types[0] = SQLITE_INTEGER;
+
     DataType tempList;
+    QList<QVector<int> > tempTypes;
     for(int i=row; i < row + count; ++i)
     {
         QString rowid = m_db.addRecord(m_sTable);
@@ -430,26 +859,35 @@ bool SqliteTableModel::insertRows(int row, int count, const QModelIndex& parent)
         {
             return false;
         }
-        m_rowCount++;
         tempList.append(blank_data);
         tempList[i - row].replace(0, rowid.toUtf8());
+        tempTypes.append(blank_types);
 
         // update column with default values
         QByteArrayList rowdata;
-        if( m_db.getRow(m_sTable, rowid, rowdata) )
+        QVector<int> rowtypes;
+        if( readStoredRow(rowid, rowdata, rowtypes) )
         {
             for(int j=1; j < m_headers.size(); ++j)
             {
                 tempList[i - row].replace(j, rowdata[j - 1]);
+                tempTypes[i - row][j] = rowtypes[j - 1];
             }
+            if(pkField >= 0 && pkField < rowtypes.size())
+                tempTypes[i - row][0] = rowtypes[pkField];
         }
     }
 
+    cancelLoading();
     beginInsertRows(parent, row, row + count - 1);
     for(int i = 0; i < tempList.size(); ++i)
     {
-        m_data.insert(i + row, tempList.at(i));
+        m_cache.insertRow(i + row, tempList.at(i), tempTypes.at(i));
     }
+    m_rowCount += tempList.size();
+    if(row <= m_fetchedRows)
+        m_fetchedRows += tempList.size();
+    invalidateSeekPositions(row);
     endInsertRows();
     return true;
 }
@@ -459,21 +897,35 @@ bool SqliteTableModel::removeRows(int row, int count, const QModelIndex& parent)
     if(!isEditable())
         return false;
 
-    beginRemoveRows(parent, row, row + count - 1);
-
-    bool ok = true;
+    // Row numbers need to be exact when changing them
+    waitForRowCount();
 
+    // Get the rowids of all rows to delete. This might fetch rows which aren't cached at the moment. If any of them can't be fetched,
+    // nothing is removed because otherwise the model and the database wouldn't agree on the rows anymore.
     QStringList rowids;
     for(int i=count-1;i>=0;i--)
     {
-        rowids.append(m_data.at(row + i).at(0));
-        m_data.removeAt(row + i);
-        --m_rowCount;
+        int index;
+        const RowBlock* block = cachedBlock(row + i, index);
+        if(!block)
+            return false;
+        rowids.append(block->cell(index, 0));
     }
+
+    cancelLoading();
+    beginRemoveRows(parent, row, row + count - 1);
+
+    bool ok = true;
+
+    m_cache.removeRows(row, count);
+    m_rowCount -= count;
+    if(row < m_fetchedRows)
+        m_fetchedRows -= qMin(count, m_fetchedRows - row);
     if(!m_db.deleteRecords(m_sTable, rowids))
     {
         ok = false;
     }
+    invalidateSeekPositions(row);
 
     endRemoveRows();
     return ok;
@@ -490,28 +942,57 @@ QModelIndex SqliteTableModel::dittoRecord(int old_row)
 
     sqlb::TablePtr t = m_db.getObjectByName(m_sTable).dynamicCast<sqlb::Table>();
 
+    // Copy all values except the primary key in one go
     sqlb::FieldVector pk = t->primaryKey();
+    QVector<int> columns;
+    QVariantList values;
     for (int col = 0; col < t->fields().size(); ++col) {
         if(!pk.contains(t->fields().at(col))) {
             if (!firstEditedColumn)
                 firstEditedColumn = col + 1;
 
-            QVariant value = data(index(old_row, col + 1), Qt::EditRole);
-            setData(index(new_row, col + 1), value);
+            columns.push_back(col + 1);
+            values.push_back(data(index(old_row, col + 1), Qt::EditRole));
         }
     }
+    if(!columns.isEmpty())
+        setDataBlock(new_row, columns, QList<QVariantList>() << values);
 
     return index(new_row, firstEditedColumn);
 }
 
-void SqliteTableModel::fetchData(unsigned int from, unsigned to)
+RowLoader::Task SqliteTableModel::makeTask(unsigned int from, unsigned int to, bool synchronous) const
 {
-    int currentsize = m_data.size();
+    // The chunks of the loader are fetched one after the other, so they can all share the same read connection. Chunks which are fetched
+    // synchronously get a connection of their own because a connection of the pool must only be used by one thread at a time and the
+    // loader might be interrupted while they are being fetched. PRAGMA statements might return settings of the main connection though,
+    // so execute them there.
+    bool pragma = m_sQuery.startsWith("PRAGMA", Qt::CaseInsensitive) || m_sQuery.startsWith("EXPLAIN", Qt::CaseInsensitive);
+    ConnectionPool::Handle& connection = synchronous ? m_syncConnection : m_readConnection;
+    if(!pragma)
+        connection = m_db.readConnection(connection);
+
+    RowLoader::Task task;
+    task.db = pragma ? ConnectionPool::wrap(m_db._db) : connection;
+    task.generation = m_generation;
+    task.from = from;
+    task.to = to;
+    task.columns = m_headers.size();
+    task.sortColumn = m_keysetPagination ? m_iSortColumn : -1;
+
+    // Use keyset pagination if we know where the previous chunk ended. In this case we can seek directly to the position after it.
+    bool seek = m_keysetPagination && from > 0 && m_seekPositions.contains(from);
 
     QString sLimitQuery;
-    if(m_sQuery.startsWith("PRAGMA", Qt::CaseInsensitive) || m_sQuery.startsWith("EXPLAIN", Qt::CaseInsensitive))
+    if(pragma)
     {
         sLimitQuery = m_sQuery;
+    } else if(seek) {
+        sLimitQuery = buildKeysetQuery(from, to);
+
+        const SeekPosition& position = m_seekPositions[from];
+        task.bindings.push_back(position.sortKey);
+        task.bindings.push_back(position.rowid);
     } else {
         // Remove trailing trailing semicolon
         QString queryTemp = rtrimChar(m_sQuery, ';');
@@ -523,49 +1004,263 @@ void SqliteTableModel::fetchData(unsigned int from, unsigned to)
             sLimitQuery = queryTemp + QString(" LIMIT %1, %2;").arg(from).arg(to-from);
     }
     m_db.logSQL(sLimitQuery, kLogMsg_App);
-    QByteArray utf8Query = sLimitQuery.toUtf8();
-    sqlite3_stmt *stmt;
-    int status = sqlite3_prepare_v2(m_db._db, utf8Query, utf8Query.size(), &stmt, NULL);
+    task.query = sLimitQuery.toUtf8();
 
-    if(SQLITE_OK == status)
+    return task;
+}
+
+void SqliteTableModel::fetchData(unsigned int from, unsigned to)
+{
+    storeChunk(RowLoader::fetch(makeTask(from, to, true)));
+}
+
+void SqliteTableModel::storeChunk(const RowLoader::Result& result)
+{
+    // Check if there was any new data
+    if(!result.ok || result.rows.isEmpty())
+        return;
+
+    // Remember where this chunk ended so the next one can be fetched by seeking to this position
+    if(m_keysetPagination)
     {
-        while(sqlite3_step(stmt) == SQLITE_ROW)
-        {
-            QByteArrayList rowdata;
-            for (int i = 0; i < m_headers.size(); ++i)
-            {
-                if(sqlite3_column_type(stmt, i) == SQLITE_NULL)
-                {
-                    rowdata.append(QByteArray());
-                } else {
-                    int bytes = sqlite3_column_bytes(stmt, i);
-                    if(bytes)
-                        rowdata.append(QByteArray(static_cast<const char*>(sqlite3_column_blob(stmt, i)), bytes));
-                    else
-                        rowdata.append(QByteArray(""));
-                }
-            }
-            m_data.push_back(rowdata);
-        }
+        SeekPosition position;
+        position.sortKey = result.lastSortKey;
+        position.rowid = result.lastRowid;
+        m_seekPositions.insert(result.from + result.rows.rowCount(), position);
     }
-    sqlite3_finalize(stmt);
 
-    // Check if there was any new data
-    if(m_data.size() > currentsize)
+    // Keep track of how many rows at the beginning of the result set have been fetched
+    if(result.from <= static_cast<unsigned int>(m_fetchedRows))
+        m_fetchedRows = qMax(m_fetchedRows, static_cast<int>(result.from) + result.rows.rowCount());
+
+    m_cache.insertPage(result.from, result.rows);
+}
+
+void SqliteTableModel::handleChunkFetched(const RowLoader::Result& result)
+{
+    // Ignore the chunk if it has been requested for an older query or before the data was modified
+    if(result.generation != m_generation)
+        return;
+
+    // The first chunk of a new query decides about the initial number of rows
+    if(m_firstChunkPending && result.from == 0)
     {
-        beginInsertRows(QModelIndex(), currentsize, m_data.size()-1);
-        endInsertRows();
+        m_firstChunkPending = false;
+        setQueryResult(result);
+        return;
     }
+
+    storeChunk(result);
+
+    // Repaint the placeholder cells
+    int last = qMin(static_cast<int>(result.from) + result.rows.rowCount(), m_rowCount) - 1;
+    if(last >= static_cast<int>(result.from))
+        emit dataChanged(index(result.from, 0), index(last, m_headers.size() - 1));
+}
+
+void SqliteTableModel::requestChunk(int row) const
+{
+    if(!m_loader || m_loadingPaused || row < 0 || row >= m_rowCount || m_cache.contains(row))
+        return;
+
+    // Chunks are always aligned to the chunk size. This way each row belongs to exactly one chunk.
+    size_t chunkSize = qMax<size_t>(m_chunkSize, 1);
+    unsigned int from = row - row % chunkSize;
+    if(!m_loader->isPending(m_generation, from))
+        m_loader->enqueue(makeTask(from, from + chunkSize));
+}
+
+void SqliteTableModel::triggerCacheLoad(int firstRow, int lastRow, bool forward)
+{
+    if(!m_loader)
+        return;
+
+    // Continue counting the rows if this has been stopped before
+    requestRowCount();
+
+    // Fetch the visible rows first and then the chunk behind them in the scroll direction. The loader fetches the chunk requested
+    // last first, so the order of these calls matters.
+    size_t chunkSize = qMax<size_t>(m_chunkSize, 1);
+    if(forward)
+        requestChunk(lastRow + chunkSize);
+    else
+        requestChunk(firstRow - static_cast<int>(chunkSize));
+    requestChunk(lastRow);
+    requestChunk(firstRow);
+}
+
+void SqliteTableModel::setAsyncFetching(bool enabled)
+{
+    if(enabled && !m_loader && RowLoader::isSupported())
+    {
+        m_loader = new RowLoader(this);
+        connect(m_loader, &RowLoader::fetched, this, &SqliteTableModel::handleChunkFetched, Qt::QueuedConnection);
+
+        // The rows are counted in a separate thread because this might take much longer than fetching a chunk
+        m_counter = new RowLoader(this);
+        connect(m_counter, &RowLoader::fetched, this, &SqliteTableModel::handleRowCountFetched, Qt::QueuedConnection);
+    } else if(!enabled && m_loader) {
+        stopLoading();
+        delete m_loader;
+        m_loader = nullptr;
+        delete m_counter;
+        m_counter = nullptr;
+    }
+}
+
+void SqliteTableModel::cancelLoading()
+{
+    // Throw away all chunks which are still being fetched. Their data might be outdated by the time they arrive.
+    m_generation++;
+    if(m_loader)
+    {
+        m_loader->cancel();
+
+        // The model stays empty without the first chunk, so fetch it again for the new generation
+        if(m_firstChunkPending && !m_loadingPaused)
+            m_loader->enqueue(makeTask(0, qMax<size_t>(m_chunkSize, 1)));
+    }
+}
+
+void SqliteTableModel::setLoadingPaused(bool paused)
+{
+    if(paused == m_loadingPaused)
+        return;
+    m_loadingPaused = paused;
+
+    if(paused)
+    {
+        // Wait for the chunk which is being fetched right now and throw it away. Whether the first chunk is still missing is remembered.
+        m_generation++;
+        if(m_loader)
+            m_loader->stop();
+        cancelRowCount();
+    } else {
+        if(m_firstChunkPending && m_loader)
+            m_loader->enqueue(makeTask(0, qMax<size_t>(m_chunkSize, 1)));
+        requestRowCount();
+
+        // Repainting the placeholder cells requests their chunks again
+        if(m_rowCount > 0 && !m_headers.isEmpty())
+            emit dataChanged(index(0, 0), index(m_rowCount - 1, m_headers.size() - 1));
+    }
+}
+
+void SqliteTableModel::stopLoading()
+{
+    m_firstChunkPending = false;
+    cancelLoading();
+    if(m_loader)
+        m_loader->stop();
+    cancelRowCount();
+
+    // Hand back the read connections, the database might be about to be closed
+    m_readConnection = ConnectionPool::Handle();
+    m_countConnection = ConnectionPool::Handle();
+    m_syncConnection = ConnectionPool::Handle();
+}
+
+void SqliteTableModel::cancelRowCount()
+{
+    // Counting the rows might take a while before SQLite checks for the cancel flag, so interrupt it. The row count stays marked as an
+    // estimate, so counting is started again when the user scrolls the next time.
+    m_countGeneration++;
+    m_countPending = false;
+    if(m_counter)
+        m_counter->interrupt();
+}
+
+const RowBlock* SqliteTableModel::cachedBlock(int row, int& index) const
+{
+    // Fetching a chunk doesn't change the data of the model, it only fills the cache. Nothing evil to see here, move along.
+    SqliteTableModel* that = const_cast<SqliteTableModel*>(this);
+
+    const RowBlock* block = that->m_cache.page(row, index);
+    if(!block && row >= 0 && row < m_rowCount)
+    {
+        // Fetch the entire chunk this row is in. This way jumping to any row only fetches the data around it.
+        size_t chunkSize = qMax<size_t>(m_chunkSize, 1);
+        unsigned int from = row - row % chunkSize;
+        that->fetchData(from, from + chunkSize);
+        block = that->m_cache.page(row, index);
+    }
+
+    return block;
+}
+
+void SqliteTableModel::invalidateSeekPositions(int row)
+{
+    // Inserting or removing rows changes the row numbers of all chunks after the modified row, so forget about their positions
+    auto it = m_seekPositions.upperBound(row);
+    while(it != m_seekPositions.end())
+        it = m_seekPositions.erase(it);
+}
+
+bool SqliteTableModel::isKeysetPaginationPossible() const
+{
+    // We need a unique and non-NULL column to break ties between rows with the same sort key. This is the rowid column of ordinary tables
+    // and the primary key of WITHOUT ROWID tables if it consists of exactly one column. Views and virtual tables are excluded because we
+    // can't rely on their rowid values.
+    sqlb::TablePtr table = m_db.getObjectByName(m_sTable).dynamicCast<sqlb::Table>();
+    if(!table || table->isVirtual() || !m_pseudoPk.isEmpty())
+        return false;
+    if(table->isWithoutRowidTable() && table->primaryKey().size() != 1)
+        return false;
+
+    // When display formats are set the sort column is not selected in its raw form, so we can't use its values for seeking
+    if(!m_vDisplayFormat.isEmpty())
+        return false;
+
+    return m_iSortColumn >= 0 && m_iSortColumn < m_headers.size();
+}
+
+QString SqliteTableModel::buildKeysetQuery(unsigned int from, unsigned int to) const
+{
+    // Parameter ?1 is the sort key and ?2 the rowid of the last row of the previous chunk. Because SQLite sorts NULL values first, these need
+    // some special care: in ascending order they come before all other values, in descending order they come last.
+    const SeekPosition& position = m_seekPositions[from];
+    bool ascending = m_sSortOrder == "ASC";
+    QString rowid = sqlb::escapeIdentifier(m_headers.at(0));
+    QString seek;
+    if(m_iSortColumn == 0)
+    {
+        seek = QString("%1 %2 ?2").arg(rowid).arg(ascending ? ">" : "<");
+    } else {
+        QString key = sqlb::escapeIdentifier(m_headers.at(m_iSortColumn));
+        if(ascending)
+        {
+            if(position.sortKey.type == SQLITE_NULL)
+                seek = QString("(%1 IS NULL AND %2 > ?2) OR %1 IS NOT NULL").arg(key).arg(rowid);
+            else
+                seek = QString("%1 >= ?1 AND (%1 > ?1 OR %2 > ?2)").arg(key).arg(rowid);
+        } else {
+            if(position.sortKey.type == SQLITE_NULL)
+                seek = QString("%1 IS NULL AND %2 < ?2").arg(key).arg(rowid);
+            else
+                seek = QString("(%1 <= ?1 AND (%1 < ?1 OR %2 < ?2)) OR %1 IS NULL").arg(key).arg(rowid);
+        }
+    }
+
+    // Note: The filter conditions may contain '%' characters, so don't arg() them into the string
+    QString where = "WHERE ";
+    if(!m_sKeysetWhere.isEmpty())
+        where += "(" + m_sKeysetWhere + ") AND ";
+    where += "(" + seek + ") ";
+
+    return m_sKeysetSelect + where + m_sKeysetOrder + QString(" LIMIT %1;").arg(to - from);
 }
 
 void SqliteTableModel::buildQuery()
+{
+    setQuery(buildQueryString(), true);
+}
+
+QString SqliteTableModel::buildQueryString()
 {
     QString where;
 
     if(m_mWhere.size())
     {
-        where = "WHERE ";
-
         for(QMap<int, QString>::const_iterator i=m_mWhere.constBegin();i!=m_mWhere.constEnd();++i)
         {
             QString column;
@@ -590,19 +1285,30 @@ void SqliteTableModel::buildQuery()
         selector.chop(1);
     }
 
+    // For keyset pagination the rows need to be in a deterministic order, so break ties between equal sort keys using the rowid column
+    m_keysetPagination = isKeysetPaginationPossible();
+    QString order = QString("ORDER BY %1 %2")
+            .arg(sqlb::escapeIdentifier(m_headers.at(m_iSortColumn)))
+            .arg(m_sSortOrder);
+    if(m_keysetPagination && m_iSortColumn != 0)
+        order.append(QString(", %1 %2").arg(sqlb::escapeIdentifier(m_headers.at(0))).arg(m_sSortOrder));
+
     // Note: Building the SQL string is intentionally split into several parts here instead of arg()'ing it all together as one.
     // The reason is that we're adding '%' characters automatically around search terms (and even if we didn't the user could add
     // them manually) which means that e.g. searching for '1' results in another '%1' in the string which then totally confuses
     // the QString::arg() function, resulting in an invalid SQL.
-    QString sql = QString("SELECT %1,%2 FROM %3 ")
+    m_sKeysetSelect = QString("SELECT %1,%2 FROM %3 ")
             .arg(sqlb::escapeIdentifier(m_headers.at(0)))
             .arg(selector)
-            .arg(m_sTable.toString())
-            + where
-            + QString("ORDER BY %1 %2")
-            .arg(sqlb::escapeIdentifier(m_headers.at(m_iSortColumn)))
-            .arg(m_sSortOrder);
-    setQuery(sql, true);
+            .arg(m_sTable.toString());
+    m_sKeysetWhere = where;
+    m_sKeysetOrder = order;
+
+    QString sql = m_sKeysetSelect;
+    if(!where.isEmpty())
+        sql += "WHERE " + where;
+    sql += order;
+    return sql;
 }
 
 void SqliteTableModel::removeCommentsFromQuery(QString& query) {
@@ -666,6 +1372,8 @@ void SqliteTableModel::removeCommentsFromQuery(QString& query) {
 
 QStringList SqliteTableModel::getColumns(const QString& sQuery, QVector<int>& fieldsTypes)
 {
+    // This can be any query typed by the user, so it's not put into the statement cache where it would only push out the statements
+    // which are actually executed again
     sqlite3_stmt* stmt;
     QByteArray utf8Query = sQuery.toUtf8();
     int status = sqlite3_prepare_v2(m_db._db, utf8Query, utf8Query.size(), &stmt, NULL);
@@ -687,6 +1395,13 @@ QStringList SqliteTableModel::getColumns(const QString& sQuery, QVector<int>& fi
 
 void SqliteTableModel::updateFilter(int column, const QString& value)
 {
+    // Remember the previous filter value of this column for checking whether the new one only narrows down the current rows
+    QString oldValue = m_mFilterValues.value(column);
+    if(value.isEmpty())
+        m_mFilterValues.remove(column);
+    else
+        m_mFilterValues.insert(column, value);
+
     // Check for any special comparison operators at the beginning of the value string. If there are none default to LIKE.
     QString op = "LIKE";
     QString val, val2;
@@ -788,23 +1503,159 @@ void SqliteTableModel::updateFilter(int column, const QString& value)
         m_mWhere.insert(column, whereClause);
     }
 
+    // If the new filter only narrows down the rows which are all in the cache anyway, there's no need to ask SQLite
+    if(isFilterRefinement(oldValue, value) && filterCachedRows(column, value))
+        return;
+
     // Build the new query
     buildQuery();
 }
 
+bool SqliteTableModel::isSubstringFilter(const QString& value)
+{
+    // This returns true for filter values which updateFilter() turns into a 'LIKE %value%' condition without any wildcards or escape
+    // characters in the value itself. Only these are simple enough for being evaluated outside of SQLite.
+    if(value.isEmpty() || value.startsWith('<') || value.startsWith('>') || value.startsWith('='))
+        return false;
+    if(value.contains('~') || value.contains('%') || value.contains('_'))
+        return false;
+
+    QString escape_character = Settings::getValue("databrowser", "filter_escape").toString();
+    return escape_character.isEmpty() || !value.contains(escape_character);
+}
+
+bool SqliteTableModel::isFilterRefinement(const QString& oldValue, const QString& newValue)
+{
+    // The new filter is a refinement of the old one if every row matching the new filter also matches the old one. For substring
+    // searches this is the case if the new value contains the old one. LIKE is case insensitive for ASCII characters only, so that's
+    // all the case folding we do here.
+    if(!isSubstringFilter(newValue) || oldValue == newValue)
+        return false;
+    if(oldValue.isEmpty())
+        return true;
+    return isSubstringFilter(oldValue) && asciiToLower(newValue.toUtf8()).contains(asciiToLower(oldValue.toUtf8()));
+}
+
+bool SqliteTableModel::filterCachedRows(int column, const QString& value)
+{
+    // This only works if all rows of the current result set are in memory and if they are stored in the same encoding as the filter value
+    if(!m_valid || m_rowCountEstimated || m_rowCount == 0 || !m_encoding.isEmpty() || !m_cache.containsRange(0, m_rowCount))
+        return false;
+
+    // Apply the filter to the cached rows. The matching rows are stored in blocks of the chunk size because fetching the chunks of the
+    // new query from the database works the same way if they get evicted from the cache later.
+    size_t chunkSize = qMax<size_t>(m_chunkSize, 1);
+    QByteArray needle = asciiToLower(value.toUtf8());
+    QList<RowBlock> filtered;
+    int matches = 0;
+    for(int row=0;row<m_rowCount;)
+    {
+        int index;
+        const RowBlock* block = m_cache.page(row, index);
+        for(;index<block->rowCount() && row<m_rowCount;index++,row++)
+        {
+            if(block->isNull(index, column) || !asciiToLower(block->cellView(index, column)).contains(needle))
+                continue;
+
+            if(filtered.isEmpty() || static_cast<size_t>(filtered.last().rowCount()) >= chunkSize)
+                filtered.push_back(RowBlock(m_headers.size()));
+            filtered.last().appendRow(*block, index);
+            matches++;
+        }
+    }
+
+    // Replace the rows of the old query by the filtered ones
+    QString query = buildQueryString();
+
+    beginRemoveRows(QModelIndex(), 0, m_rowCount - 1);
+    m_rowCount = 0;
+    endRemoveRows();
+    cancelLoading();
+    m_cache.clear();
+    m_seekPositions.clear();
+    m_sQuery = query;
+
+    for(int i=0;i<filtered.size();i++)
+        m_cache.insertPage(i * chunkSize, filtered.at(i));
+    m_fetchedRows = matches;
+    if(matches > 0)
+    {
+        beginInsertRows(QModelIndex(), 0, matches - 1);
+        m_rowCount = matches;
+        endInsertRows();
+    }
+
+    emit rowCountChanged();
+    return true;
+}
+
 void SqliteTableModel::clearCache()
 {
-	if(!m_data.empty())
+	if(m_rowCount > 0)
 	{
-		beginRemoveRows(QModelIndex(), 0, m_data.size() - 1);
-		m_data.clear();
+		beginRemoveRows(QModelIndex(), 0, m_rowCount - 1);
+		m_rowCount = 0;
 		endRemoveRows();
 	}
+	m_firstChunkPending = false;
+	cancelLoading();
+	cancelRowCount();
+	m_rowCountEstimated = false;
+	m_cache.clear();
+	m_fetchedRows = 0;
+	m_seekPositions.clear();
 }
 
 bool SqliteTableModel::isBinary(const QModelIndex& index) const
 {
-    return m_data.at(index.row()).at(index.column()).left(1024).contains('\0');
+    int row;
+    const RowBlock* block = cachedBlock(index.row(), row);
+    if(!block || index.column() >= block->columnCount())
+        return false;
+    return isBinary(*block, row, index.column());
+}
+
+bool SqliteTableModel::isBinary(const RowBlock& block, int row, int column)
+{
+    // Numbers never contain binary data, so only look at the actual data for text and BLOB values
+    int type = block.type(row, column);
+    if(type == SQLITE_NULL || type == SQLITE_INTEGER || type == SQLITE_FLOAT)
+        return false;
+    return block.cellView(row, column).left(1024).contains('\0');
+}
+
+bool SqliteTableModel::readStoredRow(const QString& rowid, QByteArrayList& values, QVector<int>& types) const
+{
+    // Views are changed using a pseudo primary key and the values end up in whatever tables the triggers of the view write to
+    if(!m_pseudoPk.isEmpty())
+        return false;
+
+    // The first column of the model is the rowid, all others are the columns of the table in their original order
+    if(!m_db.getRow(m_sTable, rowid, values, &types))
+        return false;
+    return values.size() >= m_headers.size() - 1;
+}
+
+int SqliteTableModel::variantType(const QVariant& value, bool isBlob)
+{
+    if(value.isNull())
+        return SQLITE_NULL;
+    if(isBlob)
+        return SQLITE_BLOB;
+
+    switch(value.type())
+    {
+    case QVariant::Bool:
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        return SQLITE_INTEGER;
+    case QVariant::Double:
+        return SQLITE_FLOAT;
+    default:
+        return SQLITE_TEXT;
+    }
 }
 
 QByteArray SqliteTableModel::encode(const QByteArray& str) const
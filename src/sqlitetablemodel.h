@@ -6,6 +6,8 @@
 #include <QVector>
 
 #include "sqlitetypes.h"
+#include "RowCache.h"
+#include "RowLoader.h"
 
 class DBBrowserDB;
 
@@ -19,15 +21,28 @@ class SqliteTableModel : public QAbstractTableModel
 
 public:
     explicit SqliteTableModel(DBBrowserDB& db, QObject *parent = 0, size_t chunkSize = 50000, const QString& encoding = QString());
+    ~SqliteTableModel();
     void reset();
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     int totalRowCount() const;
+
+    // When fetching in the background the first rows are shown before the exact number of rows is known. Until the rows have been
+    // counted, rowCount() and totalRowCount() return an estimate.
+    bool rowCountAvailable() const { return !m_rowCountEstimated && !m_firstChunkPending; }
+    void waitForRowCount();
+    int fetchedRowCount() const { return m_fetchedRows; }
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
     bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
     bool setTypedData(const QModelIndex& index, bool isBlob, const QVariant& value, int role = Qt::EditRole);
+
+    // Changes a whole block of cells at once. This is a lot faster than calling setData() for each cell because all values are written
+    // in one savepoint and dataChanged() is only emitted once. The values contain one list per row, starting at the given row. Values
+    // which don't fit into the table are ignored. The first version changes consecutive columns starting at the column of topLeft.
+    bool setDataBlock(const QModelIndex& topLeft, const QList<QVariantList>& values);
+    bool setDataBlock(int firstRow, const QVector<int>& columns, const QList<QVariantList>& values);
     bool canFetchMore(const QModelIndex &parent = QModelIndex()) const;
     void fetchMore(const QModelIndex &parent = QModelIndex());
     size_t queryMore(size_t offset);
@@ -38,9 +53,29 @@ public:
     QModelIndex dittoRecord(int old_row);
 
     void setQuery(const QString& sQuery, bool dontClearHeaders = false);
+
+    // Setting a query without executing it in the calling thread. prepareQuery() sets up the model for the query and returns the task for
+    // fetching the first chunk. This can be executed in another thread using RowLoader::fetch() and its result is then handed to
+    // setQueryResult() which makes the rows show up. All other chunks are fetched in the background as usual. If the query can't be
+    // prepared, the returned task has no columns and the error message of the connection tells why.
+    RowLoader::Task prepareQuery(const QString& sQuery, const ConnectionPool::Handle& db);
+    void setQueryResult(const RowLoader::Result& first);
     QString query() const { return m_sQuery; }
     void setTable(const sqlb::ObjectIdentifier& table, int sortColumn = 0, Qt::SortOrder sortOrder = Qt::AscendingOrder, const QVector<QString> &display_format = QVector<QString>());
     void setChunkSize(size_t chunksize);
+    void setCacheMemoryBudget(size_t bytes);
+
+    // When asynchronous fetching is enabled, chunks which haven't been fetched yet are loaded by a worker thread. Until they arrive the
+    // display roles return placeholder values. The edit role always returns the actual data and fetches it synchronously if necessary.
+    void setAsyncFetching(bool enabled);
+    bool asyncFetching() const { return m_loader != nullptr; }
+
+    // While loading is paused no chunks are fetched and the rows aren't counted. Everything which is still missing is requested again
+    // when resuming.
+    void setLoadingPaused(bool paused);
+
+    // Requests the chunks containing the given rows as well as the chunk after them in the scroll direction from the worker thread
+    void triggerCacheLoad(int firstRow, int lastRow, bool forward);
     void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
     const sqlb::ObjectIdentifier& currentTableName() const { return m_sTable; }
 
@@ -69,29 +104,79 @@ public:
     // Helper function for removing all comments from a SQL query
     static void removeCommentsFromQuery(QString& query);
 
+signals:
+    void rowCountChanged();
+
 public slots:
     void updateFilter(int column, const QString& value);
 
+    // Stops all background fetching. This needs to be called before the database connection is closed.
+    void stopLoading();
+
 protected:
     virtual Qt::DropActions supportedDropActions() const;
     virtual bool dropMimeData(const QMimeData* data, Qt::DropAction action, int row, int column, const QModelIndex& parent);
 
+private slots:
+    void handleChunkFetched(const RowLoader::Result& result);
+    void handleRowCountFetched(const RowLoader::Result& result);
+
 private:
     void fetchData(unsigned int from, unsigned to);
+    RowLoader::Task makeTask(unsigned int from, unsigned int to, bool synchronous = false) const;
+    void storeChunk(const RowLoader::Result& result);
+    void requestChunk(int row) const;
+    void cancelLoading();
+    void requestRowCount();
+    void cancelRowCount();
     void clearCache();
+    const RowBlock* cachedBlock(int row, int& index) const;
+    static bool isBinary(const RowBlock& block, int row, int column);
 
     void buildQuery();
+    QString buildQueryString();
+
+    // Evaluation of filters on the rows in the cache
+    static bool isSubstringFilter(const QString& value);
+    static bool isFilterRefinement(const QString& oldValue, const QString& newValue);
+    bool filterCachedRows(int column, const QString& value);
+
     QStringList getColumns(const QString& sQuery, QVector<int>& fieldsTypes);
     int getQueryRowCount();
+    void setQueryWithEstimatedRowCount(const QString& sQuery, bool dontClearHeaders);
+    int estimateRowCount() const;
+    qint64 querySingleInteger(const QString& query) const;
+    QString countQuery() const;
+    void setExactRowCount(int count);
+
+    // Keyset (or seek) pagination. When browsing a table the data is ordered by the sort column and then by the rowid column. For each
+    // chunk that has been fetched we remember the values of these two columns in its last row. The chunk after it can then be fetched
+    // by seeking right behind this position instead of making SQLite step over and discard all the rows before it using an OFFSET.
+    typedef RowLoader::SeekValue SeekValue;
+    struct SeekPosition
+    {
+        SeekValue sortKey;
+        SeekValue rowid;
+    };
+    bool isKeysetPaginationPossible() const;
+    void invalidateSeekPositions(int row);
+    QString buildKeysetQuery(unsigned int from, unsigned int to) const;
+
+    // SQLite converts new values according to the affinity of their columns, e.g. '01' is stored as the integer 1 in an INTEGER column.
+    // This reads the values and data types of a row back as they have been stored, so the cache holds the same data as the database.
+    // It only works for tables. Otherwise variantType() guesses the data type of a new value.
+    bool readStoredRow(const QString& rowid, QByteArrayList& values, QVector<int>& types) const;
+    static int variantType(const QVariant& value, bool isBlob);
 
     QByteArray encode(const QByteArray& str) const;
     QByteArray decode(const QByteArray& str) const;
 
     DBBrowserDB& m_db;
     int m_rowCount;
+    int m_fetchedRows;      //! Number of rows at the start of the result set which have been fetched by fetchMore() or at least once
     QStringList m_headers;
     typedef QList<QByteArrayList> DataType;
-    DataType m_data;
+    RowCache m_cache;       //! Sparse cache for the row data. Only the blocks around the rows accessed most recently are kept in memory
 
     QString m_sQuery;
     sqlb::ObjectIdentifier m_sTable;
@@ -100,16 +185,37 @@ private:
     int m_iSortColumn;
     QString m_sSortOrder;
     QMap<int, QString> m_mWhere;
+    QMap<int, QString> m_mFilterValues;     //! The filter values as entered by the user
     QVector<QString> m_vDisplayFormat;
     QVector<int> m_vDataTypes;
 
+    bool m_keysetPagination;            //! true if the chunks of the current table can be fetched using keyset pagination
+    QString m_sKeysetSelect;            //! SELECT ... FROM ... part of the browse query
+    QString m_sKeysetWhere;             //! Filter conditions of the browse query, without the WHERE keyword
+    QString m_sKeysetOrder;             //! ORDER BY ... part of the browse query
+    QMap<unsigned int, SeekPosition> m_seekPositions;   //! Maps the first row of a chunk to the position of the last row before it
+
+    mutable ConnectionPool::Handle m_readConnection;    //! Connection for fetching the chunks
+    mutable ConnectionPool::Handle m_countConnection;   //! Connection for counting the rows
+    mutable ConnectionPool::Handle m_syncConnection;    //! Connection for fetching chunks in the GUI thread while the loader might be using its own
+
+    RowLoader* m_loader;    //! Worker thread for fetching chunks in the background or nullptr if asynchronous fetching is disabled
+    int m_generation;       //! Incremented whenever chunks which are being fetched in the background become outdated
+    RowLoader* m_counter;   //! Worker thread for counting the rows in the background
+    int m_countGeneration;  //! Incremented whenever a row count which is being determined in the background becomes outdated
+    bool m_rowCountEstimated;   //! true while m_rowCount is only an estimate
+    bool m_countPending;        //! true while the rows are being counted in the background
+    bool m_firstChunkPending;   //! true while the first chunk of a new query is being fetched in the background. The model is empty until then.
+    bool m_loadingPaused;
+
     /**
      * @brief m_chunkSize Size of the next chunk fetch more will try to fetch.
-     * This value should be rather high, because our query
-     * uses LIMIT and sqlite3 will still execute the whole query and
+     * This value should be rather high, because for custom queries
+     * we use LIMIT and sqlite3 will still execute the whole query and
      * just skip the not wanted rows, but the execution will
      * still take nearly the same time as doing the query at all up
-     * to that row count.
+     * to that row count. When browsing tables keyset pagination is
+     * used if possible which doesn't suffer from this problem.
      */
     size_t m_chunkSize;
 
@@ -1,4 +1,5 @@
 #include "sqlitetypes.h"
+#include "DdlParser.h"
 #include "grammar/Sqlite3Lexer.hpp"
 #include "grammar/Sqlite3Parser.hpp"
 
@@ -419,6 +420,15 @@ bool Table::hasAutoIncrement() const
 }
 
 ObjectPtr Table::parseSQL(const QString &sSQL)
+{
+    TablePtr table = DdlParser::parseTable(sSQL);
+    if(table)
+        return table;
+
+    return parseSQLWithGrammar(sSQL);
+}
+
+ObjectPtr Table::parseSQLWithGrammar(const QString &sSQL)
 {
     std::stringstream s;
     s << sSQL.toStdString();
@@ -873,7 +883,7 @@ TablePtr CreateTableWalker::table()
                     tc = tc->getNextSibling(); // skip LPAREN
 
                     int num_paren = 1;
-                    QString expr;
+                    QStringList expr;
                     while(tc)
                     {
                         if(tc->getType() == sqlite3TokenTypes::LPAREN)
@@ -889,7 +899,7 @@ TablePtr CreateTableWalker::table()
                         tc = tc->getNextSibling();
                     }
 
-                    check->setExpression(expr);
+                    check->setExpression(expr.join(" "));
                     tab->addConstraint(FieldVector(), ConstraintPtr(check));
                 }
                 break;
@@ -1049,6 +1059,10 @@ void CreateTableWalker::parsecolumn(Table* table, antlr::RefAST c)
         break;
         case sqlite3TokenTypes::COLLATE:
         {
+            // TODO Support constraint names here
+            if(!constraint_name.isEmpty())
+                table->setFullyParsed(false);
+
             con = con->getNextSibling();    // COLLATE
             collation = identifier(con);
             con = con->getNextSibling();    // collation name
@@ -1191,6 +1205,15 @@ FieldInfoList Index::fieldInformation() const
 }
 
 ObjectPtr Index::parseSQL(const QString& sSQL)
+{
+    IndexPtr index = DdlParser::parseIndex(sSQL);
+    if(index)
+        return index;
+
+    return parseSQLWithGrammar(sSQL);
+}
+
+ObjectPtr Index::parseSQLWithGrammar(const QString& sSQL)
 {
     std::stringstream s;
     s << sSQL.toStdString();
@@ -1292,17 +1315,25 @@ void CreateIndexWalker::parsecolumn(Index* index, antlr::RefAST c)
 
     // First count the number of nodes used for the name or the expression. We reach the end of the name nodes list when we either
     // get to the end of the list, get to a COMMA or a RPAREN, or get to the COLLATE keyword or get to the ASC/DESC keywords.
+    // Parentheses belonging to the expression itself, e.g. in function calls, are skipped.
     // Then see how many items there are: if it's one it's a normal index column with only a column name. In this case get the identifier.
     // If it's more than one item it's an expression. In this case get all the items as they are.
     int number_of_name_items = 0;
+    int num_paren = 0;
     antlr::RefAST n = c;
     while(n != antlr::nullAST
-          && n->getType() != sqlite3TokenTypes::COLLATE
-          && n->getType() != sqlite3TokenTypes::ASC
-          && n->getType() != sqlite3TokenTypes::DESC
-          && n->getType() != sqlite3TokenTypes::COMMA
-          && n->getType() != sqlite3TokenTypes::RPAREN)
+          && (num_paren > 0
+              || (n->getType() != sqlite3TokenTypes::COLLATE
+                  && n->getType() != sqlite3TokenTypes::ASC
+                  && n->getType() != sqlite3TokenTypes::DESC
+                  && n->getType() != sqlite3TokenTypes::COMMA
+                  && n->getType() != sqlite3TokenTypes::RPAREN)))
     {
+        if(n->getType() == sqlite3TokenTypes::LPAREN)
+            num_paren++;
+        else if(n->getType() == sqlite3TokenTypes::RPAREN)
+            num_paren--;
+
         number_of_name_items++;
         n = n->getNextSibling();
     }
@@ -1314,7 +1345,7 @@ void CreateIndexWalker::parsecolumn(Index* index, antlr::RefAST c)
     } else {
         for(int i=0;i<number_of_name_items;i++)
         {
-            name += c->getText().c_str() + QString(" ");
+            name += textAST(c) + QString(" ");
             c = c->getNextSibling();
         }
         name.chop(1);
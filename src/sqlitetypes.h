@@ -401,11 +401,19 @@ public:
     int findPk() const;
 
     /**
-     * @brief parseSQL Parses the create Table statement in sSQL.
+     * @brief parseSQL Parses the create Table statement in sSQL. The hand-written parser is tried first, the
+     * antlr based parser is only used for statements which it doesn't support.
      * @param sSQL The create table statement.
      * @return The table object. The table object may be empty if parsing failed.
      */
     static ObjectPtr parseSQL(const QString& sSQL);
+
+    /**
+     * @brief parseSQLWithGrammar Parses the create Table statement in sSQL using the antlr based parser only.
+     * @param sSQL The create table statement.
+     * @return The table object. The table object may be empty if parsing failed.
+     */
+    static ObjectPtr parseSQLWithGrammar(const QString& sSQL);
 private:
     QStringList fieldList() const;
     bool hasAutoIncrement() const;
@@ -482,12 +490,20 @@ public:
     QString sql(const QString& schema = QString("main"), bool ifNotExists = false) const;
 
     /**
-     * @brief parseSQL Parses the CREATE INDEX statement in sSQL.
+     * @brief parseSQL Parses the CREATE INDEX statement in sSQL. The hand-written parser is tried first, the
+     * antlr based parser is only used for statements which it doesn't support.
      * @param sSQL The create index statement.
      * @return The index object. The index object may be empty if the parsing failed.
      */
     static ObjectPtr parseSQL(const QString& sSQL);
 
+    /**
+     * @brief parseSQLWithGrammar Parses the CREATE INDEX statement in sSQL using the antlr based parser only.
+     * @param sSQL The create index statement.
+     * @return The index object. The index object may be empty if the parsing failed.
+     */
+    static ObjectPtr parseSQLWithGrammar(const QString& sSQL);
+
     virtual FieldInfoList fieldInformation() const;
 
 private:
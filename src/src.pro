@@ -14,8 +14,8 @@ QMAKE_CXXFLAGS += -std=c++11
 CONFIG(unittest) {
   QT += testlib
 
-  HEADERS += tests/testsqlobjects.h tests/TestImport.h tests/TestRegex.h
-  SOURCES += tests/testsqlobjects.cpp tests/TestImport.cpp tests/TestMain.cpp tests/TestRegex.cpp
+  HEADERS += tests/testsqlobjects.h tests/TestImport.h tests/TestRegex.h tests/TestStatementCache.h
+  SOURCES += tests/testsqlobjects.cpp tests/TestImport.cpp tests/TestMain.cpp tests/TestRegex.cpp tests/TestStatementCache.cpp
 } else {
   SOURCES += main.cpp
 }
@@ -57,7 +57,19 @@ HEADERS += \
     PlotDock.h \
     RemoteDock.h \
     RemoteModel.h \
-    RemotePushDialog.h
+    RemotePushDialog.h \
+    RowCache.h \
+    RowLoader.h \
+    StatementCache.h \
+    TableDumper.h \
+    ConnectionPool.h \
+    SchemaParser.h \
+    DdlParser.h \
+    SqlExecutor.h \
+    QueryProfiler.h \
+    ProfilerDock.h \
+    QueryPlanDialog.h \
+    SqlCompletionIndex.h
 
 SOURCES += \
     sqlitedb.cpp \
@@ -93,7 +105,19 @@ SOURCES += \
     PlotDock.cpp \
     RemoteDock.cpp \
     RemoteModel.cpp \
-    RemotePushDialog.cpp
+    RemotePushDialog.cpp \
+    RowCache.cpp \
+    RowLoader.cpp \
+    StatementCache.cpp \
+    TableDumper.cpp \
+    ConnectionPool.cpp \
+    SchemaParser.cpp \
+    DdlParser.cpp \
+    SqlExecutor.cpp \
+    QueryProfiler.cpp \
+    ProfilerDock.cpp \
+    QueryPlanDialog.cpp \
+    SqlCompletionIndex.cpp
 
 RESOURCES += icons/icons.qrc \
              translations/flags/flags.qrc \
@@ -116,7 +140,9 @@ FORMS += \
     ColumnDisplayFormatDialog.ui \
     PlotDock.ui \
     RemoteDock.ui \
-    RemotePushDialog.ui
+    RemotePushDialog.ui \
+    ProfilerDock.ui \
+    QueryPlanDialog.ui
 
 TRANSLATIONS += \
     translations/sqlb_ar_SA.ts \
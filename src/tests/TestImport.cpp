@@ -1,6 +1,7 @@
 // force QtCore-only main application by QTEST_MAIN
 #undef QT_GUI_LIB
 #include <QTemporaryFile>
+#include <QTextCodec>
 #include <QtTest/QTest>
 #include <QCoreApplication>
 #include <QTextStream>
@@ -58,6 +59,89 @@ void TestImport::csvImport()
     QCOMPARE(parsedCsv, result);
 }
 
+void TestImport::csvImportFile()
+{
+    // Same as above but parse the file directly instead of going through a stream
+    QFETCH(QString, csv);
+    QFETCH(char, separator);
+    QFETCH(char, quote);
+    QFETCH(QString, encoding);
+    QFETCH(int, numfields);
+    QFETCH(QVector<QStringList>, result);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    {
+        QTextStream out(&file);
+        out.setCodec(encoding.toUtf8());
+        out << csv;
+    }
+    file.flush();
+    file.seek(0);
+
+    CSVParser csvparser(true, separator, quote);
+
+    QVector<QStringList> parsedCsv;
+    int parsedCsvColumns = 0;
+    csvparser.parse([&parsedCsv, &parsedCsvColumns](size_t /*rowNum*/, const QStringList& data) -> bool {
+        parsedCsv.push_back(data);
+        if(data.size() > parsedCsvColumns)
+            parsedCsvColumns = data.size();
+        return true;
+    }, file, QTextCodec::codecForName(encoding.toUtf8()));
+
+    QCOMPARE(parsedCsvColumns, numfields);
+    QCOMPARE(parsedCsv, result);
+}
+
+void TestImport::csvImportFile_data()
+{
+    csvImport_data();
+}
+
+void TestImport::csvImportFields()
+{
+    // Same as above but using the field views instead of string lists
+    QFETCH(QString, csv);
+    QFETCH(char, separator);
+    QFETCH(char, quote);
+    QFETCH(QString, encoding);
+    QFETCH(int, numfields);
+    QFETCH(QVector<QStringList>, result);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    {
+        QTextStream out(&file);
+        out.setCodec(encoding.toUtf8());
+        out << csv;
+    }
+    file.flush();
+    file.seek(0);
+
+    CSVParser csvparser(true, separator, quote);
+
+    QVector<QStringList> parsedCsv;
+    int parsedCsvColumns = 0;
+    csvparser.parseFields([&parsedCsv, &parsedCsvColumns](size_t /*rowNum*/, const CSVParser::Field* fields, size_t count) -> bool {
+        QStringList data;
+        for(size_t i=0;i<count;i++)
+            data << QString::fromUtf8(fields[i].data, fields[i].size);
+        parsedCsv.push_back(data);
+        if(data.size() > parsedCsvColumns)
+            parsedCsvColumns = data.size();
+        return true;
+    }, file, QTextCodec::codecForName(encoding.toUtf8()));
+
+    QCOMPARE(parsedCsvColumns, numfields);
+    QCOMPARE(parsedCsv, result);
+}
+
+void TestImport::csvImportFields_data()
+{
+    csvImport_data();
+}
+
 void TestImport::csvImport_data()
 {
     QTest::addColumn<QString>("csv");
@@ -160,3 +244,73 @@ void TestImport::csvImport_data()
                                << 3
                                << result;
 }
+
+void TestImport::csvFieldType()
+{
+    QFETCH(QByteArray, value);
+    QFETCH(int, type);
+
+    QCOMPARE(static_cast<int>(CSVParser::fieldType(value.constData(), value.size())), type);
+}
+
+void TestImport::csvFieldType_data()
+{
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<int>("type");
+
+    QTest::newRow("empty") << QByteArray("") << static_cast<int>(CSVParser::FieldTypeEmpty);
+    QTest::newRow("integer") << QByteArray("12345") << static_cast<int>(CSVParser::FieldTypeInteger);
+    QTest::newRow("negative_integer") << QByteArray("-42") << static_cast<int>(CSVParser::FieldTypeInteger);
+    QTest::newRow("zero") << QByteArray("0") << static_cast<int>(CSVParser::FieldTypeInteger);
+    QTest::newRow("largest_integer") << QByteArray("9223372036854775807") << static_cast<int>(CSVParser::FieldTypeInteger);
+    QTest::newRow("smallest_integer") << QByteArray("-9223372036854775808") << static_cast<int>(CSVParser::FieldTypeInteger);
+    QTest::newRow("too_large_integer") << QByteArray("9223372036854775808") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("leading_zero") << QByteArray("007") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("plus_sign") << QByteArray("+1") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real") << QByteArray("3.14") << static_cast<int>(CSVParser::FieldTypeReal);
+    QTest::newRow("real_leading_zero") << QByteArray("0.5") << static_cast<int>(CSVParser::FieldTypeReal);
+    QTest::newRow("negative_real") << QByteArray("-0.25") << static_cast<int>(CSVParser::FieldTypeReal);
+    QTest::newRow("negative_zero") << QByteArray("-0") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_exponent") << QByteArray("-1.5e+10") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_exponent_only") << QByteArray("1e5") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_trailing_zero") << QByteArray("1.50") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_zero_fraction") << QByteArray("2.0") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_too_precise") << QByteArray("0.1234567890123456") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_small") << QByteArray("0.0001") << static_cast<int>(CSVParser::FieldTypeReal);
+    QTest::newRow("real_too_small") << QByteArray("0.00001") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_no_fraction") << QByteArray("1.") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("real_no_integer_part") << QByteArray(".5") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("text") << QByteArray("abc") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("number_with_text") << QByteArray("12abc") << static_cast<int>(CSVParser::FieldTypeText);
+    QTest::newRow("blob") << QByteArray("a\0b", 3) << static_cast<int>(CSVParser::FieldTypeBlob);
+}
+
+void TestImport::csvInferTypes()
+{
+    // The second column only contains real numbers after the first records and the third one only contains values there, so these
+    // types can only be determined from the samples of the rest of the file
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    {
+        QTextStream out(&file);
+        out << "id,value,comment,nothing\n";
+        for(int i=0;i<20000;i++)
+        {
+            if(i < 2000)
+                out << i << "," << i << ",,\n";
+            else
+                out << i << "," << i << ".5,text " << i << ",\n";
+        }
+    }
+    file.flush();
+    file.seek(0);
+
+    CSVParser csvparser(true, ',', '"');
+    QVector<CSVParser::FieldType> types = csvparser.inferTypes(file, QTextCodec::codecForName("UTF-8"), true);
+
+    QCOMPARE(types.size(), 4);
+    QCOMPARE(types.at(0), CSVParser::FieldTypeInteger);
+    QCOMPARE(types.at(1), CSVParser::FieldTypeReal);
+    QCOMPARE(types.at(2), CSVParser::FieldTypeText);
+    QCOMPARE(types.at(3), CSVParser::FieldTypeEmpty);
+}
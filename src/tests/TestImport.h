@@ -14,6 +14,13 @@ public:
 private slots:
     void csvImport();
     void csvImport_data();
+    void csvImportFile();
+    void csvImportFile_data();
+    void csvImportFields();
+    void csvImportFields_data();
+    void csvFieldType();
+    void csvFieldType_data();
+    void csvInferTypes();
 };
 
 #endif
@@ -0,0 +1,144 @@
+// force QtCore-only main application by QTEST_MAIN
+#undef QT_GUI_LIB
+#include <QtTest/QTest>
+#include <QCoreApplication>
+
+#include "StatementCache.h"
+#include "sqlite.h"
+#include "TestStatementCache.h"
+
+QTEST_MAIN(TestStatementCache)
+
+void TestStatementCache::init()
+{
+    QCOMPARE(sqlite3_open(":memory:", &db), SQLITE_OK);
+    QCOMPARE(sqlite3_exec(db, "CREATE TABLE t(a INTEGER); INSERT INTO t VALUES(1); INSERT INTO t VALUES(2);", NULL, NULL, NULL), SQLITE_OK);
+}
+
+void TestStatementCache::cleanup()
+{
+    sqlite3_close(db);
+}
+
+void TestStatementCache::normalize_data()
+{
+    QTest::addColumn<QString>("sql");
+    QTest::addColumn<QByteArray>("normalized");
+
+    QTest::newRow("whitespace")
+            << QString("  SELECT\t*\n\n  FROM   t  ")
+            << QByteArray("SELECT * FROM t");
+    QTest::newRow("semicolons")
+            << QString("SELECT * FROM t; ;\n")
+            << QByteArray("SELECT * FROM t");
+    QTest::newRow("string")
+            << QString("SELECT 'a  b' ,  \"c  d\"")
+            << QByteArray("SELECT 'a  b' , \"c  d\"");
+    QTest::newRow("escaped_quote")
+            << QString("SELECT 'it''s  here'  FROM t")
+            << QByteArray("SELECT 'it''s  here' FROM t");
+    QTest::newRow("identifiers")
+            << QString("SELECT [a  b],  `c  d` FROM t")
+            << QByteArray("SELECT [a  b], `c  d` FROM t");
+    QTest::newRow("comments")
+            << QString("SELECT /* a  b */  1 --  c  d\nFROM t")
+            << QByteArray("SELECT /* a  b */ 1 --  c  d\nFROM t");
+    QTest::newRow("unterminated")
+            << QString("SELECT 'a  b")
+            << QByteArray("SELECT 'a  b");
+}
+
+void TestStatementCache::normalize()
+{
+    QFETCH(QString, sql);
+    QFETCH(QByteArray, normalized);
+
+    QCOMPARE(StatementCache::normalize(sql), normalized);
+}
+
+void TestStatementCache::reuse()
+{
+    StatementCache cache;
+
+    sqlite3_stmt* stmt;
+    {
+        StatementCache::Handle handle = cache.acquire(db, "SELECT a FROM t");
+        QVERIFY(handle.isValid());
+        stmt = handle.get();
+    }
+
+    // Different whitespace and a trailing semicolon still find the same statement
+    StatementCache::Handle handle = cache.acquire(db, "SELECT  a\nFROM t;");
+    QCOMPARE(handle.get(), stmt);
+    QCOMPARE(cache.size(), 1);
+    QCOMPARE(cache.hits(), quint64(1));
+    QCOMPARE(cache.misses(), quint64(1));
+
+    // Statements which can't be prepared aren't cached
+    QVERIFY(!cache.acquire(db, "SELECT b FROM t").isValid());
+    QCOMPARE(cache.size(), 1);
+}
+
+void TestStatementCache::eviction()
+{
+    StatementCache cache(2);
+
+    cache.acquire(db, "SELECT 1");
+    cache.acquire(db, "SELECT 2");
+    cache.acquire(db, "SELECT 1");      // Now "SELECT 2" is the least recently used statement
+    cache.acquire(db, "SELECT 3");
+    QCOMPARE(cache.size(), 2);
+    QCOMPARE(cache.hits(), quint64(1));
+    QCOMPARE(cache.misses(), quint64(3));
+
+    cache.acquire(db, "SELECT 1");
+    QCOMPARE(cache.hits(), quint64(2));
+    cache.acquire(db, "SELECT 2");
+    QCOMPARE(cache.misses(), quint64(4));
+
+    // Statements which are in use aren't evicted. The cache grows temporarily instead.
+    {
+        StatementCache::Handle a = cache.acquire(db, "SELECT 4");
+        StatementCache::Handle b = cache.acquire(db, "SELECT 5");
+        StatementCache::Handle c = cache.acquire(db, "SELECT 6");
+        QCOMPARE(cache.size(), 3);
+    }
+    QCOMPARE(cache.size(), 2);
+
+    cache.clear();
+    QCOMPARE(cache.size(), 0);
+}
+
+void TestStatementCache::inUse()
+{
+    StatementCache cache;
+
+    StatementCache::Handle first = cache.acquire(db, "SELECT a FROM t");
+    StatementCache::Handle second = cache.acquire(db, "SELECT a FROM t");
+    QVERIFY(second.isValid());
+    QVERIFY(first.get() != second.get());
+    QCOMPARE(cache.size(), 1);
+    QCOMPARE(cache.misses(), quint64(2));
+}
+
+void TestStatementCache::release()
+{
+    StatementCache cache;
+
+    {
+        StatementCache::Handle handle = cache.acquire(db, "SELECT a, ? FROM t ORDER BY a");
+        QCOMPARE(sqlite3_bind_int(handle, 1, 42), SQLITE_OK);
+        QCOMPARE(sqlite3_step(handle), SQLITE_ROW);
+        QCOMPARE(sqlite3_column_int(handle, 0), 1);
+        QCOMPARE(sqlite3_column_int(handle, 1), 42);
+        QCOMPARE(sqlite3_step(handle), SQLITE_ROW);
+        QCOMPARE(sqlite3_column_int(handle, 0), 2);
+    }
+
+    // The statement starts at the first row again and the value bound before is gone
+    StatementCache::Handle handle = cache.acquire(db, "SELECT a, ? FROM t ORDER BY a");
+    QCOMPARE(cache.hits(), quint64(1));
+    QCOMPARE(sqlite3_step(handle), SQLITE_ROW);
+    QCOMPARE(sqlite3_column_int(handle, 0), 1);
+    QCOMPARE(sqlite3_column_type(handle, 1), SQLITE_NULL);
+}
@@ -0,0 +1,27 @@
+#ifndef TESTSTATEMENTCACHE_H
+#define TESTSTATEMENTCACHE_H
+
+#include <QObject>
+
+struct sqlite3;
+
+class TestStatementCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void normalize();
+    void normalize_data();
+    void reuse();
+    void eviction();
+    void inUse();
+    void release();
+
+private:
+    sqlite3* db;
+};
+
+#endif
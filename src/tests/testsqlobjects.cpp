@@ -1,5 +1,6 @@
 #include "testsqlobjects.h"
 #include "../sqlitetypes.h"
+#include "../DdlParser.h"
 
 #include <QtTest/QtTest>
 
@@ -7,6 +8,125 @@ QTEST_APPLESS_MAIN(TestTable)
 
 using namespace sqlb;
 
+namespace
+{
+// All parser tests run once for the hand-written parser and once for the antlr based parser, depending on the global test data
+bool parseTable(const QString& sql, Table& table)
+{
+    QFETCH_GLOBAL(bool, fastParser);
+    TablePtr result = fastParser ? DdlParser::parseTable(sql) : TablePtr(Table::parseSQLWithGrammar(sql).dynamicCast<Table>());
+    if(!result)
+        return false;
+    table = *result;
+    return true;
+}
+
+bool parseIndex(const QString& sql, Index& index)
+{
+    QFETCH_GLOBAL(bool, fastParser);
+    IndexPtr result = fastParser ? DdlParser::parseIndex(sql) : IndexPtr(Index::parseSQLWithGrammar(sql).dynamicCast<Index>());
+    if(!result)
+        return false;
+    index = *result;
+    return true;
+}
+
+// Returns pairs of a flag which is true for CREATE TABLE statements and false for CREATE INDEX statements, and the statement itself
+QVector<QPair<bool, QString>> schemaCorpus()
+{
+    // Statements in the styles of schemata found in the wild: generated by this application, by ORMs, by other tools and written by hand
+    const QStringList tables = QStringList()
+            << "CREATE TABLE \"table%1\" (\n"
+               "\t`id`\tINTEGER PRIMARY KEY AUTOINCREMENT,\n"
+               "\t`name`\tTEXT NOT NULL DEFAULT 'unnamed' COLLATE NOCASE,\n"
+               "\t`price`\tNUMERIC(10,2) CHECK(price >= 0),\n"
+               "\t`created`\tDATETIME DEFAULT CURRENT_TIMESTAMP,\n"
+               "\t`parent`\tINTEGER REFERENCES \"table%1\"(id) ON DELETE CASCADE,\n"
+               "\t`flags`\tINTEGER NOT NULL DEFAULT 0,\n"
+               "\tUNIQUE(`name`,`parent`)\n"
+               ");"
+            << "CREATE TABLE \"auth_user%1\" (\"id\" integer NOT NULL PRIMARY KEY AUTOINCREMENT, \"password\" varchar(128) NOT NULL, "
+               "\"last_login\" datetime NULL, \"is_superuser\" bool NOT NULL, \"username\" varchar(150) NOT NULL UNIQUE, "
+               "\"first_name\" varchar(30) NOT NULL, \"last_name\" varchar(150) NOT NULL, \"email\" varchar(254) NOT NULL, "
+               "\"is_staff\" bool NOT NULL, \"is_active\" bool NOT NULL, \"date_joined\" datetime NOT NULL)"
+            << "CREATE TABLE \"auth_user_groups%1\" (\"id\" integer NOT NULL PRIMARY KEY AUTOINCREMENT, "
+               "\"user_id\" integer NOT NULL REFERENCES \"auth_user%1\" (\"id\") DEFERRABLE INITIALLY DEFERRED, "
+               "\"group_id\" integer NOT NULL REFERENCES \"auth_group\" (\"id\") DEFERRABLE INITIALLY DEFERRED)"
+            << "CREATE TABLE [Track%1]\n"
+               "(\n"
+               "    [TrackId] INTEGER  NOT NULL,\n"
+               "    [Name] NVARCHAR(200)  NOT NULL,\n"
+               "    [AlbumId] INTEGER,\n"
+               "    [MediaTypeId] INTEGER  NOT NULL,\n"
+               "    [Composer] NVARCHAR(220),\n"
+               "    [Milliseconds] INTEGER  NOT NULL,\n"
+               "    [UnitPrice] NUMERIC(10,2)  NOT NULL,\n"
+               "    CONSTRAINT [PK_Track] PRIMARY KEY  ([TrackId]),\n"
+               "    FOREIGN KEY ([AlbumId]) REFERENCES [Album] ([AlbumId]) \n"
+               "\t\tON DELETE NO ACTION ON UPDATE NO ACTION,\n"
+               "    FOREIGN KEY ([MediaTypeId]) REFERENCES [MediaType] ([MediaTypeId]) \n"
+               "\t\tON DELETE NO ACTION ON UPDATE NO ACTION\n"
+               ");"
+            << "CREATE TABLE moz_places%1 (id INTEGER PRIMARY KEY, url LONGVARCHAR, title LONGVARCHAR, rev_host LONGVARCHAR, "
+               "visit_count INTEGER DEFAULT 0, hidden INTEGER DEFAULT 0 NOT NULL, typed INTEGER DEFAULT 0 NOT NULL, "
+               "frecency INTEGER DEFAULT -1 NOT NULL, last_visit_date INTEGER , guid TEXT, foreign_count INTEGER DEFAULT 0 NOT NULL, "
+               "url_hash INTEGER DEFAULT 0 NOT NULL, description TEXT, preview_image_url TEXT)"
+            << "CREATE TABLE IF NOT EXISTS settings%1 (key TEXT NOT NULL, value BLOB, PRIMARY KEY(key)) WITHOUT ROWID"
+            << "CREATE TABLE \"schema_migrations%1\" (\"version\" varchar NOT NULL PRIMARY KEY)"
+            << "create table order_items%1 (\n"
+               "  order_id integer not null references orders(id) on delete cascade,\n"
+               "  product_id integer not null references products(id),\n"
+               "  quantity integer not null default 1 check (quantity > 0),\n"
+               "  unit_price real not null check (unit_price >= 0.0),\n"
+               "  discount double precision default (0.0),\n"
+               "  note,\n"
+               "  constraint order_items_pk primary key (order_id, product_id),\n"
+               "  constraint order_items_total check (quantity * unit_price < 1000000)\n"
+               ")"
+            << "CREATE TEMP TABLE `log%1` (`id` INTEGER PRIMARY KEY, `time` INTEGER NOT NULL DEFAULT (strftime('%s','now')), "
+               "`level` TEXT CHECK(`level` IN ('debug','info','warning','error')), `message` TEXT, `data` BLOB DEFAULT x'00')"
+            << "CREATE TABLE contacts%1 ( -- Address book\n"
+               "    _id INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+               "    name_raw_contact_id INTEGER REFERENCES raw_contacts(_id),\n"
+               "    photo_id INTEGER REFERENCES data(_id),\n"
+               "    custom_ringtone TEXT,\n"
+               "    send_to_voicemail INTEGER NOT NULL DEFAULT 0,\n"
+               "    times_contacted INTEGER NOT NULL DEFAULT 0,\n"
+               "    last_time_contacted INTEGER,\n"
+               "    starred INTEGER NOT NULL DEFAULT 0, /* favourites */\n"
+               "    lookup TEXT,\n"
+               "    UNIQUE (lookup, name_raw_contact_id)\n"
+               ");";
+
+    const QStringList indexes = QStringList()
+            << "CREATE INDEX `table%1_name` ON `table%1` (`name` ASC, `created` DESC) WHERE flags != 0;"
+            << "CREATE INDEX \"auth_user_groups%1_user_id_6a12ed8b\" ON \"auth_user_groups%1\" (\"user_id\")"
+            << "CREATE UNIQUE INDEX \"auth_user_groups%1_user_id_group_id_94350c0c_uniq\" ON \"auth_user_groups%1\" (\"user_id\", \"group_id\")"
+            << "CREATE INDEX [IFK_TrackAlbumId%1] ON [Track%1] ([AlbumId])"
+            << "CREATE UNIQUE INDEX moz_places%1_url_uniqueindex ON moz_places%1 (url_hash, url)"
+            << "CREATE INDEX moz_places%1_hostindex ON moz_places%1 (rev_host)"
+            << "CREATE INDEX IF NOT EXISTS moz_places%1_frecencyindex ON moz_places%1 (frecency DESC)"
+            << "create index order_items%1_total on order_items%1 (quantity * unit_price)"
+            << "CREATE INDEX `log%1_level` ON `log%1` (lower(`level`), `time`) WHERE `level` <> 'debug'"
+            << "CREATE INDEX contacts%1_starred ON contacts%1 (starred, times_contacted DESC, last_time_contacted);";
+
+    QVector<QPair<bool, QString>> statements;
+    for(int i=0;i<100;i++)
+    {
+        statements << qMakePair(true, tables.at(i % tables.size()).arg(i));
+        statements << qMakePair(false, indexes.at(i % indexes.size()).arg(i));
+    }
+    return statements;
+}
+}
+
+void TestTable::initTestCase_data()
+{
+    QTest::addColumn<bool>("fastParser");
+    QTest::newRow("hand-written") << true;
+    QTest::newRow("antlr") << false;
+}
+
 void TestTable::sqlOutput()
 {
     Table tt("testtable");
@@ -118,7 +238,8 @@ void TestTable::parseSQL()
             "\tinfo VARCHAR(255) CHECK (info == 'x')\n"
             ");";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QVERIFY(tab.name() == "hero");
     QVERIFY(tab.rowidColumn() == "_rowid_");
@@ -147,7 +268,8 @@ void TestTable::parseSQLdefaultexpr()
             "date datetime default CURRENT_TIMESTAMP,"
             "zoi integer)";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QCOMPARE(tab.name(), QString("chtest"));
     QCOMPARE(tab.fields().at(0)->name(), QString("id"));
@@ -180,7 +302,8 @@ void TestTable::parseSQLMultiPk()
             "PRIMARY KEY(`id1`,`id2`)\n"
             ");";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QVERIFY(tab.name() == "hero");
     QVERIFY(tab.fields().at(0)->name() == "id1");
@@ -197,7 +320,8 @@ void TestTable::parseSQLForeignKey()
 {
     QString sSQL = "CREATE TABLE grammar_test(id, test, FOREIGN KEY(test) REFERENCES other_table);";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QVERIFY(tab.name() == "grammar_test");
     QVERIFY(tab.fields().at(0)->name() == "id");
@@ -208,7 +332,8 @@ void TestTable::parseSQLSingleQuotes()
 {
     QString sSQL = "CREATE TABLE 'test'('id','test');";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QVERIFY(tab.name() == "test");
     QVERIFY(tab.fields().at(0)->name() == "id");
@@ -219,7 +344,8 @@ void TestTable::parseSQLKeywordInIdentifier()
 {
     QString sSQL = "CREATE TABLE deffered(key integer primary key, if text);";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QVERIFY(tab.name() == "deffered");
     QVERIFY(tab.fields().at(0)->name() == "key");
@@ -230,7 +356,8 @@ void TestTable::parseSQLWithoutRowid()
 {
     QString sSQL = "CREATE TABLE test(a integer primary key, b integer) WITHOUT ROWID;";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QVERIFY(tab.fields().at(tab.findPk())->name() == "a");
     QVERIFY(tab.rowidColumn() == "a");
@@ -243,7 +370,8 @@ void TestTable::parseNonASCIIChars()
             "PRIMARY KEY(`Fieldöäüß`)"
             ");";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
 
     QVERIFY(tab.name() == "lösung");
     QVERIFY(tab.fields().at(0)->name() == "Fieldöäüß");
@@ -253,7 +381,8 @@ void TestTable::parseSQLEscapedQuotes()
 {
     QString sSql = "CREATE TABLE double_quotes(a text default 'a''a');";
 
-    Table tab = *(Table::parseSQL(sSql).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSql, tab));
 
     QCOMPARE(tab.name(), QString("double_quotes"));
     QCOMPARE(tab.fields().at(0)->name(), QString("a"));
@@ -264,7 +393,8 @@ void TestTable::parseSQLForeignKeys()
 {
     QString sql = "CREATE TABLE foreign_key_test(a int, b int, foreign key (a) references x, foreign key (b) references w(y,z) on delete set null);";
 
-    Table tab = *(Table::parseSQL(sql).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sql, tab));
 
     QCOMPARE(tab.name(), QString("foreign_key_test"));
     QCOMPARE(tab.fields().at(0)->name(), QString("a"));
@@ -279,7 +409,8 @@ void TestTable::parseSQLCheckConstraint()
 {
     QString sql = "CREATE TABLE a (`b` text CHECK(`b`='A' or `b`='B'));";
 
-    Table tab = *(Table::parseSQL(sql).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sql, tab));
 
     QCOMPARE(tab.name(), QString("a"));
     QCOMPARE(tab.fields().at(0)->name(), QString("b"));
@@ -291,7 +422,8 @@ void TestTable::parseDefaultValues()
 {
     QString sql = "CREATE TABLE test(a int DEFAULT 0, b int DEFAULT -1, c text DEFAULT 'hello', d text DEFAULT '0');";
 
-    Table tab = *(Table::parseSQL(sql).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sql, tab));
 
     QCOMPARE(tab.name(), QString("test"));
     QCOMPARE(tab.fields().at(0)->name(), QString("a"));
@@ -315,7 +447,8 @@ void TestTable::createTableWithIn()
             "value NVARCHAR(5) CHECK (value IN ('a', 'b', 'c'))"
             ");";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
     QVERIFY(tab.name() == "not_working");
 
     QVERIFY(tab.fields().at(1)->check() == "value IN ( 'a' , 'b' , 'c' )");
@@ -333,7 +466,8 @@ void TestTable::createTableWithNotLikeConstraint()
             "value7 INTEGER CONSTRAINT 'value' CHECK(NOT EXISTS (1))\n"
             ");";
 
-    Table tab = *(Table::parseSQL(sSQL).dynamicCast<sqlb::Table>());
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
     QVERIFY(tab.name() == "hopefully_working");
 
     QVERIFY(tab.fields().at(0)->check() == "value NOT LIKE 'prefix%'");
@@ -344,3 +478,115 @@ void TestTable::createTableWithNotLikeConstraint()
     QVERIFY(tab.fields().at(5)->check() == "value6 NOT BETWEEN 1 AND 100");
     QVERIFY(tab.fields().at(6)->check() == "NOT EXISTS ( 1 )");
 }
+
+void TestTable::parseTableCheckConstraint()
+{
+    QString sSQL = "CREATE TABLE t(a integer, b integer, CHECK(a > b AND (b > 0)));";
+
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
+
+    QCOMPARE(tab.name(), QString("t"));
+    QCOMPARE(tab.constraint(FieldVector(), Constraint::CheckConstraintType).dynamicCast<CheckConstraint>()->expression(), QString("a > b AND ( b > 0 )"));
+}
+
+void TestTable::parseNamedCollation()
+{
+    QString sSQL = "CREATE TABLE t(a text CONSTRAINT c COLLATE NOCASE, b text COLLATE BINARY);";
+
+    Table tab("");
+    QVERIFY(parseTable(sSQL, tab));
+
+    QCOMPARE(tab.fields().at(0)->collation(), QString("NOCASE"));
+    QCOMPARE(tab.fields().at(1)->collation(), QString("BINARY"));
+
+    // The constraint name can't be stored
+    QVERIFY(!tab.fullyParsed());
+}
+
+void TestTable::parseIndex()
+{
+    QString sSQL = "CREATE UNIQUE INDEX IF NOT EXISTS `idx` ON 'tab' (a ASC, \"b\" DESC, c) WHERE a > 0;";
+
+    Index idx("");
+    QVERIFY(parseIndex(sSQL, idx));
+
+    QCOMPARE(idx.name(), QString("idx"));
+    QCOMPARE(idx.table(), QString("tab"));
+    QVERIFY(idx.unique());
+    QVERIFY(idx.fullyParsed());
+    QCOMPARE(idx.columns().size(), 3);
+    QCOMPARE(idx.columns().at(0)->name(), QString("a"));
+    QCOMPARE(idx.columns().at(0)->order(), QString("ASC"));
+    QCOMPARE(idx.columns().at(1)->name(), QString("b"));
+    QCOMPARE(idx.columns().at(1)->order(), QString("DESC"));
+    QCOMPARE(idx.columns().at(2)->name(), QString("c"));
+    QCOMPARE(idx.columns().at(2)->order(), QString(""));
+    QVERIFY(!idx.columns().at(2)->expression());
+    QCOMPARE(idx.whereExpr(), QString("a > 0"));
+}
+
+void TestTable::parseIndexExpression()
+{
+    QString sSQL = "CREATE INDEX idx ON tab(lower(name) DESC, a + b);";
+
+    Index idx("");
+    QVERIFY(parseIndex(sSQL, idx));
+
+    QCOMPARE(idx.columns().size(), 2);
+    QVERIFY(idx.columns().at(0)->expression());
+    QCOMPARE(idx.columns().at(0)->name(), QString("lower ( name )"));
+    QCOMPARE(idx.columns().at(0)->order(), QString("DESC"));
+    QVERIFY(idx.columns().at(1)->expression());
+    QCOMPARE(idx.columns().at(1)->name(), QString("a + b"));
+    QVERIFY(idx.fullyParsed());
+}
+
+void TestTable::parseFallback()
+{
+    // The hand-written parser leaves these to the antlr based parser
+    QString sVirtual = "CREATE VIRTUAL TABLE test USING fts4(a, b);";
+    QVERIFY(DdlParser::parseTable(sVirtual).isNull());
+    Table tab = *(Table::parseSQL(sVirtual).dynamicCast<sqlb::Table>());
+    QCOMPARE(tab.name(), QString("test"));
+    QVERIFY(tab.isVirtual());
+
+    QString sConflict = "CREATE TABLE test(a integer PRIMARY KEY ON CONFLICT REPLACE, b text);";
+    QVERIFY(DdlParser::parseTable(sConflict).isNull());
+    tab = *(Table::parseSQL(sConflict).dynamicCast<sqlb::Table>());
+    QCOMPARE(tab.name(), QString("test"));
+    QCOMPARE(tab.fields().size(), 2);
+}
+
+void TestTable::parseSchemaBenchmark()
+{
+    QFETCH_GLOBAL(bool, fastParser);
+
+    const QVector<QPair<bool, QString>> statements = schemaCorpus();
+
+    // Make sure the hand-written parser doesn't simply give up on these statements
+    for(const auto& statement : statements)
+    {
+        if(statement.first)
+            QVERIFY(!DdlParser::parseTable(statement.second).isNull());
+        else
+            QVERIFY(!DdlParser::parseIndex(statement.second).isNull());
+    }
+
+    QBENCHMARK
+    {
+        for(const auto& statement : statements)
+        {
+            bool table = statement.first;
+            const QString& sql = statement.second;
+            if(fastParser && table)
+                DdlParser::parseTable(sql);
+            else if(fastParser)
+                DdlParser::parseIndex(sql);
+            else if(table)
+                Table::parseSQLWithGrammar(sql);
+            else
+                Index::parseSQLWithGrammar(sql);
+        }
+    }
+}
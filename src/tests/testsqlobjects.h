@@ -7,6 +7,8 @@ class TestTable: public QObject
 {
     Q_OBJECT
 private slots:
+    void initTestCase_data();
+
     void sqlOutput();
     void autoincrement();
     void notnull();
@@ -28,6 +30,14 @@ private slots:
     void parseDefaultValues();
     void createTableWithIn();
     void createTableWithNotLikeConstraint();
+    void parseTableCheckConstraint();
+    void parseNamedCollation();
+
+    void parseIndex();
+    void parseIndexExpression();
+
+    void parseFallback();
+    void parseSchemaBenchmark();
 };
 
 #endif